@@ -28,6 +28,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include <unistd.h>
 
@@ -44,6 +46,19 @@
 #   define CHK_LAST(text, filter) do { } while (0)
 #endif
 
+typedef void (*TMsgEmitter)(const char *);
+typedef std::vector<std::pair<TMsgEmitter, std::string> > THeldMsgs;
+
+// messages held back by the ClMsgQueue installed in the current thread, if any
+static __thread THeldMsgs *held_msgs;
+
+#define CHK_HELD(emitter, text) do {                                    \
+    if (held_msgs) {                                                    \
+        held_msgs->push_back(THeldMsgs::value_type((emitter), (text)));  \
+        return;                                                         \
+    }                                                                   \
+} while (0)
+
 const struct cl_loc cl_loc_unknown = {
     0,  // .file
     0,  // .line
@@ -92,23 +107,27 @@ static struct cl_init_data init_data = {
 
 void cl_debug(const char *msg)
 {
+    CHK_HELD(cl_debug, msg);
     init_data.debug(msg);
 }
 
 void cl_warn(const char *msg)
 {
+    CHK_HELD(cl_warn, msg);
     CHK_LAST(msg, /* filter */ true);
     init_data.warn(msg);
 }
 
 void cl_error(const char *msg)
 {
+    CHK_HELD(cl_error, msg);
     CHK_LAST(msg, /* filter */ true);
     init_data.error(msg);
 }
 
 void cl_note(const char *msg)
 {
+    CHK_HELD(cl_note, msg);
     CHK_LAST(msg, /* filter */ false);
     init_data.note(msg);
 }
@@ -125,6 +144,42 @@ int cl_debug_level(void)
     return init_data.debug_level;
 }
 
+struct ClMsgQueue::Private {
+    THeldMsgs                   msgs;
+};
+
+ClMsgQueue::ClMsgQueue():
+    d(new Private)
+{
+}
+
+ClMsgQueue::~ClMsgQueue()
+{
+    if (held_msgs == &d->msgs)
+        held_msgs = 0;
+
+    delete d;
+}
+
+void ClMsgQueue::install()
+{
+    held_msgs = &d->msgs;
+}
+
+void ClMsgQueue::uninstall()
+{
+    held_msgs = 0;
+}
+
+void ClMsgQueue::flush()
+{
+    THeldMsgs msgs;
+    msgs.swap(d->msgs);
+
+    for (THeldMsgs::const_iterator it = msgs.begin(); it != msgs.end(); ++it)
+        it->first(it->second.c_str());
+}
+
 void cl_global_init(struct cl_init_data *data)
 {
     init_data = *data;
@@ -131,6 +131,21 @@ public:
 	virtual void execute(ExecutionManager& execMan, const StateType& state) = 0;
 
 
+	/**
+	 * @brief  Gets the statically known successors of the instruction
+	 *
+	 * Appends the instructions that may be executed right after this one
+	 * (valid once the code is finalised). Targets known only at run time
+	 * (e.g. return addresses) are reported by the instruction that loads them.
+	 *
+	 * @param[out]  next  The vector the successors are appended to
+	 */
+	virtual void getSuccessors(std::vector<AbstractInstruction*>& next) const
+	{
+		(void)next;
+	}
+
+
 	/**
 	 * @brief  Outputs instruction to std::ostream
 	 *
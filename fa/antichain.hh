@@ -59,7 +59,7 @@ protected:
 	typedef list<state_cache_type::value_type*> antichain_item_type;
 	typedef unordered_map<size_t, antichain_item_type> antichain_type;
 
-	const vector<vector<bool> >& rel; 
+	const BitMatrix& rel; 
 	
 	vector<vector<size_t> > relIndex;
 	vector<vector<size_t> > invRelIndex;
@@ -186,9 +186,9 @@ protected:
 
 public:
 
-	Antichain(const vector<vector<bool> >& rel) : rel(rel), stateCacheListener(*this) {
+	Antichain(const BitMatrix& rel) : rel(rel), stateCacheListener(*this) {
 		utils::relIndex(this->relIndex, rel);
-		vector<vector<bool> > invRel;
+		BitMatrix invRel;
 		utils::relInv(invRel, rel);
 		utils::relIndex(this->invRelIndex, invRel);
 	}
@@ -77,7 +77,7 @@ public:
 
 public:
 
-	AntichainExt(const vector<vector<bool> >& rel)
+	AntichainExt(const BitMatrix& rel)
 		: Antichain(rel) {}
 	
 	void initIndex(size_t aSize, size_t /* bSize */) {
@@ -165,7 +165,7 @@ public:
 		for (size_t i = 0; i < cSize; ++i)
 			stateIndex.add(i);
 		// compute simulation
-		vector<vector<bool> > upsim, dwnsim, ident(cSize, vector<bool>(cSize, false));
+		BitMatrix upsim, dwnsim, ident(cSize, false);
 		for (size_t i = 0; i < cSize; ++i)
 			ident[i][i] = true;		
 //		computeUp(upsim, c, slIndex, ident);
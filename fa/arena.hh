@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <utility>
+
+// memory for the temporary containers of a single computation, nothing is
+// freed until the arena dies and then everything at once; the first block is
+// part of the arena itself, so small computations do not touch the heap
+class Arena {
+
+public:
+
+	struct Stats {
+
+		std::atomic<size_t> arenas;
+		std::atomic<size_t> bytes;
+		std::atomic<size_t> blocks;
+
+		Stats() : arenas(0), bytes(0), blocks(0) {}
+
+	};
+
+	// the totals of all the arenas which have died so far
+	static Stats& stats() {
+		static Stats stats;
+		return stats;
+	}
+
+private:
+
+	static const size_t alignment = 16;
+	static const size_t inlineSize = 2048;
+	static const size_t blockSize = 16384;
+
+	alignas(16) char inline_[inlineSize];
+
+	char* cur_;
+	char* end_;
+
+	std::vector<char*> blocks_;
+
+	size_t bytes_;
+
+	void newBlock(size_t size) {
+		size = (size > Arena::blockSize)?(size):(Arena::blockSize);
+		char* block = (char*)::operator new(size);
+		this->blocks_.push_back(block);
+		this->cur_ = block;
+		this->end_ = block + size;
+	}
+
+public:
+
+	Arena() : cur_(inline_), end_(inline_ + inlineSize), blocks_(), bytes_(0) {}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena() {
+		for (auto block : this->blocks_)
+			::operator delete(block);
+		Stats& stats = Arena::stats();
+		++stats.arenas;
+		stats.bytes += this->bytes_;
+		stats.blocks += this->blocks_.size();
+	}
+
+	void* allocate(size_t size) {
+		size = (size + Arena::alignment - 1) & ~(Arena::alignment - 1);
+		if (size > (size_t)(this->end_ - this->cur_))
+			this->newBlock(size);
+		void* p = this->cur_;
+		this->cur_ += size;
+		this->bytes_ += size;
+		return p;
+	}
+
+};
+
+template <class T>
+class ArenaAllocator {
+
+public:
+
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind { typedef ArenaAllocator<U> other; };
+
+	Arena* arena;
+
+	ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& rhs) : arena(rhs.arena) {}
+
+	T* allocate(size_t n, const void* = 0) {
+		return (T*)this->arena->allocate(n*sizeof(T));
+	}
+
+	void deallocate(T*, size_t) {}
+
+	size_t max_size() const {
+		return size_t(-1) / sizeof(T);
+	}
+
+	template <class U, class... Args>
+	void construct(U* p, Args&&... args) {
+		::new((void*)p) U(std::forward<Args>(args)...);
+	}
+
+	template <class U>
+	void destroy(U* p) {
+		p->~U();
+	}
+
+	template <class U>
+	bool operator==(const ArenaAllocator<U>& rhs) const {
+		return this->arena == rhs.arena;
+	}
+
+	template <class U>
+	bool operator!=(const ArenaAllocator<U>& rhs) const {
+		return this->arena != rhs.arena;
+	}
+
+};
+
+// free lists of small nodes carved from large slabs, used by long-lived
+// node-based containers with a high turnover; the slabs are returned to the
+// system when the pool dies (the pool is not thread-safe on its own)
+class NodePool {
+
+public:
+
+	struct Stats {
+
+		size_t nodes;
+		size_t reused;
+		size_t slabs;
+
+		Stats() : nodes(0), reused(0), slabs(0) {}
+
+		Stats& operator+=(const Stats& rhs) {
+			this->nodes += rhs.nodes;
+			this->reused += rhs.reused;
+			this->slabs += rhs.slabs;
+			return *this;
+		}
+
+	};
+
+private:
+
+	static const size_t granularity = 16;
+	static const size_t classCount = 16;
+	static const size_t slabSize = 65536;
+
+	struct FreeNode {
+		FreeNode* next;
+	};
+
+	FreeNode* free_[classCount];
+
+	std::vector<char*> slabs_;
+
+	char* cur_;
+	char* end_;
+
+	Stats stats_;
+
+public:
+
+	NodePool() : slabs_(), cur_(NULL), end_(NULL), stats_() {
+		std::fill(this->free_, this->free_ + NodePool::classCount, (FreeNode*)NULL);
+	}
+
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	~NodePool() {
+		for (auto slab : this->slabs_)
+			::operator delete(slab);
+	}
+
+	void* allocate(size_t size) {
+		if (size > NodePool::granularity*NodePool::classCount)
+			return ::operator new(size);
+		size_t index = (size + NodePool::granularity - 1) / NodePool::granularity - 1;
+		++this->stats_.nodes;
+		if (this->free_[index]) {
+			FreeNode* node = this->free_[index];
+			this->free_[index] = node->next;
+			++this->stats_.reused;
+			return node;
+		}
+		size = (index + 1)*NodePool::granularity;
+		if (size > (size_t)(this->end_ - this->cur_)) {
+			this->cur_ = (char*)::operator new(NodePool::slabSize);
+			this->end_ = this->cur_ + NodePool::slabSize;
+			this->slabs_.push_back(this->cur_);
+			++this->stats_.slabs;
+		}
+		void* p = this->cur_;
+		this->cur_ += size;
+		return p;
+	}
+
+	void deallocate(void* p, size_t size) {
+		if (size > NodePool::granularity*NodePool::classCount) {
+			::operator delete(p);
+			return;
+		}
+		size_t index = (size + NodePool::granularity - 1) / NodePool::granularity - 1;
+		FreeNode* node = (FreeNode*)p;
+		node->next = this->free_[index];
+		this->free_[index] = node;
+	}
+
+	const Stats& stats() const {
+		return this->stats_;
+	}
+
+};
+
+template <class T>
+class PoolAllocator {
+
+public:
+
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind { typedef PoolAllocator<U> other; };
+
+	NodePool* pool;
+
+	PoolAllocator(NodePool& pool) : pool(&pool) {}
+
+	template <class U>
+	PoolAllocator(const PoolAllocator<U>& rhs) : pool(rhs.pool) {}
+
+	// only single nodes come from the pool, arrays (e.g. buckets) do not
+	T* allocate(size_t n, const void* = 0) {
+		if (n != 1)
+			return (T*)::operator new(n*sizeof(T));
+		return (T*)this->pool->allocate(sizeof(T));
+	}
+
+	void deallocate(T* p, size_t n) {
+		if (n != 1)
+			::operator delete(p);
+		else
+			this->pool->deallocate(p, sizeof(T));
+	}
+
+	size_t max_size() const {
+		return size_t(-1) / sizeof(T);
+	}
+
+	template <class U, class... Args>
+	void construct(U* p, Args&&... args) {
+		::new((void*)p) U(std::forward<Args>(args)...);
+	}
+
+	template <class U>
+	void destroy(U* p) {
+		p->~U();
+	}
+
+	template <class U>
+	bool operator==(const PoolAllocator<U>& rhs) const {
+		return this->pool == rhs.pool;
+	}
+
+	template <class U>
+	bool operator!=(const PoolAllocator<U>& rhs) const {
+		return this->pool != rhs.pool;
+	}
+
+};
+
+#endif
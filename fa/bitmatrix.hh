@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIT_MATRIX_H
+#define BIT_MATRIX_H
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <ostream>
+
+// dense binary relation stored row by row in machine words, bits beyond the
+// last column are always kept clear so that row operations can work on whole
+// words
+class BitMatrix {
+
+public:
+
+	typedef uint64_t word_type;
+
+	static const size_t wordBits = 64;
+
+private:
+
+	size_t _rows;
+	size_t _cols;
+	size_t _stride;
+	std::vector<word_type> _data;
+
+	static size_t words(size_t bits) {
+		return (bits + wordBits - 1) / wordBits;
+	}
+
+	word_type lastMask() const {
+		return (this->_cols % wordBits)?((word_type(1) << (this->_cols % wordBits)) - 1):(~word_type(0));
+	}
+
+	word_type* row(size_t i) {
+		assert(i < this->_rows);
+		return &this->_data[i*this->_stride];
+	}
+
+	const word_type* row(size_t i) const {
+		assert(i < this->_rows);
+		return &this->_data[i*this->_stride];
+	}
+
+	void fillRow(word_type* r, bool value) const {
+		if (!this->_stride)
+			return;
+		std::fill(r, r + this->_stride, value?(~word_type(0)):(word_type(0)));
+		r[this->_stride - 1] &= this->lastMask();
+	}
+
+public:
+
+	class Reference {
+
+		word_type& _word;
+		word_type _mask;
+
+	public:
+
+		Reference(word_type& word, word_type mask) : _word(word), _mask(mask) {}
+
+		operator bool() const { return (this->_word & this->_mask) != 0; }
+
+		Reference& operator=(bool value) {
+			if (value)
+				this->_word |= this->_mask;
+			else
+				this->_word &= ~this->_mask;
+			return *this;
+		}
+
+		Reference& operator=(const Reference& rhs) {
+			return *this = (bool)rhs;
+		}
+
+	};
+
+	class Row {
+
+		word_type* _row;
+
+	public:
+
+		Row(word_type* row) : _row(row) {}
+
+		Reference operator[](size_t j) const {
+			return Reference(this->_row[j / wordBits], word_type(1) << (j % wordBits));
+		}
+
+	};
+
+	class ConstRow {
+
+		const word_type* _row;
+
+	public:
+
+		ConstRow(const word_type* row) : _row(row) {}
+
+		bool operator[](size_t j) const {
+			return (this->_row[j / wordBits] >> (j % wordBits)) & 1;
+		}
+
+	};
+
+public:
+
+	BitMatrix(size_t size = 0, bool value = false)
+		: _rows(size), _cols(size), _stride(words(size)), _data(size*words(size)) {
+		this->fill(value);
+	}
+
+	BitMatrix(size_t rows, size_t cols, bool value)
+		: _rows(rows), _cols(cols), _stride(words(cols)), _data(rows*words(cols)) {
+		this->fill(value);
+	}
+
+	size_t size() const {
+		assert(this->_rows == this->_cols);
+		return this->_rows;
+	}
+
+	size_t rows() const { return this->_rows; }
+
+	size_t cols() const { return this->_cols; }
+
+	Row operator[](size_t i) { return Row(this->row(i)); }
+
+	ConstRow operator[](size_t i) const { return ConstRow(this->row(i)); }
+
+	bool get(size_t i, size_t j) const {
+		assert(j < this->_cols);
+		return (*this)[i][j];
+	}
+
+	void set(size_t i, size_t j, bool value = true) {
+		assert(j < this->_cols);
+		(*this)[i][j] = value;
+	}
+
+	void fill(bool value) {
+		for (size_t i = 0; i < this->_rows; ++i)
+			this->fillRow(this->row(i), value);
+	}
+
+	// new cells (both in old and new rows) are initialized to value
+	void resize(size_t rows, size_t cols, bool value) {
+		BitMatrix tmp(rows, cols, value);
+		size_t minRows = std::min(rows, this->_rows), minCols = std::min(cols, this->_cols);
+		for (size_t i = 0; i < minRows; ++i) {
+			word_type* dst = tmp.row(i);
+			const word_type* src = this->row(i);
+			size_t full = minCols / wordBits;
+			std::copy(src, src + full, dst);
+			if (minCols % wordBits) {
+				word_type mask = (word_type(1) << (minCols % wordBits)) - 1;
+				dst[full] = (dst[full] & ~mask) | (src[full] & mask);
+			}
+		}
+		std::swap(*this, tmp);
+	}
+
+	void resize(size_t size, bool value) {
+		this->resize(size, size, value);
+	}
+
+	// this[i] &= src[j]
+	void rowAnd(size_t i, const BitMatrix& src, size_t j) {
+		assert(this->_stride == src._stride);
+		word_type* dst = this->row(i);
+		const word_type* s = src.row(j);
+		for (size_t k = 0; k < this->_stride; ++k)
+			dst[k] &= s[k];
+	}
+
+	// this[i] |= src[j]
+	void rowOr(size_t i, const BitMatrix& src, size_t j) {
+		assert(this->_stride == src._stride);
+		word_type* dst = this->row(i);
+		const word_type* s = src.row(j);
+		for (size_t k = 0; k < this->_stride; ++k)
+			dst[k] |= s[k];
+	}
+
+	// this[i] &= ~src[j]
+	void rowAndNot(size_t i, const BitMatrix& src, size_t j) {
+		assert(this->_stride == src._stride);
+		word_type* dst = this->row(i);
+		const word_type* s = src.row(j);
+		for (size_t k = 0; k < this->_stride; ++k)
+			dst[k] &= ~s[k];
+	}
+
+	// this[i] is a subset of m[j]
+	bool rowSubseteq(size_t i, const BitMatrix& m, size_t j) const {
+		assert(this->_stride == m._stride);
+		const word_type* r1 = this->row(i);
+		const word_type* r2 = m.row(j);
+		for (size_t k = 0; k < this->_stride; ++k) {
+			if (r1[k] & ~r2[k])
+				return false;
+		}
+		return true;
+	}
+
+	// this[i] and m[j] share at least one column
+	bool rowIntersects(size_t i, const BitMatrix& m, size_t j) const {
+		assert(this->_stride == m._stride);
+		const word_type* r1 = this->row(i);
+		const word_type* r2 = m.row(j);
+		for (size_t k = 0; k < this->_stride; ++k) {
+			if (r1[k] & r2[k])
+				return true;
+		}
+		return false;
+	}
+
+	// calls f(j) for every j such that this[i][j] holds (in ascending order)
+	template <class F>
+	void forEachInRow(size_t i, F f) const {
+		const word_type* r = this->row(i);
+		for (size_t k = 0; k < this->_stride; ++k) {
+			for (word_type w = r[k]; w; w &= w - 1)
+				f(k*wordBits + __builtin_ctzll(w));
+		}
+	}
+
+	BitMatrix& operator&=(const BitMatrix& rhs) {
+		assert(this->_data.size() == rhs._data.size());
+		for (size_t k = 0; k < this->_data.size(); ++k)
+			this->_data[k] &= rhs._data[k];
+		return *this;
+	}
+
+	BitMatrix& operator|=(const BitMatrix& rhs) {
+		assert(this->_data.size() == rhs._data.size());
+		for (size_t k = 0; k < this->_data.size(); ++k)
+			this->_data[k] |= rhs._data[k];
+		return *this;
+	}
+
+	void transpose(BitMatrix& dst) const {
+		dst = BitMatrix(this->_cols, this->_rows, false);
+		for (size_t i = 0; i < this->_rows; ++i)
+			this->forEachInRow(i, [&dst, i](size_t j) { dst.set(j, i); });
+	}
+
+	bool operator==(const BitMatrix& rhs) const {
+		return (this->_rows == rhs._rows) && (this->_cols == rhs._cols) && (this->_data == rhs._data);
+	}
+
+	bool operator!=(const BitMatrix& rhs) const {
+		return !(*this == rhs);
+	}
+
+	friend std::ostream& operator<<(std::ostream& os, const BitMatrix& m) {
+		for (size_t i = 0; i < m._rows; ++i) {
+			for (size_t j = 0; j < m._cols; ++j)
+				os << m[i][j];
+			os << std::endl;
+		}
+		return os;
+	}
+
+};
+
+#endif
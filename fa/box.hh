@@ -21,6 +21,8 @@
 #define BOX_H
 
 #include <string>
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 #include <cassert>
 #include <ostream>
@@ -153,6 +155,7 @@ public:
 class Box : public StructuralBox {
 
 	friend class BoxMan;
+	friend class BoxStore;
 
 	std::string name;
 	size_t hint;
@@ -170,6 +173,69 @@ class Box : public StructuralBox {
 
 	bool selfReference;
 
+public:
+
+	// labels occurring in the trees of a language (and separately those at their
+	// roots), a language can only be included in another one if its labels are,
+	// the mask allows to reject most of the candidates without any search
+	struct LabelFingerprint {
+
+		std::vector<label_type> labels;
+		std::vector<label_type> rootLabels;
+		uint64_t mask;
+
+		LabelFingerprint() : labels(), rootLabels(), mask(0) {}
+
+		void compute(const TA<label_type>& ta) {
+
+			TA<label_type> tmp(*ta.backend);
+
+			ta.uselessAndUnreachableFree(tmp);
+
+			for (auto i = tmp.begin(); i != tmp.end(); ++i) {
+
+				this->labels.push_back(i->label());
+
+				if (tmp.isFinalState(i->rhs()))
+					this->rootLabels.push_back(i->label());
+
+			}
+
+			std::sort(this->labels.begin(), this->labels.end());
+			this->labels.resize(std::unique(this->labels.begin(), this->labels.end()) - this->labels.begin());
+
+			std::sort(this->rootLabels.begin(), this->rootLabels.end());
+			this->rootLabels.resize(std::unique(this->rootLabels.begin(), this->rootLabels.end()) - this->rootLabels.begin());
+
+			for (auto& label : this->labels)
+				this->mask |= uint64_t(1) << (hash_value(label) % 64);
+
+		}
+
+		bool operator==(const LabelFingerprint& rhs) const {
+
+			return (this->mask == rhs.mask) && (this->labels == rhs.labels) &&
+				(this->rootLabels == rhs.rootLabels);
+
+		}
+
+		bool mayBeIncludedIn(const LabelFingerprint& rhs) const {
+
+			if (this->mask & ~rhs.mask)
+				return false;
+
+			return std::includes(rhs.labels.begin(), rhs.labels.end(), this->labels.begin(), this->labels.end()) &&
+				std::includes(rhs.rootLabels.begin(), rhs.rootLabels.end(), this->rootLabels.begin(), this->rootLabels.end());
+
+		}
+
+	};
+
+private:
+
+	LabelFingerprint outputFingerprint;
+	LabelFingerprint inputFingerprint;
+
 public:
 
 	struct Signature {
@@ -310,6 +376,8 @@ protected:
 
 		Box::getAcceptingLabels(this->outputLabels, *output);
 
+		this->outputFingerprint.compute(*output);
+
 		boost::hash_combine(this->hint, selectors);
 		boost::hash_combine(this->hint, this->outputLabels);
 		boost::hash_combine(this->hint, outputSignature);
@@ -318,6 +386,8 @@ protected:
 
 			Box::getAcceptingLabels(this->inputLabels, *input);
 
+			this->inputFingerprint.compute(*input);
+
 			boost::hash_combine(this->hint, this->inputLabels);
 			boost::hash_combine(this->hint, inputSignature);
 
@@ -584,6 +654,39 @@ public:
 
 	}
 
+	// cheap necessary condition of operator==()
+	bool mayBeEqual(const Box& rhs) const {
+
+		if ((bool)this->input != (bool)rhs.input)
+			return false;
+
+		if (this->input && !(this->inputFingerprint == rhs.inputFingerprint))
+			return false;
+
+		return this->outputFingerprint == rhs.outputFingerprint;
+
+	}
+
+	// cheap necessary condition of simplifiedLessThan()
+	bool mayBeLessThan(const Box& rhs) const {
+
+		if ((bool)this->input != (bool)rhs.input)
+			return false;
+
+		if (this->input) {
+
+			if (this->inputIndex != rhs.inputIndex)
+				return false;
+
+			if (!this->inputFingerprint.mayBeIncludedIn(rhs.inputFingerprint))
+				return false;
+
+		}
+
+		return this->outputFingerprint.mayBeIncludedIn(rhs.outputFingerprint);
+
+	}
+
 	bool simplifiedLessThan(const Box& rhs) const {
 
 		if ((bool)this->input != (bool)rhs.input)
@@ -32,6 +32,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "config.h"
+#include "sync.hh"
 
 #include "treeaut.hh"
 #include "tatimint.hh"
@@ -41,8 +42,25 @@
 #include "utils.hh"
 #include "restart_request.hh"
 
+// the number of box comparisons and of those decided without checking the
+// language inclusion
+struct BoxDatabaseStats {
+
+	size_t comparisons;
+	size_t filtered;
+
+	BoxDatabaseStats() : comparisons(0), filtered(0) {}
+
+};
+
 class BoxAntichain {
 
+public:
+
+	typedef BoxDatabaseStats Stats;
+
+private:
+
 	std::unordered_map<Box::Signature, std::list<Box>, boost::hash<Box::Signature>> boxes_;
 
 	std::list<Box> obsolete_;
@@ -51,9 +69,29 @@ class BoxAntichain {
 
 	size_t size_;
 
+	mutable Stats stats_;
+
+	// boxes sharing the signature are first compared using the labels they
+	// contain, the language inclusion is only checked if that does not decide
+	bool lessThan(const Box& lhs, const Box& rhs) const {
+
+		++this->stats_.comparisons;
+
+		if (!lhs.mayBeLessThan(rhs)) {
+
+			++this->stats_.filtered;
+
+			return false;
+
+		}
+
+		return lhs.simplifiedLessThan(rhs);
+
+	}
+
 public:
 
-	BoxAntichain() : boxes_(), obsolete_(), modified_(false), size_(0) {}
+	BoxAntichain() : boxes_(), obsolete_(), modified_(false), size_(0), stats_() {}
 
 	const Box* get(const Box& box) {
 
@@ -67,10 +105,10 @@ public:
 
 				assert(!this->modified_ || !box.simplifiedLessThan(*iter));
 
-				if (!this->modified_ && box.simplifiedLessThan(*iter))
+				if (!this->modified_ && this->lessThan(box, *iter))
 					return &*iter;
 
-				if (iter->simplifiedLessThan(box)) {
+				if (this->lessThan(*iter, box)) {
 
 					auto tmp = iter++;
 
@@ -106,7 +144,7 @@ public:
 
 			for (auto& box2 : iter->second) {
 
-				if (box.simplifiedLessThan(box2))
+				if (this->lessThan(box, box2))
 					return &box2;
 
 			}
@@ -125,6 +163,10 @@ public:
 		return this->size_;
 	}
 
+	const Stats& stats() const {
+		return this->stats_;
+	}
+
 	void clear() {
 		this->boxes_.clear();
 	}
@@ -144,13 +186,50 @@ public:
 
 class BoxSet {
 
-	std::unordered_set<Box, boost::hash<Box>> boxes_;
+public:
+
+	typedef BoxDatabaseStats Stats;
+
+private:
+
+	// boxes with the same hint are first compared using the labels they
+	// contain, the languages are only compared if that does not decide
+	struct EqualF {
+
+		Stats* stats;
+
+		EqualF(Stats* stats) : stats(stats) {}
+
+		bool operator()(const Box& lhs, const Box& rhs) const {
+
+			++this->stats->comparisons;
+
+			if (!lhs.mayBeEqual(rhs)) {
+
+				++this->stats->filtered;
+
+				return false;
+
+			}
+
+			return lhs == rhs;
+
+		}
+
+	};
+
+	Stats stats_;
+
+	std::unordered_set<Box, boost::hash<Box>, EqualF> boxes_;
 
 	bool modified_;
 
 public:
 
-	BoxSet() : boxes_(), modified_(false) {}
+	BoxSet() : stats_(), boxes_(0, boost::hash<Box>(), EqualF(&this->stats_)), modified_(false) {}
+
+	BoxSet(const BoxSet&) = delete;
+	BoxSet& operator=(const BoxSet&) = delete;
 
 	const Box* get(const Box& box) {
 
@@ -182,6 +261,10 @@ public:
 		return this->boxes_.size();
 	}
 
+	const Stats& stats() const {
+		return this->stats_;
+	}
+
 	void asVector(std::vector<const Box*>& boxes) const {
 
 		for (auto& box : this->boxes_)
@@ -210,6 +293,9 @@ class BoxMan {
 
 	BoxDatabase boxes;
 
+	// guards the label and data stores which are shared by all workers
+	mutable Mutex storeMutex;
+
 	const std::pair<const Data, NodeLabel*>& insertData(const Data& data) {
 		std::pair<boost::unordered_map<Data, NodeLabel*>::iterator, bool> p
 			= this->dataStore.insert(std::make_pair(data, (NodeLabel*)NULL));
@@ -235,10 +321,12 @@ class BoxMan {
 public:
 
 	label_type lookupLabel(const Data& data) {
+		MutexGuard guard(this->storeMutex);
 		return this->insertData(data).second;
 	}
 
 	label_type lookupLabel(size_t arity, const std::vector<Data>& x) {
+		MutexGuard guard(this->storeMutex);
 		std::pair<boost::unordered_map<std::pair<size_t, std::vector<Data> >, NodeLabel*>::iterator, bool> p
 			= this->vDataStore.insert(std::make_pair(std::make_pair(arity, x), (NodeLabel*)NULL));
 		if (p.second)
@@ -279,6 +367,8 @@ public:
 
 	label_type lookupLabel(const std::vector<const AbstractBox*>& x) {
 
+		MutexGuard guard(this->storeMutex);
+
 		std::pair<boost::unordered_map<std::vector<const AbstractBox*>, NodeLabel*>::iterator, bool> p
 			= this->nodeStore.insert(std::make_pair(x, (NodeLabel*)NULL));
 
@@ -307,19 +397,23 @@ public:
 	}
 
 	const Data& getData(const Data& data) {
+		MutexGuard guard(this->storeMutex);
 		return this->insertData(data).first;
 	}
 
 	size_t getDataId(const Data& data) {
+		MutexGuard guard(this->storeMutex);
 		return this->insertData(data).second->getDataId();
 	}
 
 	const Data& getData(size_t index) const {
+		MutexGuard guard(this->storeMutex);
 		assert(index < this->dataIndex.size());
 		return *this->dataIndex[index];
 	}
 
 	const SelBox* getSelector(const SelData& sel) {
+		MutexGuard guard(this->storeMutex);
 		std::pair<const SelData, const SelBox*>& p = *this->selIndex.insert(
 			std::make_pair(sel, (const SelBox*)NULL)
 		).first;
@@ -456,7 +550,8 @@ public:
 
 	}
 
-	const Box* getBox(const Box& box) {
+	// inserts the box into the database unless it is covered there already
+	const Box* addBox(const Box& box) {
 
 		auto cpBox = this->boxes.get(box);
 
@@ -467,6 +562,18 @@ public:
 			pBox->name = this->getBoxName();
 			pBox->initialize();
 
+		}
+
+		return cpBox;
+
+	}
+
+	const Box* getBox(const Box& box) {
+
+		auto cpBox = this->addBox(box);
+
+		if (this->boxes.modified()) {
+
 			CL_CDEBUG(1, "learning " << *(AbstractBox*)cpBox << ':' << std::endl << *cpBox);
 
 #if FA_RESTART_AFTER_BOX_DISCOVERY
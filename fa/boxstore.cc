@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cl/cl_msg.hh>
+
+#include "boxstore.hh"
+
+// the file starts with these two words, the version has to be increased
+// whenever the encoding below changes
+static const char boxStoreMagic[8] = { 'F', 'A', 'B', 'O', 'X', 'D', 'B', '\0' };
+static const uint64_t boxStoreVersion = 1;
+
+// the encoding of labels and boxes
+static const uint64_t labelData = 0;
+static const uint64_t labelNode = 1;
+
+namespace {
+
+// the box cannot be written (it contains native pointers or the like)
+struct Unpersistable {};
+
+// the box cannot be restored in the current run (e.g. its types do not exist)
+struct Unavailable {};
+
+// read-only mapping of a whole file
+struct Mapping {
+
+	void* data;
+	size_t size;
+
+	Mapping() : data(MAP_FAILED), size(0) {}
+
+	~Mapping() {
+		if (this->data != MAP_FAILED)
+			munmap(this->data, this->size);
+	}
+
+};
+
+}
+
+// everything is stored as a sequence of 64-bit words
+class BoxStore::Writer {
+
+public:
+
+	std::vector<uint64_t> words;
+
+	Writer() : words() {}
+
+	void put(uint64_t x) {
+		this->words.push_back(x);
+	}
+
+	void putInt(int x) {
+		this->words.push_back((uint64_t)(int64_t)x);
+	}
+
+	void putString(const std::string& s) {
+		this->put(s.size());
+		size_t offset = this->words.size();
+		this->words.resize(offset + (s.size() + 7) / 8, 0);
+		memcpy(&this->words[offset], s.data(), s.size());
+	}
+
+	template <class T>
+	void putSet(const T& s) {
+		this->put(s.size());
+		for (auto& x : s)
+			this->put(x);
+	}
+
+};
+
+class BoxStore::Reader {
+
+	const uint64_t* cur_;
+	const uint64_t* end_;
+
+	void need(size_t n) const {
+		if ((size_t)(this->end_ - this->cur_) < n)
+			throw std::runtime_error("corrupted box database");
+	}
+
+public:
+
+	Reader(const uint64_t* begin, const uint64_t* end) : cur_(begin), end_(end) {}
+
+	bool atEnd() const {
+		return this->cur_ == this->end_;
+	}
+
+	uint64_t get() {
+		this->need(1);
+		return *this->cur_++;
+	}
+
+	int getInt() {
+		return (int)(int64_t)this->get();
+	}
+
+	std::string getString() {
+		size_t size = this->get();
+		size_t words = (size + 7) / 8;
+		this->need(words);
+		std::string s((const char*)this->cur_, size);
+		this->cur_ += words;
+		return s;
+	}
+
+	template <class T>
+	void getSet(T& s) {
+		for (size_t n = this->get(); n; --n)
+			s.insert(s.end(), this->get());
+	}
+
+	// a nested reader over the next n words
+	Reader sub(size_t n) {
+		this->need(n);
+		Reader reader(this->cur_, this->cur_ + n);
+		this->cur_ += n;
+		return reader;
+	}
+
+};
+
+void BoxStore::writeData(Writer& writer, const Data& data) {
+	writer.put(data.type);
+	writer.putInt(data.size);
+	switch (data.type) {
+		case data_type_e::t_native_ptr:
+			throw Unpersistable();
+		case data_type_e::t_void_ptr:
+			writer.put(data.d_void_ptr_size);
+			break;
+		case data_type_e::t_ref:
+			writer.put(data.d_ref.root);
+			writer.putInt(data.d_ref.displ);
+			break;
+		case data_type_e::t_int:
+			writer.putInt(data.d_int);
+			break;
+		case data_type_e::t_bool:
+			writer.put(data.d_bool);
+			break;
+		case data_type_e::t_struct:
+			writer.put(data.d_struct->size());
+			for (auto& item : *data.d_struct) {
+				writer.put(item.first);
+				BoxStore::writeData(writer, item.second);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void BoxStore::readData(Reader& reader, Data& data) {
+	uint64_t type = reader.get();
+	if (type > data_type_e::t_other)
+		throw std::runtime_error("corrupted box database");
+	int size = reader.getInt();
+	Data tmp((data_type_e)type);
+	switch (tmp.type) {
+		case data_type_e::t_native_ptr:
+			throw std::runtime_error("corrupted box database");
+		case data_type_e::t_void_ptr:
+			tmp.d_void_ptr_size = reader.get();
+			break;
+		case data_type_e::t_ref:
+			tmp.d_ref.root = reader.get();
+			tmp.d_ref.displ = reader.getInt();
+			break;
+		case data_type_e::t_int:
+			tmp.d_int = reader.getInt();
+			break;
+		case data_type_e::t_bool:
+			tmp.d_bool = reader.get() != 0;
+			break;
+		case data_type_e::t_struct:
+			tmp.d_struct = new std::vector<Data::item_info>();
+			for (size_t n = reader.get(); n; --n) {
+				size_t offset = reader.get();
+				tmp.d_struct->push_back(std::make_pair(offset, Data()));
+				BoxStore::readData(reader, tmp.d_struct->back().second);
+			}
+			break;
+		default:
+			break;
+	}
+	tmp.size = size;
+	data = tmp;
+}
+
+void BoxStore::writeSignature(Writer& writer, const ConnectionGraph::CutpointSignature& signature) {
+	writer.put(signature.size());
+	for (auto& cutpoint : signature) {
+		writer.put(cutpoint.root);
+		writer.put(cutpoint.refCount);
+		writer.put(cutpoint.realRefCount);
+		writer.put(cutpoint.refInherited);
+		writer.putSet(cutpoint.fwdSelectors);
+		writer.put(cutpoint.bwdSelector);
+		writer.putSet(cutpoint.defines);
+	}
+}
+
+void BoxStore::readSignature(Reader& reader, ConnectionGraph::CutpointSignature& signature) {
+	for (size_t n = reader.get(); n; --n) {
+		ConnectionGraph::CutpointInfo cutpoint(reader.get());
+		cutpoint.refCount = reader.get();
+		cutpoint.realRefCount = reader.get();
+		cutpoint.refInherited = reader.get() != 0;
+		cutpoint.fwdSelectors.clear();
+		reader.getSet(cutpoint.fwdSelectors);
+		cutpoint.bwdSelector = reader.get();
+		reader.getSet(cutpoint.defines);
+		signature.push_back(cutpoint);
+	}
+}
+
+void BoxStore::writeTA(Writer& writer, const TA<label_type>& ta) {
+	writer.putSet(ta.getFinalStates());
+	writer.put(ta.getTransitions().size());
+	for (auto i = ta.begin(); i != ta.end(); ++i) {
+		writer.put(i->rhs());
+		writer.putSet(i->lhs());
+		const label_type& label = i->label();
+		if (label->isData()) {
+			writer.put(labelData);
+			BoxStore::writeData(writer, label->getData());
+		} else if (label->isNode()) {
+			writer.put(labelNode);
+			writer.put(label->getNode().size());
+			for (auto aBox : label->getNode()) {
+				writer.put(aBox->getType());
+				switch (aBox->getType()) {
+					case box_type_e::bSel: {
+						const SelData& sel = ((const SelBox*)aBox)->getData();
+						writer.put(sel.offset);
+						writer.putInt(sel.size);
+						writer.putInt(sel.displ);
+						break;
+					}
+					case box_type_e::bTypeInfo: {
+						const TypeBox* typeBox = (const TypeBox*)aBox;
+						writer.putString(typeBox->getName());
+						writer.putSet(typeBox->getSelectors());
+						break;
+					}
+					case box_type_e::bBox:
+						BoxStore::writeBox(writer, *(const Box*)aBox);
+						break;
+					default:
+						throw Unpersistable();
+				}
+			}
+		} else {
+			throw Unpersistable();
+		}
+	}
+}
+
+std::shared_ptr<TA<label_type>> BoxStore::readTA(Reader& reader, BoxMan& boxMan,
+	TA<label_type>::Backend& backend, bool check) {
+	std::shared_ptr<TA<label_type>> ta(new TA<label_type>(backend));
+	std::vector<size_t> finalStates;
+	reader.getSet(finalStates);
+	for (auto state : finalStates)
+		ta->addFinalState(state);
+	for (size_t n = reader.get(); n; --n) {
+		size_t rhs = reader.get();
+		std::vector<size_t> lhs;
+		reader.getSet(lhs);
+		switch (reader.get()) {
+			case labelData: {
+				Data data;
+				BoxStore::readData(reader, data);
+				if (!check)
+					ta->addTransition(lhs, boxMan.lookupLabel(data), rhs);
+				break;
+			}
+			case labelNode: {
+				std::vector<const AbstractBox*> label;
+				for (size_t k = reader.get(); k; --k) {
+					switch (reader.get()) {
+						case box_type_e::bSel: {
+							size_t offset = reader.get();
+							int size = reader.getInt();
+							int displ = reader.getInt();
+							if (!check)
+								label.push_back(boxMan.getSelector(SelData(offset, size, displ)));
+							break;
+						}
+						case box_type_e::bTypeInfo: {
+							std::string name = reader.getString();
+							std::vector<size_t> selectors;
+							reader.getSet(selectors);
+							const TypeBox* typeBox;
+							try {
+								typeBox = boxMan.getTypeInfo(name);
+							} catch (std::runtime_error&) {
+								throw Unavailable();
+							}
+							// the type has changed since the box was learned
+							if (typeBox->getSelectors() != selectors)
+								throw Unavailable();
+							label.push_back(typeBox);
+							break;
+						}
+						case box_type_e::bBox:
+							label.push_back(this->readBox(reader, boxMan, backend, check));
+							break;
+						default:
+							throw std::runtime_error("corrupted box database");
+					}
+				}
+				if (!check)
+					ta->addTransition(lhs, boxMan.lookupLabel(label), rhs);
+				break;
+			}
+			default:
+				throw std::runtime_error("corrupted box database");
+		}
+	}
+	return ta;
+}
+
+void BoxStore::writeBox(Writer& writer, const Box& box) {
+	writer.put((bool)box.input);
+	BoxStore::writeTA(writer, *box.output);
+	BoxStore::writeSignature(writer, box.outputSignature);
+	writer.putSet(box.inputMap);
+	if (box.input) {
+		BoxStore::writeTA(writer, *box.input);
+		writer.put(box.inputIndex);
+		BoxStore::writeSignature(writer, box.inputSignature);
+	}
+	writer.put(box.selectors.size());
+	for (auto& selector : box.selectors) {
+		writer.put(selector.first);
+		writer.put(selector.second);
+	}
+}
+
+const Box* BoxStore::readBox(Reader& reader, BoxMan& boxMan, TA<label_type>::Backend& backend,
+	bool check) {
+	bool hasInput = reader.get() != 0;
+	std::shared_ptr<TA<label_type>> output = this->readTA(reader, boxMan, backend, check);
+	ConnectionGraph::CutpointSignature outputSignature;
+	BoxStore::readSignature(reader, outputSignature);
+	std::vector<size_t> inputMap;
+	reader.getSet(inputMap);
+	std::shared_ptr<TA<label_type>> input;
+	size_t inputIndex = 0;
+	ConnectionGraph::CutpointSignature inputSignature;
+	if (hasInput) {
+		input = this->readTA(reader, boxMan, backend, check);
+		inputIndex = reader.get();
+		BoxStore::readSignature(reader, inputSignature);
+	}
+	std::vector<std::pair<size_t, size_t>> selectors;
+	for (size_t n = reader.get(); n; --n) {
+		size_t first = reader.get();
+		selectors.push_back(std::make_pair(first, (size_t)reader.get()));
+	}
+	if (output->getFinalStates().empty() || (hasInput && (inputIndex >= selectors.size())))
+		throw std::runtime_error("corrupted box database");
+	if (check)
+		return NULL;
+	const Box* box = boxMan.addBox(
+		Box("", output, outputSignature, inputMap, input, inputIndex, inputSignature, selectors)
+	);
+	this->stored_.insert(box);
+	return box;
+}
+
+size_t BoxStore::load(const std::string& path, BoxMan& boxMan, TA<label_type>::Backend& backend) {
+	this->path_ = path;
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT)
+			return 0;
+		throw std::runtime_error("unable to open the box database " + path);
+	}
+	// do not read a record which is just being appended
+	flock(fd, LOCK_SH);
+	Mapping mapping;
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		mapping.size = st.st_size;
+		if (mapping.size)
+			mapping.data = mmap(NULL, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (!mapping.size)
+		return 0;
+	if (mapping.data == MAP_FAILED)
+		throw std::runtime_error("unable to map the box database " + path);
+	if (mapping.size % sizeof(uint64_t))
+		throw std::runtime_error("corrupted box database " + path);
+	const uint64_t* words = (const uint64_t*)mapping.data;
+	Reader reader(words, words + mapping.size / sizeof(uint64_t));
+	uint64_t magic;
+	memcpy(&magic, boxStoreMagic, sizeof(magic));
+	if (reader.get() != magic)
+		throw std::runtime_error(path + " is not a box database");
+	if (reader.get() != boxStoreVersion)
+		throw std::runtime_error("incompatible version of the box database " + path);
+	size_t count = 0, corrupted = 0;
+	while (!reader.atEnd()) {
+		Reader record(reader);
+		try {
+			record = reader.sub(reader.get());
+		} catch (std::runtime_error&) {
+			// the length of the record is broken, the rest cannot be decoded
+			CL_WARN("the box database " << path << " is truncated");
+			break;
+		}
+		try {
+			// validate the whole record first, so that no nested box gets
+			// registered for a box which turns out to be unusable
+			Reader checked(record);
+			this->readBox(checked, boxMan, backend, true);
+			this->readBox(record, boxMan, backend, false);
+			++count;
+		} catch (Unavailable&) {
+			// the box is not usable with the current program
+		} catch (std::runtime_error&) {
+			++corrupted;
+		}
+	}
+	if (corrupted)
+		CL_WARN("skipped " << corrupted << " corrupted record(s) of the box database " << path);
+	return count;
+}
+
+size_t BoxStore::save(const BoxMan& boxMan) {
+	assert(this->isOpen());
+	std::vector<const Box*> boxes;
+	boxMan.boxDatabase().asVector(boxes);
+	Writer writer;
+	size_t count = 0;
+	for (auto box : boxes) {
+		if (this->stored_.count(box))
+			continue;
+		Writer record;
+		try {
+			BoxStore::writeBox(record, *box);
+		} catch (Unpersistable&) {
+			continue;
+		}
+		writer.put(record.words.size());
+		writer.words.insert(writer.words.end(), record.words.begin(), record.words.end());
+		this->stored_.insert(box);
+		++count;
+	}
+	if (!count)
+		return 0;
+	int fd = open(this->path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0)
+		throw std::runtime_error("unable to open the box database " + this->path_);
+	// the lock is held until the file is closed, so that only the first of
+	// concurrent writers of a new file writes the header
+	if (flock(fd, LOCK_EX) != 0) {
+		close(fd);
+		throw std::runtime_error("unable to lock the box database " + this->path_);
+	}
+	struct stat st;
+	if ((fstat(fd, &st) == 0) && (st.st_size == 0)) {
+		uint64_t header[2];
+		memcpy(&header[0], boxStoreMagic, sizeof(header[0]));
+		header[1] = boxStoreVersion;
+		writer.words.insert(writer.words.begin(), header, header + 2);
+	}
+	// a single write, the records of concurrent runs do not interleave anyway
+	size_t size = writer.words.size()*sizeof(uint64_t);
+	ssize_t written = write(fd, &writer.words[0], size);
+	close(fd);
+	if ((written < 0) || ((size_t)written != size))
+		throw std::runtime_error("unable to write the box database " + this->path_);
+	return count;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOX_STORE_H
+#define BOX_STORE_H
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+#include "treeaut.hh"
+#include "box.hh"
+#include "boxman.hh"
+
+// on-disk database of learned boxes which survives between runs; the file is
+// a versioned header followed by self-contained records (one per box, the
+// boxes it refers to are embedded), so that new boxes can be appended at the
+// end of a run and the file can be decoded directly from a memory mapping
+class BoxStore {
+
+	std::string path_;
+
+	// boxes which are already in the file
+	std::unordered_set<const Box*> stored_;
+
+	class Writer;
+	class Reader;
+
+	static void writeData(Writer& writer, const Data& data);
+	static void writeSignature(Writer& writer, const ConnectionGraph::CutpointSignature& signature);
+	static void writeTA(Writer& writer, const TA<label_type>& ta);
+	static void writeBox(Writer& writer, const Box& box);
+
+	static void readData(Reader& reader, Data& data);
+	static void readSignature(Reader& reader, ConnectionGraph::CutpointSignature& signature);
+
+	// with check set, the record is only validated and nothing is registered
+	// in boxMan (readBox() returns NULL then)
+	const Box* readBox(Reader& reader, BoxMan& boxMan, TA<label_type>::Backend& backend,
+		bool check);
+	std::shared_ptr<TA<label_type>> readTA(Reader& reader, BoxMan& boxMan,
+		TA<label_type>::Backend& backend, bool check);
+
+public:
+
+	BoxStore() : path_(), stored_() {}
+
+	bool isOpen() const {
+		return !this->path_.empty();
+	}
+
+	const std::string& path() const {
+		return this->path_;
+	}
+
+	// loads all the boxes found in the file (a missing file is an empty
+	// database), returns the number of records which have been restored;
+	// corrupted records are skipped and reported
+	size_t load(const std::string& path, BoxMan& boxMan, TA<label_type>::Backend& backend);
+
+	// appends the boxes of boxMan which are not in the file yet, returns their
+	// number
+	size_t save(const BoxMan& boxMan);
+
+	void clear() {
+		this->path_.clear();
+		this->stored_.clear();
+	}
+
+};
+
+#endif
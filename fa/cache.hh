@@ -24,16 +24,22 @@
 #include <list>
 #include <set>
 #include <algorithm>
+#include <cassert>
 
 #include <boost/unordered_map.hpp>
 
+#include "config.h"
+#include "sync.hh"
+#include "arena.hh"
+
 template <class T>
 class Cache {
 
 public:
 
-	typedef typename boost::unordered_map<T, size_t> store_type;
-	typedef typename boost::unordered_map<T, size_t>::value_type value_type;
+	typedef PoolAllocator<std::pair<const T, size_t> > allocator_type;
+	typedef typename boost::unordered_map<T, size_t, boost::hash<T>, std::equal_to<T>, allocator_type> store_type;
+	typedef typename store_type::value_type value_type;
 
 	struct Listener {
 		virtual void drop(value_type* x) = 0;
@@ -41,10 +47,29 @@ public:
 
 private:
 
-	store_type store;
+	// the store is split into independently locked shards when several
+	// workers share the cache
+	static const size_t shardCount = (FA_WORKER_THREADS > 1)?(64):(1);
+
+	// the nodes of each shard come from its own pool (guarded by the shard's
+	// mutex), the pool has to outlive the store
+	struct Shard {
+		NodePool pool;
+		store_type store;
+		Mutex mutex;
+		Shard() : pool(), store(0, typename store_type::hasher(), typename store_type::key_equal(), allocator_type(this->pool)) {}
+	};
+
+	Shard shards[shardCount];
 
 	std::vector<Listener*> listeners;
 
+	Shard& getShard(const T& x) {
+		if (shardCount == 1)
+			return this->shards[0];
+		return this->shards[boost::hash<T>()(x) % shardCount];
+	}
+
 public:
 
 	Cache() {}
@@ -54,37 +79,59 @@ public:
 	}
 
 	value_type* find(const T& x) {
-		typename store_type::iterator i = this->store.find(x);
-		return (i == this->store.end())?(NULL):(&*i);
+		Shard& shard = this->getShard(x);
+		MutexGuard guard(shard.mutex);
+		typename store_type::iterator i = shard.store.find(x);
+		return (i == shard.store.end())?(NULL):(&*i);
 	}
 
 	value_type* lookup(const T& x) {
-		return this->addRef(&*this->store.insert(std::make_pair(x, 0)).first);
+		Shard& shard = this->getShard(x);
+		MutexGuard guard(shard.mutex);
+		value_type* y = &*shard.store.insert(std::make_pair(x, 0)).first;
+		return ++y->second, y;
 	}
 
 	value_type* addRef(value_type* x) {
+		MutexGuard guard(this->getShard(x->first).mutex);
 		return ++x->second, x;
 	}
 
 	size_t release(value_type* x) {
+		Shard& shard = this->getShard(x->first);
+		MutexGuard guard(shard.mutex);
 		if (x->second > 1)
 			return --x->second;
 		for (typename std::vector<Listener*>::iterator i = this->listeners.begin(); i != this->listeners.end(); ++i)
 			(*i)->drop(x);
-		this->store.erase(x->first);
+		shard.store.erase(x->first);
 		return 0;
 	}
 	
 	void clear() {
-		for (typename std::vector<Listener*>::iterator i = this->listeners.begin(); i != this->listeners.end(); ++i) {
-			for (typename store_type::iterator j = this->store.begin(); j != this->store.end(); ++j)
-				(*i)->drop(&*j);
+		for (size_t k = 0; k < shardCount; ++k) {
+			MutexGuard guard(this->shards[k].mutex);
+			for (typename std::vector<Listener*>::iterator i = this->listeners.begin(); i != this->listeners.end(); ++i) {
+				for (typename store_type::iterator j = this->shards[k].store.begin(); j != this->shards[k].store.end(); ++j)
+					(*i)->drop(&*j);
+			}
+			this->shards[k].store.clear();
 		}
-		this->store.clear();
 	}
 
 	bool empty() const {
-		return this->store.empty();
+		for (size_t k = 0; k < shardCount; ++k) {
+			if (!this->shards[k].store.empty())
+				return false;
+		}
+		return true;
+	}
+
+	void getPoolStats(NodePool::Stats& stats) {
+		for (size_t k = 0; k < shardCount; ++k) {
+			MutexGuard guard(this->shards[k].mutex);
+			stats += this->shards[k].pool.stats();
+		}
 	}
 
 };
@@ -262,6 +309,68 @@ public:
 	}
 
 };
+
+// bounded map which drops the least recently used entries first
+template <class K, class V>
+class LRUCache {
+
+public:
+
+	typedef std::list<const K*> lru_queue_type;
+	typedef boost::unordered_map<K, std::pair<V, typename lru_queue_type::iterator> > store_type;
+
+private:
+
+	size_t capacity;
+
+	store_type store;
+	lru_queue_type lruQueue;
+
+public:
+
+	LRUCache(size_t capacity) : capacity(capacity) {}
+
+	// returns NULL when x is not present
+	const V* find(const K& x) {
+		typename store_type::iterator i = this->store.find(x);
+		if (i == this->store.end())
+			return NULL;
+		this->lruQueue.splice(this->lruQueue.begin(), this->lruQueue, i->second.second);
+		return &i->second.first;
+	}
+
+	void insert(const K& x, const V& v) {
+		if (!this->capacity)
+			return;
+		std::pair<typename store_type::iterator, bool> p = this->store.insert(
+			std::make_pair(x, std::make_pair(v, this->lruQueue.end()))
+		);
+		if (!p.second) {
+			p.first->second.first = v;
+			this->lruQueue.splice(this->lruQueue.begin(), this->lruQueue, p.first->second.second);
+			return;
+		}
+		this->lruQueue.push_front(&p.first->first);
+		p.first->second.second = this->lruQueue.begin();
+		while (this->store.size() > this->capacity) {
+			typename store_type::iterator i = this->store.find(*this->lruQueue.back());
+			assert(i != this->store.end());
+			this->lruQueue.pop_back();
+			this->store.erase(i);
+		}
+	}
+
+	size_t size() const {
+		return this->store.size();
+	}
+
+	void clear() {
+		this->lruQueue.clear();
+		this->store.clear();
+	}
+
+};
+
 /*
 template <class T, class V>
 class CachedBinaryOpLRU : public CachedBinaryOp<T, std::pair<V, typename std::list<std::pair<T, T> >::iterator> > {
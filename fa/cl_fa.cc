@@ -52,10 +52,13 @@ extern "C" { int plugin_is_GPL_compatible; }
 struct Config {
 
 	std::string dbRoot;
+	std::string schedPolicy;
 
 	void processArg(const std::string& key, const std::string& value) {
 		if (key == "db-root")
 			this->dbRoot = value;
+		if (key == "sched")
+			this->schedPolicy = value;
 	}
 
 	Config(const std::string& c) {
@@ -70,30 +73,7 @@ struct Config {
 	}
 
 };
-/*
-struct BoxDb {
-
-	std::unordered_map<std::string, std::string> store;
-
-	BoxDb(const std::string& root, const std::string& fileName) {
-		std::ifstream input((root + "/" + fileName).c_str());
-		if (!input.good())
-			throw std::runtime_error("Unable to open " + root + "/" + fileName);
-		std::string buf;
-		while (std::getline(input, buf)) {
-			if (buf.empty())
-				continue;
-			if (buf[0] == '#')
-				continue;
-			std::vector<std::string> data;
-			boost::split(data, buf, boost::is_from_range(':', ':'));
-			if (data.size() == 2)
-				this->store[data[0]] = root + "/" + data[1];
-		}
-	}
 
-};
-*/
 void clEasyRun(const CodeStorage::Storage& stor, const char* configString) {
 
 	ssd::ColorConsole::enableForTerm(STDERR_FILENO);
@@ -129,11 +109,11 @@ void clEasyRun(const CodeStorage::Storage& stor, const char* configString) {
     try {
 		signal(SIGUSR1, setDbgFlag);
 		se.loadTypes(stor);
-/*		Config c(configString);
-		if (!c.dbRoot.empty()){
-			BoxDb db(c.dbRoot, "index");
-			se.loadBoxes(db.store);
-		}*/
+		Config c(configString);
+		if (!c.schedPolicy.empty())
+			se.setSchedulingPolicy(c.schedPolicy);
+		if (!c.dbRoot.empty())
+			se.loadBoxes(c.dbRoot + "/boxes.db");
 		se.compile(stor, *main);
 		se.run();
 		CL_NOTE("the program is safe ...");
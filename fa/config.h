@@ -50,4 +50,29 @@
  */
 #define FA_FUSION_ENABLED					1
 
+/**
+ * the number of remembered results of TA language inclusion checks, 0 turns
+ * the cache off (default is 4096)
+ */
+#define FA_INCLUSION_CACHE_SIZE				4096
+
+/**
+ * reuse the downward simulation of a fixpoint when it gets extended, 0 always
+ * recomputes it from scratch (default is 1)
+ */
+#define FA_INCREMENTAL_SIMULATION			1
+
+/**
+ * the number of threads exploring the state space, 1 keeps the sequential DFS
+ * exploration (default is 1)
+ */
+#define FA_WORKER_THREADS					1
+
+/**
+ * share structurally equal roots among forest automata and reuse their
+ * connection signatures, 0 recomputes the signatures of all changed roots
+ * (default is 1)
+ */
+#define FA_ROOT_SHARING						1
+
 #endif /* CONFIG_H */
@@ -1058,6 +1058,19 @@ public:
 
 	}
 
+	// the signature of the root is already known (the root has not changed in
+	// a way visible to the connection graph)
+	void updateRoot(size_t root, const CutpointSignature& signature) {
+
+		assert(root < this->data.size());
+		assert(!this->data[root].valid);
+
+		this->data[root].signature = signature;
+
+		this->updateBackwardData(root);
+
+	}
+
 	void newRoot() {
 
 		this->data.push_back(RootInfo());
@@ -21,34 +21,80 @@
 #define EXECUTION_MANAGER_H
 
 #include <list>
-
+#include <map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <exception>
+
+#include "config.h"
+#include "sync.hh"
 #include "types.hh"
 #include "recycler.hh"
+#include "scheduling.hh"
 #include "abstractinstruction.hh"
 #include "fixpointinstruction.hh"
 #include "symstate.hh"
 
 class ExecutionManager {
 
+	// part of the manager owned by a single thread, the owner takes the states
+	// of the most urgent priority (in the order given by the policy) while idle
+	// workers steal the oldest ones
+	struct Worker {
+
+		// queued states by their priority
+		std::map<size_t, SymState::QueueType> queues;
+
+		Mutex queueMutex;
+
+		Recycler<SymState> stateRecycler;
+
+	};
+
 	SymState* root_;
 
-	SymState::QueueType queue_;
+	std::vector<std::unique_ptr<Worker>> workers_;
 
-	size_t statesExecuted_;
-	size_t tracesEvaluated_;
+	std::unique_ptr<SchedulingPolicy> policy_;
+
+	std::atomic<size_t> statesExecuted_;
+	std::atomic<size_t> tracesEvaluated_;
+
+	// the number of states which are either queued or being executed
+	std::atomic<size_t> pending_;
+
+	// the first failure of a worker (the others stop as soon as possible)
+	std::atomic<bool> stop_;
+	std::exception_ptr error_;
+	AbstractInstruction::StateType failed_;
 
 	Recycler<std::vector<Data>> registerRecycler_;
-	Recycler<SymState> stateRecycler_;
+
+	// guards the tree of states
+	Mutex treeMutex_;
+
+	// fixpoint instructions (and so the box database) are executed one at a time,
+	// fixpoints are also extended under this lock; it is never taken while
+	// treeMutex_ is held (a fixpoint instruction takes treeMutex_ to enqueue)
+	Mutex fixpointMutex_;
+
+	Mutex registerMutex_;
+	Mutex errorMutex_;
 
 	struct RecycleRegisterF {
 
 		Recycler<std::vector<Data>>& recycler_;
+		Mutex& mutex_;
 
-		RecycleRegisterF(Recycler<std::vector<Data>>& recycler)
-			: recycler_(recycler) {}
+		RecycleRegisterF(Recycler<std::vector<Data>>& recycler, Mutex& mutex)
+			: recycler_(recycler), mutex_(mutex) {}
 
 		void operator()(std::vector<Data>* x) {
 
+			MutexGuard guard(this->mutex_);
+
 			this->recycler_.recycle(x);
 
 		}
@@ -73,9 +119,214 @@ public:
 
 	};
 */
+	// index of the worker run by the current thread
+	static size_t& workerIndex() {
+
+		static __thread size_t index = 0;
+
+		return index;
+
+	}
+
+	// true while the current thread executes a fixpoint instruction
+	static bool& inFixpoint() {
+
+		static __thread bool flag = false;
+
+		return flag;
+
+	}
+
+	// fixpoint extensions collected while the tree is locked
+	typedef std::vector<std::pair<FixpointInstruction*, std::shared_ptr<const FAE>>>
+		ExtensionList;
+
+	// expects the tree to be unlocked
+	void extendFixpoints(const ExtensionList& extensions) {
+
+		if (extensions.empty())
+			return;
+
+		// a fixpoint instruction finishing a trace already holds the lock
+		std::unique_lock<Mutex> guard(this->fixpointMutex_, std::defer_lock);
+		if (!inFixpoint())
+			guard.lock();
+
+		for (auto& extension : extensions)
+			extension.first->extendFixpoint(extension.second);
+
+	}
+
+	Worker& worker() {
+
+		assert(workerIndex() < this->workers_.size());
+
+		return *this->workers_[workerIndex()];
+
+	}
+
+	SymState* push(SymState* parent, const std::shared_ptr<std::vector<Data>>& registers,
+		const std::shared_ptr<const FAE>& fae, AbstractInstruction* instr) {
+
+		Worker& worker = this->worker();
+
+		SymState* state = worker.stateRecycler.alloc();
+
+		size_t priority = this->policy_->priority(instr);
+
+		++this->pending_;
+
+		MutexGuard treeGuard(this->treeMutex_);
+		MutexGuard queueGuard(worker.queueMutex);
+
+		SymState::QueueType& queue = worker.queues[priority];
+
+		state->init(
+			parent,
+			instr,
+			fae,
+			queue.insert(queue.end(), std::make_pair(registers, state))
+		);
+
+		return state;
+
+	}
+
+	// takes a state of the most urgent priority (expects the worker to be locked)
+	static bool take(Worker& worker, bool lifo, AbstractInstruction::StateType& state) {
+
+		if (worker.queues.empty())
+			return false;
+
+		auto i = worker.queues.begin();
+
+		assert(!i->second.empty());
+
+		if (lifo) {
+			state = i->second.back();
+			i->second.pop_back();
+		} else {
+			state = i->second.front();
+			i->second.pop_front();
+		}
+
+		state.second->queueTag = SymState::QueueType::iterator();
+
+		if (i->second.empty())
+			worker.queues.erase(i);
+
+		return true;
+
+	}
+
+	bool steal(AbstractInstruction::StateType& state) {
+
+		for (size_t i = 1; i < this->workers_.size(); ++i) {
+
+			Worker& victim = *this->workers_[(workerIndex() + i) % this->workers_.size()];
+
+			MutexGuard guard(victim.queueMutex);
+
+			if (ExecutionManager::take(victim, false, state))
+				return true;
+
+		}
+
+		return false;
+
+	}
+
+	void work(size_t index) {
+
+		workerIndex() = index;
+
+		AbstractInstruction::StateType state;
+
+		while (!this->stop_ && this->pending_) {
+
+			if (!this->dequeue(state) && !this->steal(state)) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			try {
+
+				this->execute(state);
+
+			} catch (...) {
+
+				MutexGuard guard(this->errorMutex_);
+
+				if (!this->error_) {
+					this->error_ = std::current_exception();
+					this->failed_ = state;
+				}
+
+				this->stop_ = true;
+
+			}
+
+			--this->pending_;
+
+		}
+
+	}
+
+	// expects the tree to be locked, see extendFixpoints()
+	void releaseBranch(SymState* state, ExtensionList& extensions) {
+
+		assert(state);
+
+		if (state->busy) {
+			// the state is still being executed
+			state->finished = true;
+			return;
+		}
+
+		while (state->parent) {
+
+			assert(state->parent->children.size());
+
+			if (state->instr->getType() == fi_type_e::fiFix) {
+				extensions.push_back(
+					std::make_pair((FixpointInstruction*)state->instr, state->fae)
+				);
+			}
+//			f(state);
+
+			if (state->parent->children.size() > 1) {
+				state->recycle(this->worker().stateRecycler);
+				return;
+			}
+
+			if (state->parent->busy) {
+				// the parent may still get other children, continue once it is done
+				state->parent->finished = true;
+				state->recycle(this->worker().stateRecycler);
+				return;
+			}
+
+			state = state->parent;
+
+		}
+
+		assert(state == this->root_);
+
+		this->root_->recycle(this->worker().stateRecycler);
+		this->root_ = NULL;
+
+	}
+
 public:
 
-	ExecutionManager() : root_(NULL) {}
+	ExecutionManager() : root_(NULL), workers_(), policy_(new SchedulingPolicy()),
+		statesExecuted_(0), tracesEvaluated_(0),
+		pending_(0), stop_(false), error_(), failed_() {
+
+		for (size_t i = 0; i < FA_WORKER_THREADS; ++i)
+			this->workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+
+	}
 
 	~ExecutionManager() { this->clear(); }
 
@@ -86,85 +337,95 @@ public:
 	void clear() {
 
 		if (this->root_) {
-			this->root_->recycle(this->stateRecycler_);
+			this->root_->recycle(this->worker().stateRecycler);
 			this->root_ = NULL;
 		}
 
-		this->queue_.clear();
+		for (auto& worker : this->workers_)
+			worker->queues.clear();
 
 		this->statesExecuted_ = 0;
 		this->tracesEvaluated_ = 0;
+		this->pending_ = 0;
+		this->stop_ = false;
+		this->error_ = std::exception_ptr();
+		this->failed_ = AbstractInstruction::StateType();
 
 	}
 
 	SymState* enqueue(SymState* parent, const std::shared_ptr<std::vector<Data>>& registers,
 		const std::shared_ptr<const FAE>& fae, AbstractInstruction* instr) {
 
-		SymState* state = this->stateRecycler_.alloc();
-
-		state->init(
-			parent,
-			instr,
-			fae,
-			this->queue_.insert(this->queue_.end(), std::make_pair(registers, state))
-		);
-
-		return state;
+		return this->push(parent, registers, fae, instr);
 
 	}
 
 	SymState* enqueue(const AbstractInstruction::StateType& parent, AbstractInstruction* instr) {
 
-		SymState* state = this->stateRecycler_.alloc();
+		return this->push(parent.second, parent.first, parent.second->fae, instr);
 
-		state->init(
-			parent.second,
-			instr,
-			parent.second->fae,
-			this->queue_.insert(this->queue_.end(), std::make_pair(parent.first, state))
-		);
+	}
 
-		return state;
+	/**
+	 * @brief  Sets the scheduling policy
+	 *
+	 * @param[in]  policy  The policy (the manager takes its ownership)
+	 * @param[in]  code    The code the policy is prepared for
+	 */
+	void setPolicy(SchedulingPolicy* policy, const std::vector<AbstractInstruction*>& code) {
 
-	}
+		assert(policy);
 
-	bool dequeueBFS(AbstractInstruction::StateType& state) {
+		this->policy_.reset(policy);
+		this->policy_->init(code);
 
-		if (this->queue_.empty())
-			return false;
+	}
 
-		state = this->queue_.front();
+	bool dequeue(AbstractInstruction::StateType& state) {
 
-		this->queue_.pop_front();
+		Worker& worker = this->worker();
 
-		state.second->queueTag = this->queue_.end();
+		MutexGuard guard(worker.queueMutex);
 
-		return true;
+		return ExecutionManager::take(worker, this->policy_->lifo(), state);
 
 	}
 
-	bool dequeueDFS(AbstractInstruction::StateType& state) {
+	bool dequeueBFS(AbstractInstruction::StateType& state) {
 
-		if (this->queue_.empty())
-			return false;
+		Worker& worker = this->worker();
 
-		state = this->queue_.back();
+		MutexGuard guard(worker.queueMutex);
 
-		this->queue_.pop_back();
+		return ExecutionManager::take(worker, false, state);
 
-		state.second->queueTag = this->queue_.end();
+	}
 
-		return true;
+	bool dequeueDFS(AbstractInstruction::StateType& state) {
+
+		Worker& worker = this->worker();
+
+		MutexGuard guard(worker.queueMutex);
+
+		return ExecutionManager::take(worker, true, state);
 
 	}
 
 	std::shared_ptr<std::vector<Data>> allocRegisters(const std::vector<Data>& model) {
 
-		std::vector<Data>* v = this->registerRecycler_.alloc();
+		std::vector<Data>* v;
+
+		{
+			MutexGuard guard(this->registerMutex_);
+
+			v = this->registerRecycler_.alloc();
+		}
 
 		*v = model;
 
-		return std::shared_ptr<std::vector<Data>>(v, RecycleRegisterF(this->registerRecycler_));
+		return std::shared_ptr<std::vector<Data>>(
+			v, RecycleRegisterF(this->registerRecycler_, this->registerMutex_)
+		);
 
 	}
 
@@ -180,7 +441,73 @@ public:
 
 		++this->statesExecuted_;
 
-		state.second->instr->execute(*this, state);
+		{
+			MutexGuard guard(this->treeMutex_);
+
+			state.second->busy = true;
+		}
+
+		if (state.second->instr->getType() == fi_type_e::fiFix) {
+
+			MutexGuard guard(this->fixpointMutex_);
+
+			inFixpoint() = true;
+
+			try {
+				state.second->instr->execute(*this, state);
+			} catch (...) {
+				inFixpoint() = false;
+				throw;
+			}
+
+			inFixpoint() = false;
+
+		} else {
+
+			state.second->instr->execute(*this, state);
+
+		}
+
+		ExtensionList extensions;
+
+		{
+			MutexGuard guard(this->treeMutex_);
+
+			state.second->busy = false;
+
+			if (state.second->finished && state.second->children.empty())
+				this->releaseBranch(state.second, extensions);
+		}
+
+		this->extendFixpoints(extensions);
+
+	}
+
+	/**
+	 * @brief  Explores all queued states in parallel
+	 *
+	 * Runs FA_WORKER_THREADS workers (the calling thread being the first one)
+	 * until there is nothing left to explore. If a worker fails, the others
+	 * are stopped and the exception is rethrown here.
+	 *
+	 * @param[out]  state  The state whose execution failed (if any)
+	 */
+	void run(AbstractInstruction::StateType& state) {
+
+		std::vector<std::thread> threads;
+
+		for (size_t i = 1; i < this->workers_.size(); ++i)
+			threads.push_back(std::thread(&ExecutionManager::work, this, i));
+
+		this->work(0);
+
+		for (auto& thread : threads)
+			thread.join();
+
+		if (this->error_) {
+			state = this->failed_;
+			std::rethrow_exception(this->error_);
+		}
 
 	}
 
@@ -196,29 +523,15 @@ public:
 //	template <class F>
 	void destroyBranch(SymState* state/*, F f*/) {
 
-		assert(state);
+		ExtensionList extensions;
 
-		while (state->parent) {
-
-			assert(state->parent->children.size());
-
-			if (state->instr->getType() == fi_type_e::fiFix)
-				((FixpointInstruction*)state->instr)->extendFixpoint(state->fae);
-//			f(state);
-
-			if (state->parent->children.size() > 1) {
-				state->recycle(this->stateRecycler_);
-				return;
-			}
-
-			state = state->parent;
+		{
+			MutexGuard guard(this->treeMutex_);
 
+			this->releaseBranch(state, extensions);
 		}
 
-		assert(state == this->root_);
-
-		this->root_->recycle(this->stateRecycler_);
-		this->root_ = NULL;
+		this->extendFixpoints(extensions);
 
 	}
 
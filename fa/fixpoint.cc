@@ -222,33 +222,69 @@ inline void reorder(FAE& fae) {
 
 }
 
-inline bool testInclusion(FAE& fae, TA<label_type>& fwdConf, UFAE& fwdConfWrapper) {
+// FixpointBase
+bool FixpointBase::testInclusion(FAE& fae) {
 
-	TA<label_type> ta(*fwdConf.backend);
+	TA<label_type> ta(*this->fwdConf.backend);
 
 	Index<size_t> index;
 
 	fae.unreachableFree();
 
-	fwdConfWrapper.fae2ta(ta, index, fae);
+	this->fwdConfWrapper.fae2ta(ta, index, fae);
 
 //	CL_CDEBUG(3, "challenge:" << std::endl << ta);
-//	CL_CDEBUG(3, "response:" << std::endl << fwdConf);
+//	CL_CDEBUG(3, "response:" << std::endl << this->fwdConf);
 
-	if (TA<label_type>::subseteq(ta, fwdConf))
+	if (TA<label_type>::subseteq(ta, this->fwdConf)) {
+		++this->hits;
 		return true;
+	}
+
+	++this->extensions;
 
-	fwdConfWrapper.join(ta, index);
+	this->fwdConfWrapper.join(ta, index);
 
 	ta.clear();
 
-	fwdConf.minimized(ta);
-	fwdConf = ta;
+#if FA_INCREMENTAL_SIMULATION
+	// only states added by the join are new to the simulation
+	this->fwdConf.minimized(ta, this->fwdConfSim);
+#else
+	this->fwdConf.minimized(ta);
+#endif
+	this->fwdConf = ta;
 
 	return false;
 
 }
 
+void FixpointBase::countSubsumed(SymState* state) {
+
+	// the states executed since the previous fixpoint on the way to the state
+	// were of no use, each of them is counted only once (by the first trace
+	// going through it that gets subsumed)
+	for (SymState* s = state; s && !s->subsumed; s = s->parent) {
+
+		if ((s != state) && (s->instr->getType() == fi_type_e::fiFix))
+			break;
+
+		s->subsumed = true;
+
+		++this->subsumed;
+
+	}
+
+}
+
+void FixpointBase::getStats(size_t& hits, size_t& extensions, size_t& subsumed) const {
+
+	hits = this->hits;
+	extensions = this->extensions;
+	subsumed = this->subsumed;
+
+}
+
 struct CopyNonZeroRhsF {
 	bool operator()(const TT<label_type>* transition) const {
 
@@ -438,10 +474,12 @@ void FI_abs::execute(ExecutionManager& execMan, const AbstractInstruction::State
 	}
 
 	// test inclusion
-	if (testInclusion(*fae, this->fwdConf, this->fwdConfWrapper)) {
+	if (this->testInclusion(*fae)) {
 
 		CL_CDEBUG(3, "hit");
 
+		this->countSubsumed(state.second);
+
 		execMan.traceFinished(state.second);
 
 	} else {
@@ -502,10 +540,12 @@ void FI_fix::execute(ExecutionManager& execMan, const AbstractInstruction::State
 	}
 
 	// test inclusion
-	if (testInclusion(*fae, this->fwdConf, this->fwdConfWrapper)) {
+	if (this->testInclusion(*fae)) {
 
 		CL_CDEBUG(3, "hit");
 
+		this->countSubsumed(state.second);
+
 		execMan.traceFinished(state.second);
 
 	} else {
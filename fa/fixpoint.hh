@@ -39,12 +39,28 @@ protected:
 
 	UFAE fwdConfWrapper;
 
+	// downward simulation of fwdConf reused when fwdConf gets extended
+	TA<label_type>::SimulationSeed fwdConfSim;
+
 	std::vector<std::shared_ptr<const FAE>> fixpoint;
 
 	TA<label_type>::Backend& taBackend;
 
 	BoxMan& boxMan;
 
+	// the number of states subsumed by the fixpoint
+	size_t hits;
+
+	// the number of configurations which extended the fixpoint
+	size_t extensions;
+
+	// the number of executed states which led only to the subsumed ones
+	size_t subsumed;
+
+	bool testInclusion(FAE& fae);
+
+	void countSubsumed(struct SymState* state);
+
 public:
 
 	virtual void extendFixpoint(const std::shared_ptr<const FAE>& fae) {
@@ -56,12 +72,17 @@ public:
 		this->fixpoint.clear();
 		this->fwdConf.clear();
 		this->fwdConfWrapper.clear();
+		this->fwdConfSim.clear();
+		this->hits = 0;
+		this->extensions = 0;
+		this->subsumed = 0;
 
 	}
 
 	void recompute() {
 		this->fwdConf.clear();
 		this->fwdConfWrapper.clear();
+		this->fwdConfSim.clear();
 		TA<label_type> ta(*this->fwdConf.backend);
 		Index<size_t> index;
 
@@ -70,7 +91,7 @@ public:
 
 		if (!ta.getTransitions().empty()) {
 			this->fwdConfWrapper.adjust(index);
-			ta.minimized(this->fwdConf);
+			ta.minimized(this->fwdConf, this->fwdConfSim);
 		}
 //		this->fwdConfWrapper.setStateOffset(this->fixpointWrapper.getStateOffset());
 //		this->fwdConf = this->fixpoint;
@@ -82,7 +103,8 @@ public:
 		TA<label_type>::Backend& fixpointBackend, TA<label_type>::Backend& taBackend,
 		BoxMan& boxMan) :
 		FixpointInstruction(insn), fwdConf(fixpointBackend),
-		fwdConfWrapper(this->fwdConf, boxMan), taBackend(taBackend), boxMan(boxMan) {}
+		fwdConfWrapper(this->fwdConf, boxMan), fwdConfSim(), taBackend(taBackend), boxMan(boxMan),
+		hits(0), extensions(0), subsumed(0) {}
 
 	virtual ~FixpointBase() {}
 
@@ -90,6 +112,8 @@ public:
 		return this->fwdConf;
 	}
 
+	virtual void getStats(size_t& hits, size_t& extensions, size_t& subsumed) const;
+
 };
 
 class FI_abs : public FixpointBase {
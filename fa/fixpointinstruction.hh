@@ -40,6 +40,10 @@ public:
 
 	virtual const TA<label_type>& getFixPoint() const = 0;
 
+	// the number of states subsumed by the fixpoint, the number of its
+	// extensions and how many executed states led only to subsumed ones
+	virtual void getStats(size_t& hits, size_t& extensions, size_t& subsumed) const = 0;
+
 };
 
 #endif
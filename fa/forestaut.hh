@@ -36,6 +36,7 @@
 #include "label.hh"
 #include "abstractbox.hh"
 #include "connection_graph.hh"
+#include "rootpool.hh"
 
 class FA {
 
@@ -186,8 +187,60 @@ public:
 		this->roots.push_back(ta);
 	}
 
+	// recomputes the connection data of the changed roots, the signatures of
+	// roots seen before are taken from the pool
 	void updateConnectionGraph() const {
 
+		this->updateConnectionGraph(nullptr);
+
+	}
+
+	// as above, the changed roots are replaced by their shared instances
+	void updateConnectionGraph() {
+
+		this->updateConnectionGraph(&this->roots);
+
+	}
+
+	// all the roots are the same objects
+	bool sharesRoots(const FA& rhs) const {
+
+		return this->roots == rhs.roots;
+
+	}
+
+private:
+
+	void updateConnectionGraph(std::vector<std::shared_ptr<TA<label_type>>>* shared) const {
+
+		assert(this->connectionGraph.data.size() == this->roots.size());
+
+		for (size_t i = 0; i < this->roots.size(); ++i) {
+
+			if (this->connectionGraph.data[i].valid || !this->roots[i])
+				continue;
+
+			std::shared_ptr<TA<label_type>> root = this->roots[i];
+
+			RootPool::SignaturePtr signature = RootPool::intern(root);
+
+			if (signature) {
+
+				this->connectionGraph.updateRoot(i, *signature);
+
+			} else {
+
+				this->connectionGraph.updateRoot(i, *root);
+
+				RootPool::setSignature(root, this->connectionGraph.data[i].signature);
+
+			}
+
+			if (shared)
+				(*shared)[i] = root;
+
+		}
+
 		this->connectionGraph.updateIfNeeded(this->roots);
 
 	}
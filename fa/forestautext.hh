@@ -100,8 +100,14 @@ public:
 		if (lhs.connectionGraph.data != rhs.connectionGraph.data)
 			return false;
 
+		if (lhs.sharesRoots(rhs))
+			return true;
+
 		for (size_t i = 0; i < lhs.roots.size(); ++i) {
 
+			if (lhs.roots[i] == rhs.roots[i])
+				continue;
+
 			if (!TA<label_type>::subseteq(*lhs.roots[i], *rhs.roots[i]))
 				return false;
 
@@ -49,6 +49,10 @@ public:
 
 	virtual void execute(ExecutionManager&, const AbstractInstruction::StateType&);
 
+	virtual void getSuccessors(std::vector<AbstractInstruction*>& next) const {
+		next.push_back(this->next_);
+	}
+
 	virtual void finalize(
 		const std::unordered_map<const CodeStorage::Block*, AbstractInstruction*>& codeIndex,
 		std::vector<AbstractInstruction*>::const_iterator
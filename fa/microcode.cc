@@ -100,7 +100,14 @@ void FI_acc_sel::execute(ExecutionManager& execMan,
 
 	std::vector<FAE*> dst;
 
-	Splitting(*state.second->fae).isolateOne(dst, data.d_ref.root,
+#if FA_WORKER_THREADS > 1
+	// the heap may be shared with states run by other workers
+	const FAE fae(*state.second->fae);
+#else
+	const FAE& fae = *state.second->fae;
+#endif
+
+	Splitting(fae).isolateOne(dst, data.d_ref.root,
 		data.d_ref.displ + this->offset_);
 
 	for (auto fae : dst) {
@@ -125,7 +132,14 @@ void FI_acc_set::execute(ExecutionManager& execMan,
 
 	std::vector<FAE*> dst;
 
-	Splitting(*state.second->fae).isolateSet(
+#if FA_WORKER_THREADS > 1
+	// the heap may be shared with states run by other workers
+	const FAE fae(*state.second->fae);
+#else
+	const FAE& fae = *state.second->fae;
+#endif
+
+	Splitting(fae).isolateSet(
 		dst, data.d_ref.root, data.d_ref.displ + this->base_, this->offsets_
 	);
 
@@ -152,9 +166,16 @@ void FI_acc_all::execute(ExecutionManager& execMan,
 
 	std::vector<FAE*> dst;
 
-	Splitting(*state.second->fae).isolateSet(
+#if FA_WORKER_THREADS > 1
+	// the heap may be shared with states run by other workers
+	const FAE fae(*state.second->fae);
+#else
+	const FAE& fae = *state.second->fae;
+#endif
+
+	Splitting(fae).isolateSet(
 		dst, data.d_ref.root, 0,
-		state.second->fae->getType(data.d_ref.root)->getSelectors()
+		fae.getType(data.d_ref.root)->getSelectors()
 	);
 
 	for (auto fae : dst) {
@@ -264,9 +285,18 @@ void FI_get_greg::execute(ExecutionManager& execMan,
 void FI_set_greg::execute(ExecutionManager& execMan,
 	const AbstractInstruction::StateType& state) {
 
+#if FA_WORKER_THREADS > 1
+	// the heap may be shared with states run by other workers
+	std::shared_ptr<FAE> fae = std::shared_ptr<FAE>(new FAE(*state.second->fae));
+
+	VirtualMachine(*fae).varSet(this->dst_, (*state.first)[this->src_]);
+
+	execMan.enqueue(state.second, state.first, fae, this->next_);
+#else
 	VirtualMachine(*state.second->fae).varSet(this->dst_, (*state.first)[this->src_]);
 
 	execMan.enqueue(state, this->next_);
+#endif
 
 }
 
@@ -510,9 +540,18 @@ void FI_iadd::execute(ExecutionManager& execMan,
 void FI_check::execute(ExecutionManager& execMan,
 	const AbstractInstruction::StateType& state) {
 
+#if FA_WORKER_THREADS > 1
+	// the heap may be shared with states run by other workers
+	FAE fae(*state.second->fae);
+
+	fae.updateConnectionGraph();
+
+	Normalization(fae).check();
+#else
 	state.second->fae->updateConnectionGraph();
 
 	Normalization((FAE&)*state.second->fae).check();
+#endif
 
 	execMan.enqueue(state, this->next_);
 
@@ -51,6 +51,11 @@ public:
 		std::vector<AbstractInstruction*>::const_iterator
 	);
 
+	virtual void getSuccessors(std::vector<AbstractInstruction*>& next) const {
+		next.push_back(this->next_[0]);
+		next.push_back(this->next_[1]);
+	}
+
 	virtual std::ostream& toStream(std::ostream& os) const {
 		return os << "cjmp  \tr" << this->src_ << ", "
 			<< this->next_[0] << ", " << this->next_[1];
@@ -131,6 +136,13 @@ public:
 	virtual void execute(ExecutionManager& execMan,
 		const AbstractInstruction::StateType& state);
 
+	// a loaded return address is where the execution continues after a call
+	virtual void getSuccessors(std::vector<AbstractInstruction*>& next) const {
+		SequentialInstruction::getSuccessors(next);
+		if (this->data_.isNativePtr())
+			next.push_back((AbstractInstruction*)this->data_.d_native_ptr);
+	}
+
 	virtual std::ostream& toStream(std::ostream& os) const {
 		return os << "mov   \tr" << this->dst_ << ", " << this->data_;
 	}
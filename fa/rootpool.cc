@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "sync.hh"
+#include "rootpool.hh"
+
+RootPool::Stats RootPool::stats;
+
+// guards the pool and its statistics
+static Mutex poolMutex;
+
+// the number of entries which triggers the next removal of dead roots
+static size_t purgeLimit = 1024;
+
+std::unordered_map<const TA<label_type>*, RootPool::Entry>& RootPool::entries() {
+	static std::unordered_map<const TA<label_type>*, Entry> entries;
+	return entries;
+}
+
+std::unordered_multimap<size_t, const TA<label_type>*>& RootPool::index() {
+	static std::unordered_multimap<size_t, const TA<label_type>*> index;
+	return index;
+}
+
+void RootPool::erase(const TA<label_type>* root) {
+	auto i = entries().find(root);
+	if (i == entries().end())
+		return;
+	auto range = index().equal_range(i->second.hash);
+	for (auto j = range.first; j != range.second; ++j) {
+		if (j->second == root) {
+			index().erase(j);
+			break;
+		}
+	}
+	entries().erase(i);
+}
+
+void RootPool::purge() {
+	for (auto i = entries().begin(); i != entries().end(); ) {
+		if (!i->second.root.expired()) {
+			++i;
+			continue;
+		}
+		auto range = index().equal_range(i->second.hash);
+		for (auto j = range.first; j != range.second; ++j) {
+			if (j->second == i->first) {
+				index().erase(j);
+				break;
+			}
+		}
+		i = entries().erase(i);
+	}
+	purgeLimit = std::max(purgeLimit, 2*entries().size());
+}
+
+RootPool::SignaturePtr RootPool::intern(RootPtr& root) {
+	assert(root);
+	if (!FA_ROOT_SHARING)
+		return SignaturePtr();
+	size_t hash = hash_value(*root);
+	MutexGuard guard(poolMutex);
+	++RootPool::stats.lookups;
+	auto range = index().equal_range(hash);
+	for (auto i = range.first; i != range.second; ++i) {
+		const Entry& entry = entries().find(i->second)->second;
+		if (i->second == root.get()) {
+			// a dead root might have lived at the same address
+			if (entry.root.lock() != root)
+				continue;
+			if (entry.signature)
+				++RootPool::stats.signatures;
+			return entry.signature;
+		}
+		RootPtr shared = entry.root.lock();
+		if (!shared || !(*shared == *root))
+			continue;
+		++RootPool::stats.shared;
+		root = shared;
+		if (entry.signature)
+			++RootPool::stats.signatures;
+		return entry.signature;
+	}
+	if (entries().size() >= purgeLimit)
+		RootPool::purge();
+	// an address of a dead root might have been reused
+	RootPool::erase(root.get());
+	entries().insert(std::make_pair(root.get(), Entry(root, hash)));
+	index().insert(std::make_pair(hash, root.get()));
+	return SignaturePtr();
+}
+
+void RootPool::setSignature(const RootPtr& root, const ConnectionGraph::CutpointSignature& signature) {
+	if (!FA_ROOT_SHARING)
+		return;
+	MutexGuard guard(poolMutex);
+	auto i = entries().find(root.get());
+	if ((i == entries().end()) || (i->second.root.lock() != root))
+		return;
+	i->second.signature = SignaturePtr(new ConnectionGraph::CutpointSignature(signature));
+}
+
+void RootPool::clear() {
+	MutexGuard guard(poolMutex);
+	entries().clear();
+	index().clear();
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROOT_POOL_H
+#define ROOT_POOL_H
+
+#include <memory>
+#include <unordered_map>
+
+#include "types.hh"
+#include "treeaut.hh"
+#include "connection_graph.hh"
+
+// hash-consing of the roots of forest automata, structurally equal roots of
+// different heaps end up shared so that their connection data are computed
+// only once and equal heaps can be recognized by comparing pointers; the pool
+// only observes the roots, it never keeps any of them alive
+class RootPool {
+
+public:
+
+	typedef std::shared_ptr<TA<label_type>> RootPtr;
+	typedef std::shared_ptr<const ConnectionGraph::CutpointSignature> SignaturePtr;
+
+	struct Stats {
+
+		size_t lookups;
+		size_t shared;
+		size_t signatures;
+
+		Stats() : lookups(0), shared(0), signatures(0) {}
+
+	};
+
+private:
+
+	struct Entry {
+
+		std::weak_ptr<TA<label_type>> root;
+		size_t hash;
+		SignaturePtr signature;
+
+		Entry(const RootPtr& root, size_t hash) : root(root), hash(hash), signature() {}
+
+	};
+
+	static std::unordered_map<const TA<label_type>*, Entry>& entries();
+
+	static std::unordered_multimap<size_t, const TA<label_type>*>& index();
+
+	static void erase(const TA<label_type>* root);
+
+	static void purge();
+
+public:
+
+	static Stats stats;
+
+	// replaces root by an equal root from the pool (if there is one, otherwise
+	// root itself enters the pool) and returns the signature remembered for it
+	static SignaturePtr intern(RootPtr& root);
+
+	// remembers the signature of a root which has been interned before
+	static void setSignature(const RootPtr& root, const ConnectionGraph::CutpointSignature& signature);
+
+	// forgets all the roots
+	static void clear();
+
+};
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <cassert>
+
+#include "scheduling.hh"
+
+// executes states in the BFS order
+class BFSPolicy : public SchedulingPolicy {
+
+public:
+
+	virtual bool lifo() const { return false; }
+
+};
+
+// executes states in the reverse postorder of their instructions
+class RPOPolicy : public SchedulingPolicy {
+
+protected:
+
+	CodeOrder order_;
+
+public:
+
+	virtual void init(const std::vector<AbstractInstruction*>& code) {
+		this->order_.compute(code);
+	}
+
+	virtual size_t priority(const AbstractInstruction* instr) const {
+		return this->order_.rpo(instr);
+	}
+
+};
+
+// executes states of outer loops first so that their fixpoints grow before
+// the states of inner loops are explored, within a loop the states closest to
+// its head (in the reverse postorder) come first
+class FixpointPolicy : public RPOPolicy {
+
+public:
+
+	virtual size_t priority(const AbstractInstruction* instr) const {
+		return this->order_.depth(instr)*this->order_.size() + this->order_.rpo(instr);
+	}
+
+};
+
+SchedulingPolicy* SchedulingPolicy::create(const std::string& name) {
+
+	if (name == "dfs")
+		return new SchedulingPolicy();
+	if (name == "bfs")
+		return new BFSPolicy();
+	if (name == "rpo")
+		return new RPOPolicy();
+	if (name == "fixpoint")
+		return new FixpointPolicy();
+
+	return NULL;
+
+}
+
+void CodeOrder::compute(const std::vector<AbstractInstruction*>& code) {
+
+	this->rpo_.clear();
+	this->depth_.clear();
+
+	std::unordered_map<const AbstractInstruction*, std::vector<AbstractInstruction*>> succ, pred;
+
+	for (auto instr : code) {
+		std::vector<AbstractInstruction*>& next = succ[instr];
+		instr->getSuccessors(next);
+		for (auto s : next)
+			pred[s].push_back(instr);
+	}
+
+	// iterative DFS starting from the entry point, instructions which are not
+	// reachable from it are used as further roots in the code order
+	std::vector<const AbstractInstruction*> postorder;
+	std::vector<std::pair<AbstractInstruction*, size_t>> backEdges;
+	std::unordered_set<const AbstractInstruction*> visited, onStack;
+	std::vector<std::pair<AbstractInstruction*, size_t>> stack;
+
+	for (auto root : code) {
+
+		if (!visited.insert(root).second)
+			continue;
+
+		stack.push_back(std::make_pair(root, 0));
+		onStack.insert(root);
+
+		while (!stack.empty()) {
+
+			AbstractInstruction* instr = stack.back().first;
+			const std::vector<AbstractInstruction*>& next = succ[instr];
+
+			if (stack.back().second == next.size()) {
+				postorder.push_back(instr);
+				onStack.erase(instr);
+				stack.pop_back();
+				continue;
+			}
+
+			AbstractInstruction* s = next[stack.back().second++];
+
+			if (onStack.count(s)) {
+				backEdges.push_back(std::make_pair(instr, stack.back().second - 1));
+				continue;
+			}
+
+			if (!visited.insert(s).second)
+				continue;
+
+			stack.push_back(std::make_pair(s, 0));
+			onStack.insert(s);
+
+		}
+
+	}
+
+	for (size_t i = 0; i < postorder.size(); ++i)
+		this->rpo_[postorder[postorder.size() - i - 1]] = i;
+
+	// natural loops of the back edges, each head counts once
+	std::unordered_map<const AbstractInstruction*, std::unordered_set<const AbstractInstruction*>> loops;
+
+	for (auto& edge : backEdges) {
+
+		const AbstractInstruction* head = succ[edge.first][edge.second];
+		std::unordered_set<const AbstractInstruction*>& body = loops[head];
+		std::vector<const AbstractInstruction*> todo = { edge.first };
+
+		body.insert(head);
+
+		while (!todo.empty()) {
+
+			const AbstractInstruction* instr = todo.back();
+			todo.pop_back();
+
+			if (!body.insert(instr).second)
+				continue;
+
+			for (auto p : pred[instr])
+				todo.push_back(p);
+
+		}
+
+	}
+
+	for (auto& loop : loops) {
+		for (auto instr : loop.second)
+			++this->depth_[instr];
+	}
+
+}
+
+size_t CodeOrder::rpo(const AbstractInstruction* instr) const {
+
+	auto i = this->rpo_.find(instr);
+
+	assert(i != this->rpo_.end());
+
+	return i->second;
+
+}
+
+size_t CodeOrder::depth(const AbstractInstruction* instr) const {
+
+	auto i = this->depth_.find(instr);
+
+	return (i == this->depth_.end())?(0):(i->second);
+
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDULING_H
+#define SCHEDULING_H
+
+// Standard library headers
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+// Forester headers
+#include "abstractinstruction.hh"
+
+/**
+ * @file scheduling.hh
+ * SchedulingPolicy - the order in which queued symbolic states are executed
+ */
+
+/**
+ * @brief  A policy deciding which queued state is executed next
+ *
+ * Each state gets the priority of its instruction (states with lower values
+ * are executed first), states of the same priority are taken either in the
+ * LIFO or in the FIFO order. The default policy is the plain DFS.
+ */
+class SchedulingPolicy {
+
+public:
+
+	virtual ~SchedulingPolicy() {}
+
+	/**
+	 * @brief  Prepares the policy for the given code
+	 *
+	 * @param[in]  code  The compiled code (the entry point first)
+	 */
+	virtual void init(const std::vector<AbstractInstruction*>& code)
+	{
+		(void)code;
+	}
+
+	/**
+	 * @brief  Gets the priority of states at the given instruction
+	 */
+	virtual size_t priority(const AbstractInstruction* instr) const
+	{
+		(void)instr;
+
+		return 0;
+	}
+
+	/**
+	 * @brief  Are states of the same priority taken in the LIFO order?
+	 */
+	virtual bool lifo() const { return true; }
+
+	/**
+	 * @brief  Creates the policy of the given name
+	 *
+	 * Known names are @b dfs, @b bfs, @b rpo (reverse postorder of the
+	 * microcode) and @b fixpoint (states closest to the outermost fixpoint
+	 * first).
+	 *
+	 * @returns  The new policy, or NULL for an unknown name
+	 */
+	static SchedulingPolicy* create(const std::string& name);
+
+};
+
+/**
+ * @brief  Reverse postorder and loop nesting of the microcode
+ *
+ * Loops are identified by the back edges of a depth-first traversal of the
+ * control flow graph (the compiler places fixpoint instructions at their
+ * heads).
+ */
+class CodeOrder {
+
+	std::unordered_map<const AbstractInstruction*, size_t> rpo_;
+	std::unordered_map<const AbstractInstruction*, size_t> depth_;
+
+public:
+
+	void compute(const std::vector<AbstractInstruction*>& code);
+
+	size_t size() const { return this->rpo_.size(); }
+
+	size_t rpo(const AbstractInstruction* instr) const;
+
+	size_t depth(const AbstractInstruction* instr) const;
+
+};
+
+#endif
@@ -74,6 +74,14 @@ public:
 	 * @returns  The next instruction in the sequence
 	 */
 	AbstractInstruction* next() const { return this->next_; }
+
+	/**
+	 * @copydoc AbstractInstruction::getSuccessors
+	 */
+	virtual void getSuccessors(std::vector<AbstractInstruction*>& next) const
+	{
+		next.push_back(this->next_);
+	}
 };
 
 #endif
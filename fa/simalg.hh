@@ -478,28 +478,30 @@ public:
 			this->_delta1[a].buildVector(tmp2);
 			this->fastSplit(tmp2);
 		}
-		std::vector<std::vector<bool> > tmp[2];
-		tmp[0].resize(this->_lts->labels(), std::vector<bool>(this->_partition.size(), true));
-		tmp[1].resize(this->_lts->labels(), std::vector<bool>(this->_partition.size(), true));
+		// blocks having all (resp. none) of their states in delta1[a]
+		BitMatrix allPre(this->_lts->labels(), this->_relation.data().cols(), false);
+		BitMatrix noPre(this->_lts->labels(), this->_relation.data().cols(), false);
 		for (size_t a = 0; a < this->_lts->labels(); ++a) {
 			for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
+				bool all = true, none = true;
 				StateListElem* elem = (*i)->states();
 				do {
-					tmp[(this->_delta1[a].contains(elem->state()))?(1):(0)][a][(*i)->index()] = false;
+					if (this->_delta1[a].contains(elem->state()))
+						none = false;
+					else
+						all = false;
 					elem = elem->next();
 				} while (elem != (*i)->states());
+				allPre.set(a, (*i)->index(), all);
+				noPre.set(a, (*i)->index(), none);
 			}
 		}
 		for (size_t a = 0; a < this->_lts->labels(); ++a) {
 			for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
-				if (tmp[0][a][(*i)->index()]) {
-					for (std::vector<OLRTBlock*>::iterator j = this->_partition.begin(); j != this->_partition.end(); ++j) {
-						if (tmp[1][a][(*j)->index()])
-							this->_relation.data()[(*i)->index()][(*j)->index()] = false;
-					}
-				}
-			}			
-		}		
+				if (allPre[a][(*i)->index()])
+					this->_relation.data().rowAndNot((*i)->index(), noPre, a);
+			}
+		}
 		std::vector<std::vector<size_t> > post;
 //		for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
 		for (std::vector<OLRTBlock*>::reverse_iterator i = this->_partition.rbegin(); i != this->_partition.rend(); ++i) {
@@ -574,16 +576,23 @@ public:
 		return this->_relation;
 	}
 	
-	void buildRel(size_t size, std::vector<std::vector<bool> >& rel) const {
-		rel.clear();
-		rel.resize(size, std::vector<bool>(size));
+	void buildRel(size_t size, BitMatrix& rel) const {
+		rel = BitMatrix(size, false);
+		// states grouped by their blocks
+		std::vector<std::vector<size_t> > members(this->_relation.data().size());
+		for (size_t j = 0; j < size; ++j)
+			members[this->_index[j]->block()->index()].push_back(j);
 		for (size_t i = 0; i < size; ++i) {
-			size_t ii = this->_index[i]->block()->index();
-			for (size_t j = 0; j < size; ++j)
-				rel[i][j] = this->_relation.data()[ii][this->_index[j]->block()->index()];
+			this->_relation.data().forEachInRow(
+				this->_index[i]->block()->index(),
+				[&rel, &members, i](size_t b) {
+					for (std::vector<size_t>::const_iterator j = members[b].begin(); j != members[b].end(); ++j)
+						rel.set(i, *j);
+				}
+			);
 		}
 	}
-	
+
 	size_t buildIndex(std::vector<size_t>& index, size_t size) const {
 		size_t blockCount = 0;
 		std::vector<bool> tmp(this->_partition.size(), false);
@@ -38,6 +38,7 @@
 
 // Forester headers
 #include "forestautext.hh"
+#include "boxstore.hh"
 #include "symctx.hh"
 #include "executionmanager.hh"
 #include "fixpointinstruction.hh"
@@ -79,6 +80,10 @@ class SymExec::Engine {
 
 	ExecutionManager execMan;
 
+	std::string schedPolicy;
+
+	BoxStore boxStore;
+
 	bool dbgFlag;
 
 protected:
@@ -438,8 +443,12 @@ protected:
 
 		try
 		{	// expecting problems...
-			while (this->execMan.dequeueDFS(state))
-			{	// process all states in the DFS order
+#if FA_WORKER_THREADS > 1
+			// the workers do not print the states they run
+			this->execMan.run(state);
+#else
+			while (this->execMan.dequeue(state))
+			{	// process all states in the order given by the policy
 				if (state.second->instr->insn())
 				{	// in case current instruction IS an instruction
 					CL_CDEBUG(2, SSD_INLINE_COLOR(C_LIGHT_RED,
@@ -454,6 +463,7 @@ protected:
 				// run the state
 				this->execMan.execute(state);
 			}
+#endif
 
 			return true;
 		}
@@ -495,7 +505,7 @@ public:
 	 */
 	Engine() :
 		boxMan(), compiler_(this->fixpointBackend, this->taBackend, this->boxMan),
-		dbgFlag(false)
+		schedPolicy("dfs"), boxStore(), dbgFlag(false)
 	{ }
 
 	/**
@@ -510,8 +520,12 @@ public:
 	{
 		CL_DEBUG_AT(3, "loading types ...");
 
-		// clear the box manager
+		// clear the box manager (labels are about to be freed, so are the cached
+		// inclusion results that refer to them)
 		this->boxMan.clear();
+		TA<label_type>::clearInclusionCache();
+		RootPool::clear();
+		this->boxStore.clear();
 
 		for (auto type : stor.types)
 		{	// for each data type in the storage
@@ -564,23 +578,46 @@ public:
 		}
 	}
 
-#if 0
-	void loadBoxes(const std::unordered_map<std::string, std::string>& db) {
-
+	/**
+	 * @brief  Loads boxes learned by previous runs
+	 *
+	 * Loads the boxes stored in the given box database, the boxes learned by
+	 * this run are appended to the database once the run ends. The types need
+	 * to be loaded already.
+	 *
+	 * @param[in]  path  The file with the box database
+	 */
+	void loadBoxes(const std::string& path)
+	{
 		CL_DEBUG_AT(2, "loading boxes ...");
 
-		for (auto p : db) {
-
-			this->boxes.push_back((const Box*)this->boxMan.loadBox(p.first, db));
+		size_t count = this->boxStore.load(path, this->boxMan, this->taBackend);
 
-			CL_DEBUG(p.first << ':' << std::endl << *(const FA*)this->boxes.back());
+		CL_DEBUG_AT(1, "loaded " << count << " box(es) from " << path);
+	}
 
-		}
+	/**
+	 * @brief  Stores the boxes learned by this run
+	 *
+	 * Appends the boxes which are not in the box database yet to the database.
+	 * Failing to do so does not affect the result of the analysis.
+	 */
+	void storeBoxes()
+	{
+		if (!this->boxStore.isOpen())
+			return;
 
-		this->boxMan.buildBoxHierarchy(this->hierarchy, this->basicBoxes);
+		try
+		{
+			size_t count = this->boxStore.save(this->boxMan);
 
+			CL_DEBUG_AT(1, "stored " << count << " box(es) to " << this->boxStore.path());
+		}
+		catch (std::exception& e)
+		{
+			CL_WARN(e.what());
+		}
 	}
-#endif
 
 	void compile(const CodeStorage::Storage& stor, const CodeStorage::Fnc& entry)
 	{
@@ -594,6 +631,10 @@ public:
 		// Assertions
 		assert(this->assembly_.code_.size());
 
+		this->execMan.setPolicy(
+			SchedulingPolicy::create(this->schedPolicy), this->assembly_.code_
+		);
+
 		try
 		{	// expect problems...
 			while (!this->main())
@@ -623,7 +664,54 @@ public:
 			CL_DEBUG_AT(1, "forester has evaluated " << this->execMan.statesEvaluated()
 				<< " state(s) in " << this->execMan.tracesEvaluated() << " trace(s) using "
 				<< this->boxMan.boxDatabase().size() << " box(es)");
+			CL_DEBUG_AT(1, "TA inclusion cache: "
+				<< TA<label_type>::inclusionCacheStats.hits << " hit(s), "
+				<< TA<label_type>::inclusionCacheStats.misses << " miss(es)");
+			CL_DEBUG_AT(1, "box database: "
+				<< this->boxMan.boxDatabase().stats().comparisons << " box comparison(s), "
+				<< this->boxMan.boxDatabase().stats().filtered << " decided without inclusion checks");
+			CL_DEBUG_AT(1, "root pool: " << RootPool::stats.lookups << " lookup(s), "
+				<< RootPool::stats.shared << " shared root(s), "
+				<< RootPool::stats.signatures << " reused signature(s)");
+
+			NodePool::Stats poolStats;
+			this->taBackend.lhsCache.getPoolStats(poolStats);
+			this->taBackend.transCache.getPoolStats(poolStats);
+			this->fixpointBackend.lhsCache.getPoolStats(poolStats);
+			this->fixpointBackend.transCache.getPoolStats(poolStats);
+			CL_DEBUG_AT(1, "allocation: " << poolStats.nodes << " pooled node(s) ("
+				<< poolStats.reused << " recycled) in " << poolStats.slabs << " slab(s), "
+				<< Arena::stats().arenas << " arena(s) serving " << Arena::stats().bytes
+				<< " byte(s) with " << Arena::stats().blocks << " extra block(s)");
+
+			if (cl_debug_level() >= 1)
+			{
+				size_t hits = 0, extensions = 0, subsumed = 0;
 
+				for (auto instr : this->assembly_.code_)
+				{
+					if (instr->getType() != fi_type_e::fiFix)
+					{
+						continue;
+					}
+
+					size_t h, e, s;
+
+					static_cast<FixpointInstruction*>(instr)->getStats(h, e, s);
+
+					hits += h;
+					extensions += e;
+					subsumed += s;
+				}
+
+				CL_DEBUG("scheduling (" << this->schedPolicy << "): " << hits
+					<< " state(s) subsumed by fixpoints, " << subsumed << " of "
+					<< this->execMan.statesEvaluated() << " executed state(s) led "
+					<< "only to subsumed ones, " << extensions
+					<< " fixpoint extension(s)");
+			}
+
+			this->storeBoxes();
 		}
 		catch (std::exception& e)
 		{
@@ -631,6 +719,9 @@ public:
 
 			this->printBoxes();
 
+			// the boxes are valid no matter what the verdict is
+			this->storeBoxes();
+
 			throw;
 		}
 	}
@@ -659,6 +750,16 @@ public:
 		this->dbgFlag = 1;
 	}
 
+	void setSchedulingPolicy(const std::string& name)
+	{
+		std::unique_ptr<SchedulingPolicy> policy(SchedulingPolicy::create(name));
+
+		if (!policy)
+			throw std::runtime_error("unknown scheduling policy: " + name);
+
+		this->schedPolicy = name;
+	}
+
 };
 
 SymExec::SymExec() :
@@ -681,11 +782,13 @@ void SymExec::loadTypes(const CodeStorage::Storage& stor)
 	this->engine->loadTypes(stor);
 }
 
-#if 0
-void SymExec::loadBoxes(const std::unordered_map<std::string, std::string>& db) {
-	this->engine->loadBoxes(db);
+void SymExec::loadBoxes(const std::string& path)
+{
+	// Assertions
+	assert(engine != nullptr);
+
+	this->engine->loadBoxes(path);
 }
-#endif
 
 void SymExec::compile(const CodeStorage::Storage& stor,
 	const CodeStorage::Fnc& main)
@@ -719,3 +822,11 @@ void SymExec::setDbgFlag()
 
 	this->engine->setDbgFlag();
 }
+
+void SymExec::setSchedulingPolicy(const std::string& name)
+{
+	// Assertions
+	assert(engine != nullptr);
+
+	this->engine->setSchedulingPolicy(name);
+}
@@ -21,6 +21,7 @@
 #define SYM_EXEC_H
 
 // Standard library headers
+#include <string>
 #include <unordered_map>
 
 // Forester headers
@@ -69,7 +70,16 @@ public:
 	 */
 	void loadTypes(const CodeStorage::Storage& stor);
 
-//	void loadBoxes(const std::unordered_map<std::string, std::string>& db);
+	/**
+	 * @brief  Loads boxes from a box database
+	 *
+	 * Loads the boxes learned by previous runs from the given file (a missing
+	 * file denotes an empty database). The boxes learned by this run are
+	 * appended to the file at its end. The types need to be loaded first.
+	 *
+	 * @param[in]  path  The file with the box database
+	 */
+	void loadBoxes(const std::string& path);
 
 	/**
 	 * @brief  Compiles the code from code storage
@@ -105,6 +115,16 @@ public:
 	 */
 	void setDbgFlag();
 
+	/**
+	 * @brief  Sets the order in which symbolic states are executed
+	 *
+	 * Selects one of the scheduling policies (@b dfs, @b bfs, @b rpo or
+	 * @b fixpoint), see SchedulingPolicy::create().
+	 *
+	 * @param[in]  name  The name of the policy
+	 */
+	void setSchedulingPolicy(const std::string& name);
+
 private:
 
 	class Engine;
@@ -92,6 +92,17 @@ struct SymState {
 	/// @todo: write dox
 	void* payload;
 
+	/// Set while the state is being executed (its children may still grow)
+	bool busy;
+
+	/// Set when the branch ending in the state is to be destroyed as soon as
+	/// the state is not busy
+	bool finished;
+
+	/// Set when a trace going through the state has been subsumed by a fixpoint
+	/// before reaching any other fixpoint (see FixpointBase::countSubsumed())
+	bool subsumed;
+
 	/**
 	 * @brief  Constructor
 	 *
@@ -158,6 +169,9 @@ struct SymState {
 		this->instr = instr;
 		this->fae = fae;
 		this->queueTag = queueTag;
+		this->busy = false;
+		this->finished = false;
+		this->subsumed = false;
 		if (this->parent)
 			this->parent->addChild(this);
 	}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of forester.
+ *
+ * forester is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * forester is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with forester.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <mutex>
+
+#include "config.h"
+
+// locks shared by the worker threads of the execution manager, they do
+// nothing at all when forester runs single-threaded
+#if FA_WORKER_THREADS > 1
+
+typedef std::mutex Mutex;
+
+#else
+
+struct Mutex {
+
+	void lock() {}
+
+	void unlock() {}
+
+	bool try_lock() { return true; }
+
+};
+
+#endif
+
+typedef std::lock_guard<Mutex> MutexGuard;
+
+#endif
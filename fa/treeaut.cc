@@ -26,6 +26,8 @@
 
 #include <boost/unordered_map.hpp>
 
+#include "config.h"
+#include "cache.hh"
 #include "treeaut.hh"
 #include "simalg.hh"
 #include "antichainext.hh"
@@ -60,7 +62,7 @@ struct LhsEnv {
 		return x;
 	}
 
-	static bool sim(const LhsEnv& e1, const LhsEnv& e2, const vector<vector<bool> >& sim) {
+	static bool sim(const LhsEnv& e1, const LhsEnv& e2, const BitMatrix& sim) {
 		if ((e1.index != e2.index) || (e1.data.size() != e2.data.size()))
 			return false;
 		for (size_t i = 0; i < e1.data.size(); ++i) {
@@ -70,7 +72,7 @@ struct LhsEnv {
 		return true;
 	}
 
-	static bool eq(const LhsEnv& e1, const LhsEnv& e2, const vector<vector<bool> >& sim) {
+	static bool eq(const LhsEnv& e1, const LhsEnv& e2, const BitMatrix& sim) {
 		if ((e1.index != e2.index) || (e1.data.size() != e2.data.size()))
 			return false;
 		for (size_t i = 0; i < e1.data.size(); ++i) {
@@ -132,11 +134,11 @@ struct Env {
 		return x;
 	}
 
-	static bool sim(const Env& e1, const Env& e2, const vector<vector<bool> >& sim) {
+	static bool sim(const Env& e1, const Env& e2, const BitMatrix& sim) {
 		return (e1.label == e2.label) && LhsEnv::sim(*e1.lhs, *e2.lhs, sim);
 	}
 	
-	static bool eq(const Env& e1, const Env& e2, const vector<vector<bool> >& sim) {
+	static bool eq(const Env& e1, const Env& e2, const BitMatrix& sim) {
 		return (e1.label == e2.label) && LhsEnv::eq(*e1.lhs, *e2.lhs, sim);
 	}
 
@@ -164,12 +166,12 @@ void TA<T>::downwardTranslation(LTS& lts, const Index<size_t>& stateIndex, const
 		for (size_t j = 0; j < i->first->size(); ++j)
 			lts.addTransition(stateIndex.size() + i->second, labelIndex.size() + j, stateIndex[(*i->first)[j]]);
 	}
-	for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+	for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 		lts.addTransition(stateIndex[(*i)->first._rhs], labelIndex[(*i)->first._label], stateIndex.size() + lhs[&((*i)->first._lhs->first)]);
 }
 
 template <class T>
-void TA<T>::downwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& stateIndex) const {
+void TA<T>::downwardSimulation(BitMatrix& rel, const Index<size_t>& stateIndex) const {
 	LTS lts;
 	Index<T> labelIndex;
 	this->buildLabelIndex(labelIndex);
@@ -181,12 +183,33 @@ void TA<T>::downwardSimulation(vector<vector<bool> >& rel, const Index<size_t>&
 }
 
 template <class T>
-void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const vector<vector<bool> >& sim) const {
+void TA<T>::downwardSimulation(BitMatrix& rel, const Index<size_t>& stateIndex, const vector<vector<size_t> >& part, const BitMatrix& partRel) const {
+	LTS lts;
+	Index<T> labelIndex;
+	this->buildLabelIndex(labelIndex);
+	this->downwardTranslation(lts, stateIndex, labelIndex);
+	OLRTAlgorithm alg(lts);
+	for (size_t i = 0; i < part.size(); ++i)
+		alg.fakeSplit(part[i]);
+	vector<size_t> blockIndex;
+	BitMatrix initRel(alg.buildIndex(blockIndex, lts.states()), true);
+	for (size_t i = 0; i < part.size(); ++i) {
+		for (size_t j = 0; j < part.size(); ++j)
+			initRel[blockIndex[part[i].front()]][blockIndex[part[j].front()]] = partRel[i][j];
+	}
+	alg.getRelation().load(initRel);
+	alg.init();
+	alg.run();
+	alg.buildRel(stateIndex.size(), rel);
+}
+
+template <class T>
+void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, BitMatrix& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const BitMatrix& sim) const {
 	set<LhsEnv> lhsEnvSet;
 	map<Env, size_t> envMap;
 	vector<const Env*> head;
 	part.clear();
-	for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+	for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 		vector<size_t> lhs;
 		stateIndex.translate(lhs, (*i)->first._lhs->first);
 		size_t label = labelIndex[(*i)->first._label];
@@ -212,7 +235,7 @@ void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, vector<ve
 		}
 	}
 	lts = LTS(labelIndex.size() + 1, stateIndex.size() + envMap.size());
-	for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+	for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 		vector<size_t> lhs;
 		stateIndex.translate(lhs, (*i)->first._lhs->first);
 		size_t label = labelIndex[(*i)->first._label];
@@ -224,7 +247,7 @@ void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, vector<ve
 			lts.addTransition(env->second, label, rhs);
 		}
 	}
-	rel = vector<vector<bool> >(part.size() + 2, vector<bool>(part.size() + 2, false));
+	rel = BitMatrix(part.size() + 2, false);
 	// 0 non-accepting, 1 accepting, 2 .. environments
 	rel[0][0] = true;
 	rel[0][1] = true;
@@ -238,12 +261,12 @@ void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, vector<ve
 }
 
 template <class T>
-void TA<T>::upwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const vector<vector<bool> >& param) const {
+void TA<T>::upwardSimulation(BitMatrix& rel, const Index<size_t>& stateIndex, const BitMatrix& param) const {
 	LTS lts;
 	Index<T> labelIndex;
 	this->buildLabelIndex(labelIndex);
 	std::vector<std::vector<size_t> > part;
-	std::vector<std::vector<bool> > initRel;
+	BitMatrix initRel;
 	this->upwardTranslation(lts, part, initRel, stateIndex, labelIndex, param);
 	OLRTAlgorithm alg(lts);
 	// accepting states to block 1
@@ -259,10 +282,116 @@ void TA<T>::upwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& st
 	alg.buildRel(stateIndex.size(), rel);
 }
 
+// orders transitions by (rhs, lhs, label), renaming the states while keeping
+// their order does not change the result of the comparison
+template <class T>
+struct CanonicalTransCmp {
+
+	template <class TransPtr>
+	bool operator()(TransPtr a, TransPtr b) const {
+		if (a->first._rhs != b->first._rhs)
+			return a->first._rhs < b->first._rhs;
+		if (a->first._lhs->first != b->first._lhs->first)
+			return a->first._lhs->first < b->first._lhs->first;
+		return a->first._label < b->first._label;
+	}
+
+};
+
+template <class T>
+void TA<T>::buildCanonicalKey(CanonicalKey& key, CanonicalScratch& scratch) const {
+	// all the states in ascending order, a state is renamed to its position
+	vector<size_t>& states = scratch.states;
+	states.clear();
+	for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		states.push_back((*i)->first._rhs);
+		states.insert(states.end(), (*i)->first._lhs->first.begin(), (*i)->first._lhs->first.end());
+	}
+	std::sort(states.begin(), states.end());
+	states.erase(std::unique(states.begin(), states.end()), states.end());
+	vector<typename TransSet::value_type>& trans = scratch.trans;
+	trans.assign(this->transitions.begin(), this->transitions.end());
+	std::sort(trans.begin(), trans.end(), CanonicalTransCmp<T>());
+	key.labels.clear();
+	key.states.clear();
+	for (typename vector<typename TransSet::value_type>::const_iterator i = trans.begin(); i != trans.end(); ++i) {
+		const vector<size_t>& lhs = (*i)->first._lhs->first;
+		key.labels.push_back((*i)->first._label);
+		key.states.push_back(1 + lhs.size());
+		key.states.push_back(std::lower_bound(states.begin(), states.end(), (*i)->first._rhs) - states.begin());
+		for (vector<size_t>::const_iterator j = lhs.begin(); j != lhs.end(); ++j)
+			key.states.push_back(std::lower_bound(states.begin(), states.end(), *j) - states.begin());
+	}
+	// final states go last
+	for (set<size_t>::const_iterator i = this->finalStates.begin(); i != this->finalStates.end(); ++i)
+		key.states.push_back(std::lower_bound(states.begin(), states.end(), *i) - states.begin());
+}
+
+template <class T>
+typename TA<T>::InclusionCacheStats TA<T>::inclusionCacheStats;
+
+template <class T>
+static LRUCache<pair<typename TA<T>::CanonicalKey, typename TA<T>::CanonicalKey>, bool>& inclusionCache() {
+	static LRUCache<pair<typename TA<T>::CanonicalKey, typename TA<T>::CanonicalKey>, bool> cache(FA_INCLUSION_CACHE_SIZE);
+	return cache;
+}
+
+// guards the inclusion cache and its statistics
+static Mutex inclusionCacheMutex;
+
+// per-thread buffers of TA<T>::subseteq(), never released
+template <class T>
+struct InclusionScratch {
+
+	pair<typename TA<T>::CanonicalKey, typename TA<T>::CanonicalKey> key;
+	typename TA<T>::CanonicalScratch canon;
+
+};
+
 template <class T>
 bool TA<T>::subseteq(const TA<T>& a, const TA<T>& b) {
 //	std::cout << "TA::subseteq()\n";
-	return AntichainExt<T>::subseteq(a, b);
+	if (&a == &b)
+		return true;
+	if (!FA_INCLUSION_CACHE_SIZE)
+		return AntichainExt<T>::subseteq(a, b);
+	if ((a.transitions == b.transitions) && (a.finalStates == b.finalStates)) {
+		MutexGuard guard(inclusionCacheMutex);
+		++TA<T>::inclusionCacheStats.hits;
+		return true;
+	}
+	// the lookup key lives in per-thread buffers, a key is only allocated
+	// when it gets stored on a miss
+	static __thread InclusionScratch<T>* scratch = NULL;
+	if (!scratch)
+		scratch = new InclusionScratch<T>;
+	pair<CanonicalKey, CanonicalKey>& key = scratch->key;
+	a.buildCanonicalKey(key.first, scratch->canon);
+	b.buildCanonicalKey(key.second, scratch->canon);
+	if (key.first == key.second) {
+		MutexGuard guard(inclusionCacheMutex);
+		++TA<T>::inclusionCacheStats.hits;
+		return true;
+	}
+	{
+		MutexGuard guard(inclusionCacheMutex);
+		const bool* result = inclusionCache<T>().find(key);
+		if (result) {
+			++TA<T>::inclusionCacheStats.hits;
+			return *result;
+		}
+		++TA<T>::inclusionCacheStats.misses;
+	}
+	bool x = AntichainExt<T>::subseteq(a, b);
+	MutexGuard guard(inclusionCacheMutex);
+	inclusionCache<T>().insert(key, x);
+	return x;
+}
+
+template <class T>
+void TA<T>::clearInclusionCache() {
+	MutexGuard guard(inclusionCacheMutex);
+	inclusionCache<T>().clear();
 }
 
 // this is really sad :-(
@@ -30,6 +30,7 @@
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 
+#include "bitmatrix.hh"
 #include "cache.hh"
 #include "utils.hh"
 #include "lts.hh"
@@ -165,7 +166,7 @@ public:
 
 	~TT() { this->lhsCache.release(this->_lhs);	}
 
-	bool llhsLessThan(const TT& rhs, const std::vector<std::vector<bool> >& cons, const Index<size_t>& stateIndex) const {
+	bool llhsLessThan(const TT& rhs, const BitMatrix& cons, const Index<size_t>& stateIndex) const {
 		if (this->_label != rhs._label)
 			return false;
 		for (size_t i = 0; i < this->_lhs->first.size(); ++i) {
@@ -217,13 +218,83 @@ public:
 
 	Backend* backend;
 
+	// scratch containers of a single algorithm, they live in its arena
+	typedef std::set<size_t, std::less<size_t>, ArenaAllocator<size_t> > arena_state_set;
+	typedef std::vector<typename trans_cache_type::value_type*, ArenaAllocator<typename trans_cache_type::value_type*> > arena_trans_vector;
+
 	struct CmpF {
 		bool operator()(typename trans_cache_type::value_type* lhs, typename trans_cache_type::value_type* rhs) const {
 			return lhs->first < rhs->first;
 		}
 	};
 
-	typedef std::set<typename trans_cache_type::value_type*, CmpF> trans_set_type;
+	// transitions are kept in a contiguous array ordered by (rhs, label, lhs),
+	// the right-hand sides are mirrored in a parallel array so that lookups by
+	// rhs do not need to dereference the transition cache at all
+	class TransSet {
+
+	public:
+
+		typedef typename trans_cache_type::value_type* value_type;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+		typedef const_iterator iterator;
+
+	private:
+
+		std::vector<value_type> _trans;
+		std::vector<size_t> _rhs;
+
+		size_t lowerIndex(size_t rhs) const {
+			return std::lower_bound(this->_rhs.begin(), this->_rhs.end(), rhs) - this->_rhs.begin();
+		}
+
+		size_t upperIndex(size_t rhs) const {
+			return std::upper_bound(this->_rhs.begin(), this->_rhs.end(), rhs) - this->_rhs.begin();
+		}
+
+	public:
+
+		const_iterator begin() const { return this->_trans.begin(); }
+		const_iterator end() const { return this->_trans.end(); }
+
+		size_t size() const { return this->_trans.size(); }
+
+		bool empty() const { return this->_trans.empty(); }
+
+		void clear() {
+			this->_trans.clear();
+			this->_rhs.clear();
+		}
+
+		const_iterator lower_bound(size_t rhs) const {
+			return this->_trans.begin() + this->lowerIndex(rhs);
+		}
+
+		const_iterator upper_bound(size_t rhs) const {
+			return this->_trans.begin() + this->upperIndex(rhs);
+		}
+
+		std::pair<const_iterator, bool> insert(value_type x) {
+			size_t rhs = x->first._rhs;
+			typename std::vector<value_type>::iterator first = this->_trans.begin() + this->lowerIndex(rhs);
+			typename std::vector<value_type>::iterator last = this->_trans.begin() + this->upperIndex(rhs);
+			// only transitions sharing the rhs need to be compared by value
+			typename std::vector<value_type>::iterator i = std::lower_bound(first, last, x, CmpF());
+			if ((i != last) && !CmpF()(x, *i))
+				return std::make_pair(const_iterator(i), false);
+			this->_rhs.insert(this->_rhs.begin() + (i - this->_trans.begin()), rhs);
+			return std::make_pair(const_iterator(this->_trans.insert(i, x)), true);
+		}
+
+		// transitions are shared within a backend and kept sorted, so equal sets
+		// consist of the same pointers in the same order
+		bool operator==(const TransSet& rhs) const {
+			return this->_trans == rhs._trans;
+		}
+
+	};
+
+	typedef TransSet trans_set_type;
 
 	typename TT<T>::lhs_cache_type& lhsCache() const { return this->backend->lhsCache; }
 
@@ -348,7 +419,7 @@ public:
 		transitions(ta.transitions) {
 		if (copyFinalStates)
 			this->finalStates = ta.finalStates;
-		for (typename std::set<typename trans_cache_type::value_type*>::iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			this->transCache().addRef(*i);
 	}
 
@@ -358,7 +429,7 @@ public:
 		transitions() {
 		if (copyFinalStates)
 			this->finalStates = ta.finalStates;
-		for (typename std::set<typename trans_cache_type::value_type*>::iterator i = ta.transitions.begin(); i != ta.transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = ta.transitions.begin(); i != ta.transitions.end(); ++i) {
 			if (f(&(*i)->first))
 				this->addTransition(*i);
 		}
@@ -370,12 +441,7 @@ public:
 	typename TA<T>::Iterator end() const { return typename TA<T>::Iterator(this->transitions.end()); }
 
 	typename trans_set_type::const_iterator _lookup(size_t rhs) const {
-		char buffer[sizeof(std::pair<const TT<T>, size_t>)];
-		std::pair<const TT<T>, size_t>* tPtr = (std::pair<const TT<T>, size_t>*)buffer;
-		new (reinterpret_cast<TTBase<T>*>(const_cast<TT<T>*>(&tPtr->first))) TTBase<T>(NULL, T(), rhs);
-		typename trans_set_type::const_iterator i = this->transitions.lower_bound(tPtr);
-		((TTBase<T>*)&tPtr->first)->~TTBase();
-		return i;
+		return this->transitions.lower_bound(rhs);
 	}
 
 	typename TA<T>::Iterator begin(size_t rhs) const {
@@ -383,14 +449,11 @@ public:
 	}
 
 	typename TA<T>::Iterator end(size_t rhs) const {
-		typename TA<T>::Iterator i = this->begin(rhs);
-		for (; i != this->end() && i->rhs() == rhs; ++i);
-		return Iterator(i);
+		return Iterator(this->transitions.upper_bound(rhs));
 	}
 
-	typename TA<T>::Iterator end(size_t rhs, typename TA<T>::Iterator i) const {
-		for (; i != this->end() && i->rhs() == rhs; ++i);
-		return Iterator(i);
+	typename TA<T>::Iterator end(size_t rhs, typename TA<T>::Iterator /* i */) const {
+		return this->end(rhs);
 	}
 
 	typename TA<T>::Iterator accBegin() const {
@@ -430,15 +493,27 @@ public:
 		this->backend = rhs.backend;
 		this->transitions = rhs.transitions;
 		this->finalStates = rhs.finalStates;
-		for (typename set<typename trans_cache_type::value_type*>::iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			this->transCache().addRef(*i);
 		return *this;
 	}
 
+	// structural equality of automata over the same backend
+	bool operator==(const TA<T>& rhs) const {
+		return (this->backend == rhs.backend) && (this->finalStates == rhs.finalStates)
+			&& (this->transitions == rhs.transitions);
+	}
+
+	friend size_t hash_value(const TA<T>& ta) {
+		size_t h = boost::hash_range(ta.transitions.begin(), ta.transitions.end());
+		boost::hash_combine(h, boost::hash_range(ta.finalStates.begin(), ta.finalStates.end()));
+		return h;
+	}
+
 	void clear() {
 		this->maxRank = 0;
 		this->next_state = 0;
-		for (typename set<typename trans_cache_type::value_type*>::iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			this->transCache().release(*i);
 		this->transitions.clear();
 		this->finalStates.clear();
@@ -455,12 +530,12 @@ public:
 
 	void updateStateCounter() {
 		this->next_state = 0;
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			this->next_state = std::max(this->next_state, 1 + std::max((*i)->first._rhs, *std::max_element((*i)->first._lhs->first.begin(), (*i)->first._lhs->first.end())));
 	}
 
 	void buildStateIndex(Index<size_t>& index) const {
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			for (vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j)
 				index.add(*j);
 			index.add((*i)->first._rhs);
@@ -470,19 +545,20 @@ public:
 	}
 
 	void buildSortedStateIndex(Index<size_t>& index) const {
-		std::set<size_t> s;
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		Arena arena;
+		arena_state_set s(std::less<size_t>(), arena);
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			for (std::vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j)
 				s.insert(*j);
 			s.insert((*i)->first._rhs);
 		}
 		s.insert(this->finalStates.begin(), this->finalStates.end());
-		for (std::set<size_t>::iterator i = s.begin(); i != s.end(); ++i)
+		for (typename arena_state_set::iterator i = s.begin(); i != s.end(); ++i)
 			index.add(*i);
 	}
 
 	void buildLabelIndex(Index<T>& index) const {
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			index.add((*i)->first._label);
 	}
 /*
@@ -498,18 +574,18 @@ public:
 	}
 */
 	void buildLhsIndex(Index<const std::vector<size_t>*>& index) const {
-		for (typename std::set<typename trans_cache_type::value_type*>::iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			index.add(&(*i)->first._lhs->first);
 	}
 
 	void buildTDCache(td_cache_type& cache) const {
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			cache.insert(make_pair((*i)->first._rhs, vector<const TT<T>*>())).first->second.push_back(&(*i)->first);
 	}
 
 	void buildBUCache(bu_cache_type& cache) const {
 		boost::unordered_set<size_t> s;
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			s.clear();
 			for (std::vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j) {
 				if (s.insert(*j).second)
@@ -520,7 +596,7 @@ public:
 /*
 	void buildSLTBUCache(slt_cache_type& cache, leaf_cache_type& leafCache) const {
 		boost::unordered_map<std::pair<size_t, const T*>, std::set<const TT<T>*> > tmp;
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			if ((*i)->first._lhs->first.empty()) {
 				leafCache.insert(make_pair(&(*i)->first._label, std::set<const TT<T>*>())).first->second.insert(&(*i)->first);
 				continue;
@@ -538,7 +614,7 @@ public:
 	}
 */
 	void buildLTCache(lt_cache_type& cache) const {
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			cache.insert(make_pair((*i)->first._label, std::vector<const TT<T>*>())).first->second.push_back(&(*i)->first);
 	}
 
@@ -610,36 +686,30 @@ public:
 
 	void downwardTranslation(LTS& lts, const Index<size_t>& stateIndex, const Index<T>& labelIndex) const;
 
-	void downwardSimulation(std::vector<std::vector<bool> >& rel, const Index<size_t>& stateIndex) const;
+	void downwardSimulation(BitMatrix& rel, const Index<size_t>& stateIndex) const;
+
+	// states in part[i] start in a common block, blocks are related according
+	// to partRel and all remaining states are initially related to everything
+	void downwardSimulation(BitMatrix& rel, const Index<size_t>& stateIndex, const std::vector<std::vector<size_t> >& part, const BitMatrix& partRel) const;
 
-	void upwardTranslation(LTS& lts, std::vector<std::vector<size_t> >& part, vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const vector<vector<bool> >& sim) const;
+	void upwardTranslation(LTS& lts, std::vector<std::vector<size_t> >& part, BitMatrix& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const BitMatrix& sim) const;
 
-	void upwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const std::vector<std::vector<bool> >& param) const;
+	void upwardSimulation(BitMatrix& rel, const Index<size_t>& stateIndex, const BitMatrix& param) const;
 
-	static void combinedSimulation(vector<vector<bool> >& dst, const vector<vector<bool> >& dwn, const vector<vector<bool> >& up) {
+	static void combinedSimulation(BitMatrix& dst, const BitMatrix& dwn, const BitMatrix& up) {
 		size_t size = dwn.size();
-		vector<vector<bool> > dut(size, vector<bool>(size, false));
+		BitMatrix dut(size, false);
 		for (size_t i = 0; i < size; ++i) {
 			for (size_t j = 0; j < size; ++j) {
-				for (size_t k = 0; k < size; ++k) {
-					if (dwn[i][k] && up[j][k]) {
-						dut[i][j] = true;
-						break;
-					}
-				}
+				if (dwn.rowIntersects(i, up, j))
+					dut[i][j] = true;
 			}
 		}
 		dst = dut;
 		for (size_t i = 0; i < size; ++i) {
 			for (size_t j = 0; j < size; ++j) {
-				if (!dst[i][j])
-					continue;
-				for (size_t k = 0; k < size; ++k) {
-					if (dwn[j][k] && !dut[i][k]) {
-						dst[i][j] = false;
-						break;
-					}
-				}
+				if (dst[i][j] && !dwn.rowSubseteq(j, dut, i))
+					dst[i][j] = false;
 			}
 		}
 	}
@@ -781,7 +851,7 @@ public:
 	}
 */
 	template <class F>
-	static bool transMatch(const TT<T>* t1, const TT<T>* t2, F f, const std::vector<std::vector<bool> >& mat, const Index<size_t>& stateIndex) {
+	static bool transMatch(const TT<T>* t1, const TT<T>* t2, F f, const BitMatrix& mat, const Index<size_t>& stateIndex) {
 
 		if (!f(*t1, *t2))
 			return false;
@@ -802,12 +872,12 @@ public:
 
 	// currently erases '1' from the relation
 	template <class F>
-	void heightAbstraction(std::vector<std::vector<bool> >& result, size_t height, F f, const Index<size_t>& stateIndex) const {
+	void heightAbstraction(BitMatrix& result, size_t height, F f, const Index<size_t>& stateIndex) const {
 
 		td_cache_type cache;
 		this->buildTDCache(cache);
 
-		std::vector<std::vector<bool> > tmp;
+		BitMatrix tmp;
 
 		while (height--) {
 			tmp = result;
@@ -841,18 +911,13 @@ public:
 			}
 		}
 
-		for (size_t i = 0; i < result.size(); ++i) {
-			for (size_t j = 0; j < i; ++j) {
-				if (!result[i][j])
-					result[j][i] = false;
-				if (!result[j][i])
-					result[i][j] = false;
-			}
-		}
+		// keep only the symmetric part
+		result.transpose(tmp);
+		result &= tmp;
 
 	}
 
-	void predicateAbstraction(std::vector<std::vector<bool> >& result, const TA<T>& predicate, const Index<size_t>& stateIndex) const {
+	void predicateAbstraction(BitMatrix& result, const TA<T>& predicate, const Index<size_t>& stateIndex) const {
 		std::vector<size_t> states;
 		this->intersectingStates(states, predicate);
 		std::set<size_t> s;
@@ -873,7 +938,7 @@ public:
 	}
 
 	// collapses states according to a given relation
-	TA<T>& collapsed(TA<T>& dst, const vector<vector<bool> >& rel, const Index<size_t>& stateIndex) const {
+	TA<T>& collapsed(TA<T>& dst, const BitMatrix& rel, const Index<size_t>& stateIndex) const {
 		std::vector<size_t> headIndex;
 		utils::relBuildClasses(rel, headIndex);
 		// TODO: perhaps improve indexing
@@ -884,7 +949,7 @@ public:
 			*i = invStateIndex[*i];
 		for (std::set<size_t>::const_iterator i = this->finalStates.begin(); i != this->finalStates.end(); ++i)
 			dst.addFinalState(headIndex[stateIndex[*i]]);
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			std::vector<size_t> lhs;
 			stateIndex.translate(lhs, (*i)->first._lhs->first);
 			for (size_t j = 0; j < lhs.size(); ++j)
@@ -895,12 +960,13 @@ public:
 	}
 
 	TA<T>& uselessFree(TA<T>& dst) const {
-		std::vector<typename trans_cache_type::value_type*> v1(this->transitions.begin(), this->transitions.end()), v2;
-		std::set<size_t> states;
+		Arena arena;
+		arena_trans_vector v1(this->transitions.begin(), this->transitions.end(), arena), v2(arena);
+		arena_state_set states(std::less<size_t>(), arena);
 		bool changed = true;
 		while (changed) {
 			changed = false;
-			for (typename std::vector<typename trans_cache_type::value_type*>::const_iterator i = v1.begin(); i != v1.end(); ++i) {
+			for (typename arena_trans_vector::const_iterator i = v1.begin(); i != v1.end(); ++i) {
 				bool matches = true;
 				for (std::vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j) {
 					if (!states.count(*j)) {
@@ -927,14 +993,15 @@ public:
 	}
 
 	TA<T>& unreachableFree(TA<T>& dst) const {
-		std::vector<typename trans_cache_type::value_type*> v1(transitions.begin(), this->transitions.end()), v2;
-		std::set<size_t> states(this->finalStates.begin(), this->finalStates.end());
+		Arena arena;
+		arena_trans_vector v1(this->transitions.begin(), this->transitions.end(), arena), v2(arena);
+		arena_state_set states(this->finalStates.begin(), this->finalStates.end(), std::less<size_t>(), arena);
 		for (std::set<size_t>::const_iterator i = this->finalStates.begin(); i != this->finalStates.end(); ++i)
 			dst.addFinalState(*i);
 		bool changed = true;
 		while (changed) {
 			changed = false;
-			for (typename std::vector<typename trans_cache_type::value_type*>::const_iterator i = v1.begin(); i != v1.end(); ++i) {
+			for (typename arena_trans_vector::const_iterator i = v1.begin(); i != v1.end(); ++i) {
 				if (states.count((*i)->first._rhs)) {
 					dst.addTransition(*i);
 					for (std::vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j) {
@@ -952,12 +1019,13 @@ public:
 	}
 
 	TA<T>& uselessAndUnreachableFree(TA<T>& dst) const {
-		std::vector<typename trans_cache_type::value_type*> v1(this->transitions.begin(), this->transitions.end()), v2, v3;
-		std::set<size_t> states;
+		Arena arena;
+		arena_trans_vector v1(this->transitions.begin(), this->transitions.end(), arena), v2(arena), v3(arena);
+		arena_state_set states(std::less<size_t>(), arena);
 		bool changed = true;
 		while (changed) {
 			changed = false;
-			for (typename std::vector<typename trans_cache_type::value_type*>::const_iterator i = v1.begin(); i != v1.end(); ++i) {
+			for (typename arena_trans_vector::const_iterator i = v1.begin(); i != v1.end(); ++i) {
 				bool matches = true;
 				for (std::vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j) {
 					if (!states.count(*j)) {
@@ -982,11 +1050,12 @@ public:
 		}
 		std::swap(v1, v3);
 		v2.clear();
-		states = std::set<size_t>(dst.finalStates.begin(), dst.finalStates.end());
+		states.clear();
+		states.insert(dst.finalStates.begin(), dst.finalStates.end());
 		changed = true;
 		while (changed) {
 			changed = false;
-			for (typename std::vector<typename trans_cache_type::value_type*>::const_iterator i = v1.begin(); i != v1.end(); ++i) {
+			for (typename arena_trans_vector::const_iterator i = v1.begin(); i != v1.end(); ++i) {
 				if (states.count((*i)->first._rhs)) {
 					dst.addTransition(*i);
 					for (std::vector<size_t>::const_iterator j = (*i)->first._lhs->first.begin(); j != (*i)->first._lhs->first.end(); ++j) {
@@ -1003,7 +1072,7 @@ public:
 		return dst;
 	}
 
-	TA<T>& downwardSieve(TA<T>& dst, const std::vector<std::vector<bool> >& cons, const Index<size_t>& stateIndex) const {
+	TA<T>& downwardSieve(TA<T>& dst, const BitMatrix& cons, const Index<size_t>& stateIndex) const {
 
 		td_cache_type cache;
 		this->buildTDCache(cache);
@@ -1034,9 +1103,9 @@ public:
 
 	}
 
-	TA<T>& minimized(TA<T>& dst, const std::vector<std::vector<bool> >& cons, const Index<size_t>& stateIndex) const {
+	TA<T>& minimized(TA<T>& dst, const BitMatrix& cons, const Index<size_t>& stateIndex) const {
 		typename TA<T>::Backend backend;
-		std::vector<vector<bool> > dwn;
+		BitMatrix dwn;
 		this->downwardSimulation(dwn, stateIndex);
 		utils::relAnd(dwn, cons, dwn);
 		TA<T> tmp1(backend), tmp2(backend), tmp3(backend);
@@ -1047,11 +1116,11 @@ public:
 		Index<size_t> stateIndex;
 		this->buildSortedStateIndex(stateIndex);
 		typename TA<T>::Backend backend;
-		std::vector<vector<bool> > dwn;
+		BitMatrix dwn;
 		this->downwardSimulation(dwn, stateIndex);
-		std::vector<vector<bool> > up;
+		BitMatrix up;
 		this->upwardSimulation(up, stateIndex, dwn);
-		std::vector<vector<bool> > rel;
+		BitMatrix rel;
 		TA<T>::combinedSimulation(rel, dwn, up);
 		TA<T> tmp(backend);
 		return this->collapsed(tmp, rel, stateIndex).minimized(dst);
@@ -1060,12 +1129,120 @@ public:
 	TA<T>& minimized(TA<T>& dst) const {
 		Index<size_t> stateIndex;
 		this->buildSortedStateIndex(stateIndex);
-		std::vector<std::vector<bool> > cons(stateIndex.size(), std::vector<bool>(stateIndex.size(), true));
+		BitMatrix cons(stateIndex.size(), true);
 		return this->minimized(dst, cons, stateIndex);
 	}
 
+	// downward simulation remembered by state names
+	struct SimulationSeed {
+
+		// sorted
+		std::vector<size_t> states;
+		BitMatrix rel;
+
+		void clear() {
+			this->states.clear();
+			this->rel = BitMatrix();
+		}
+
+	};
+
+	// same as minimized(dst), but the simulation computation starts from the
+	// relation kept in seed which is replaced by the current one afterwards;
+	// the automaton is expected to extend the one the seed was obtained for
+	// only by transitions leading to fresh or accepting states
+	TA<T>& minimized(TA<T>& dst, SimulationSeed& seed) const {
+		Index<size_t> stateIndex;
+		this->buildSortedStateIndex(stateIndex);
+		// group remembered states (their downward behaviour did not change)
+		// into classes of the remembered relation
+		std::vector<std::vector<size_t> > part;
+		std::vector<size_t> head;
+		for (size_t i = 0; i < seed.states.size(); ++i) {
+			std::pair<size_t, bool> state = stateIndex.find(seed.states[i]);
+			if (!state.second || this->finalStates.count(seed.states[i]))
+				continue;
+			size_t j = 0;
+			while (j < head.size() && !(seed.rel[i][head[j]] && seed.rel[head[j]][i]))
+				++j;
+			if (j == head.size()) {
+				head.push_back(i);
+				part.push_back(std::vector<size_t>());
+			}
+			part[j].push_back(state.first);
+		}
+		BitMatrix partRel(head.size(), false);
+		for (size_t i = 0; i < head.size(); ++i) {
+			for (size_t j = 0; j < head.size(); ++j)
+				partRel[i][j] = seed.rel[head[i]][head[j]];
+		}
+		BitMatrix dwn;
+		this->downwardSimulation(dwn, stateIndex, part, partRel);
+		typename TA<T>::Backend backend;
+		TA<T> tmp1(backend), tmp2(backend), tmp3(backend);
+		this->collapsed(tmp1, dwn, stateIndex).uselessFree(tmp2).downwardSieve(tmp3, dwn, stateIndex).unreachableFree(dst);
+		// remember the relation restricted to the states which survived
+		Index<size_t> dstIndex;
+		dst.buildSortedStateIndex(dstIndex);
+		seed.states.resize(dstIndex.size());
+		for (Index<size_t>::iterator i = dstIndex.begin(); i != dstIndex.end(); ++i)
+			seed.states[i->second] = stateIndex[i->first];
+		seed.rel = BitMatrix(seed.states.size(), false);
+		for (size_t i = 0; i < seed.states.size(); ++i) {
+			for (size_t j = 0; j < seed.states.size(); ++j)
+				seed.rel[i][j] = dwn[seed.states[i]][seed.states[j]];
+		}
+		for (Index<size_t>::iterator i = dstIndex.begin(); i != dstIndex.end(); ++i)
+			seed.states[i->second] = i->first;
+		return dst;
+	}
+
+	// the automaton with its states renamed to 0, 1, ... (preserving their
+	// order) and its transitions sorted, equal keys denote equal automata
+	struct CanonicalKey {
+
+		std::vector<T> labels;
+		std::vector<size_t> states;
+
+		bool operator==(const CanonicalKey& rhs) const {
+			return (this->labels == rhs.labels) && (this->states == rhs.states);
+		}
+
+		friend size_t hash_value(const CanonicalKey& key) {
+			size_t h = boost::hash_range(key.labels.begin(), key.labels.end());
+			boost::hash_combine(h, boost::hash_range(key.states.begin(), key.states.end()));
+			return h;
+		}
+
+	};
+
+	// buffers reused by buildCanonicalKey() so that it does not allocate once
+	// they have grown large enough
+	struct CanonicalScratch {
+
+		std::vector<size_t> states;
+		std::vector<typename TransSet::value_type> trans;
+
+	};
+
+	void buildCanonicalKey(CanonicalKey& key, CanonicalScratch& scratch) const;
+
+	struct InclusionCacheStats {
+
+		size_t hits;
+		size_t misses;
+
+		InclusionCacheStats() : hits(0), misses(0) {}
+
+	};
+
+	static InclusionCacheStats inclusionCacheStats;
+
 	static bool subseteq(const TA<T>& a, const TA<T>& b);
 
+	// has to be called whenever labels may get freed
+	static void clearInclusionCache();
+
 	template <class F>
 	static TA<T>& rename(TA<T>& dst, const TA<T>& src, F f, bool addFinalStates = true) {
 		std::vector<size_t> lhs;
@@ -1073,7 +1250,7 @@ public:
 			for (std::set<size_t>::const_iterator i = src.finalStates.begin(); i != src.finalStates.end(); ++i)
 				dst.addFinalState(f(*i));
 		}
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = src.transitions.begin(); i != src.transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = src.transitions.begin(); i != src.transitions.end(); ++i) {
 			lhs.resize((*i)->first._lhs->first.size());
 			for (size_t j = 0; j < (*i)->first._lhs->first.size(); ++j)
 				lhs[j] = f((*i)->first._lhs->first[j]);
@@ -1088,7 +1265,7 @@ public:
 			for (std::set<size_t>::const_iterator i = src.finalStates.begin(); i != src.finalStates.end(); ++i)
 				dst.addFinalState(index.translateOTF(*i) + offset);
 		}
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = src.transitions.begin(); i != src.transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = src.transitions.begin(); i != src.transitions.end(); ++i) {
 			lhs.clear();
 			index.translateOTF(lhs, (*i)->first._lhs->first, offset);
 			dst.addTransition(lhs, (*i)->first._label, index.translateOTF((*i)->first._rhs) + offset);
@@ -1111,14 +1288,14 @@ public:
 	};
 
 	TA& copyTransitions(TA<T>& dst) const {
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 			dst.addTransition(*i);
 		return dst;
 	}
 
 	template <class F>
 	TA& copyTransitions(TA<T>& dst, F f) const {
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			if (f(&(*i)->first))
 				dst.addTransition(*i);
 		}
@@ -1135,9 +1312,9 @@ public:
 			dst.addFinalState(*i);
 		for (set<size_t>::const_iterator i = b.finalStates.begin(); i != b.finalStates.end(); ++i)
 			dst.addFinalState(*i);
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = a.transitions.begin(); i != a.transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = a.transitions.begin(); i != a.transitions.end(); ++i)
 			dst.addTransition(*i);
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = b.transitions.begin(); i != b.transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = b.transitions.begin(); i != b.transitions.end(); ++i)
 			dst.addTransition(*i);
 		return dst;
 	}
@@ -1147,7 +1324,7 @@ public:
 			for (std::set<size_t>::const_iterator i = src.finalStates.begin(); i != src.finalStates.end(); ++i)
 				dst.addFinalState(*i);
 		}
-		for (typename set<typename trans_cache_type::value_type*>::const_iterator i = src.transitions.begin(); i != src.transitions.end(); ++i)
+		for (typename trans_set_type::const_iterator i = src.transitions.begin(); i != src.transitions.end(); ++i)
 			dst.addTransition(*i);
 		return dst;
 	}
@@ -1171,7 +1348,7 @@ public:
 	TA<T>& unfoldAtRoot(TA<T>& dst, size_t newState, bool registerFinalState = true) const {
 		if (registerFinalState)
 			dst.addFinalState(newState);
-		for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		for (typename trans_set_type::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 			dst.addTransition(*i);
 			if (this->isFinalState((*i)->first._rhs))
 				dst.addTransition((*i)->first._lhs->first, (*i)->first._label, newState);
@@ -27,6 +27,8 @@
 #include <unordered_set>
 #include <unordered_map>
 
+#include "bitmatrix.hh"
+
 #ifndef NDEBUG
 #define CL_CDEBUG(l, x) CL_DEBUG_AT(l, x)
 #define CL_CDEBUG_MSG(l, x) CL_DEBUG_MSG_AT(l, x)
@@ -212,7 +214,7 @@ class utils {
 public:
 	
 	// build equivalence classes
-	static void relBuildClasses(const std::vector<std::vector<bool> >& rel, std::vector<size_t>& headIndex) {
+	static void relBuildClasses(const BitMatrix& rel, std::vector<size_t>& headIndex) {
 		headIndex.resize(rel.size());
 		std::vector<size_t> head;
 		for (size_t i = 0; i < rel.size(); ++i) {
@@ -232,7 +234,7 @@ public:
 	}
 
 	// build equivalence classes
-	static void relBuildClasses(const std::vector<std::vector<bool> >& rel, std::vector<size_t>& index, std::vector<size_t>& head) {
+	static void relBuildClasses(const BitMatrix& rel, std::vector<size_t>& index, std::vector<size_t>& head) {
 		index.resize(rel.size());
 		head.clear();
 		for (size_t i = 0; i < rel.size(); ++i) {
@@ -252,32 +254,26 @@ public:
 	}
 
 	// and composition
-	static void relAnd(std::vector<std::vector<bool> >& dst, const std::vector<std::vector<bool> >& src1, const std::vector<std::vector<bool> >& src2) {
-		dst.resize(src1.size(), std::vector<bool>(src1.size()));
-		for (size_t i = 0; i < src1.size(); ++i) {
-			for (size_t j = 0; j < src1.size(); ++j)
-				dst[i][j] = src1[i][j] && src2[i][j];
+	static void relAnd(BitMatrix& dst, const BitMatrix& src1, const BitMatrix& src2) {
+		if (&dst == &src2) {
+			dst &= src1;
+			return;
 		}
+		if (&dst != &src1)
+			dst = src1;
+		dst &= src2;
 	}
-	
+
 	// transposition
-	static void relInv(std::vector<std::vector<bool> >& dst, const std::vector<std::vector<bool> >& src) {
-		dst.resize(src.size(), std::vector<bool>(src.size()));
-		for (size_t i = 0; i < src.size(); ++i) {
-			for (size_t j = 0; j < src.size(); ++j)
-				dst[j][i] = src[i][j];
-		}
+	static void relInv(BitMatrix& dst, const BitMatrix& src) {
+		src.transpose(dst);
 	}
 
 	// relation index
-	static void relIndex(std::vector<std::vector<size_t> >& dst, const std::vector<std::vector<bool> >& src) {
+	static void relIndex(std::vector<std::vector<size_t> >& dst, const BitMatrix& src) {
 		dst.resize(src.size());
-		for (size_t i = 0; i < src.size(); ++i) {
-			for (size_t j = 0; j < src.size(); ++j) {
-				if (src[i][j])
-					dst[i].push_back(j);					
-			}
-		}
+		for (size_t i = 0; i < src.size(); ++i)
+			src.forEachInRow(i, [&dst, i](size_t j) { dst[i].push_back(j); });
 	}
 
 	// intersection	
@@ -356,13 +352,8 @@ public:
 	}
 
 	// print
-	static std::ostream& relPrint(std::ostream& os, const std::vector<std::vector<bool> >& src) {
-		for (size_t i = 0; i < src.size(); ++i) {
-			for (size_t j = 0; j < src.size(); ++j)
-				os << src[i][j];
-			os << std::endl;
-		}
-		return os;
+	static std::ostream& relPrint(std::ostream& os, const BitMatrix& src) {
+		return os << src;
 	}
 
 	template <class T>
@@ -181,4 +181,33 @@ void cl_die(const char *msg);
 /// current debugging level
 int cl_debug_level(void);
 
+/**
+ * while installed, a ClMsgQueue holds back the messages emitted by the thread
+ * that installed it, so that they can be emitted later on (in their original
+ * order) from a single thread, e.g. to keep the output of more threads
+ * deterministic.  Fatal errors emitted by cl_die() are never held back.
+ */
+class ClMsgQueue {
+    public:
+        ClMsgQueue();
+        ~ClMsgQueue();
+
+        /// start holding back messages emitted by the current thread
+        void install();
+
+        /// stop holding back messages emitted by the current thread
+        void uninstall();
+
+        /// emit all the held messages and forget them, must not be installed
+        void flush();
+
+    private:
+        // copying NOT allowed
+        ClMsgQueue(const ClMsgQueue &);
+        ClMsgQueue& operator=(const ClMsgQueue &);
+
+        struct Private;
+        Private *d;
+};
+
 #endif /* H_GUARD_CL_MSG_H */
@@ -25,10 +25,12 @@
 #include <cl/storage.hh>
 
 #include "memdebug.hh"
+#include "plotsink.hh"
 #include "symbt.hh"
 #include "symdump.hh"
 #include "symexec.hh"
 #include "symproc.hh"
+#include "symprof.hh"
 #include "symstate.hh"
 #include "symtrace.hh"
 #include "util.hh"
@@ -73,6 +75,24 @@ void parseConfigString(SymExecParams &sep, std::string cnf) {
         return;
     }
 
+    if (string("sched:bfs") == cnf) {
+        CL_DEBUG("parseConfigString: BFS block scheduler requested");
+        sep.schedPolicy = SP_BFS;
+        return;
+    }
+
+    if (string("sched:dfs") == cnf) {
+        CL_DEBUG("parseConfigString: DFS block scheduler requested");
+        sep.schedPolicy = SP_DFS;
+        return;
+    }
+
+    if (string("sched:loop") == cnf) {
+        CL_DEBUG("parseConfigString: loop-aware block scheduler requested");
+        sep.schedPolicy = SP_LOOP;
+        return;
+    }
+
     const char *cstr = cnf.c_str();
     const char *elPrefix = "error_label:";
     const size_t elPrefixLen = strlen(elPrefix);
@@ -83,6 +103,40 @@ void parseConfigString(SymExecParams &sep, std::string cnf) {
         return;
     }
 
+    const char *sdPrefix = "summary_dir:";
+    const size_t sdPrefixLen = strlen(sdPrefix);
+    if (!strncmp(cstr, sdPrefix, sdPrefixLen)) {
+        cstr += sdPrefixLen;
+        CL_DEBUG("parseConfigString: function summaries kept in \"" << cstr
+                << "\"");
+        sep.summaryDir = cstr;
+        return;
+    }
+
+    const char *pfPrefix = "profile:";
+    const size_t pfPrefixLen = strlen(pfPrefix);
+    if (!strncmp(cstr, pfPrefix, pfPrefixLen)) {
+#if !SE_PROFILE
+        CL_WARN("profile: ignored, SE_PROFILE is disabled in config.h");
+        return;
+#endif
+        cstr += pfPrefixLen;
+        CL_DEBUG("parseConfigString: profile is going to be written to \""
+                << cstr << "\"");
+        sep.profileFile = cstr;
+        return;
+    }
+
+    const char *paPrefix = "plot_archive:";
+    const size_t paPrefixLen = strlen(paPrefix);
+    if (!strncmp(cstr, paPrefix, paPrefixLen)) {
+        cstr += paPrefixLen;
+        CL_DEBUG("parseConfigString: heap graphs are going to be written to \""
+                << cstr << "\"");
+        sep.plotArchive = cstr;
+        return;
+    }
+
     CL_WARN("unhandled config string: \"" << cnf << "\"");
 }
 
@@ -194,9 +248,16 @@ void clEasyRun(const CodeStorage::Storage &stor, const char *configString) {
     SymExecParams ep;
     parseConfigString(ep, configString);
 
+    // write all heap graphs to a single archive if asked to do so
+    if (!ep.plotArchive.empty())
+        PlotSink::open(ep.plotArchive);
+
     // run symbolic execution
     launchSymExec(stor, ep);
 
+    // flush the archive of heap graphs, if any
+    PlotSink::close();
+
     if (Trace::Globals::alive()) {
         // plot all pending trace graphs
         Trace::GraphProxy *glProxy = Trace::Globals::instance()->glProxy();
@@ -208,4 +269,9 @@ void clEasyRun(const CodeStorage::Storage &stor, const char *configString) {
     }
 
     printPeakMemUsage();
+
+    // print the profile (in verbose mode) and dump it if asked to do so
+    printProfile();
+    if (!ep.profileFile.empty())
+        dumpProfile(ep.profileFile);
 }
@@ -67,11 +67,22 @@
  */
 #define DEBUG_SYMCUT                        0
 
+/**
+ * if 1, cross-check each result of SegDiscovery with a full discovery
+ */
+#define DEBUG_SYMDISCOVER                   0
+
 /**
  * if 1, plot shape of the data structures being leaked
  */
 #define DEBUG_SYMGC                         0
 
+/**
+ * if 1, cross-check each answer of the reachability index used by the garbage
+ * collector with an exhaustive search through the heap
+ */
+#define DEBUG_SYMGC_REACH                   0
+
 /**
  * if 1, symjoin prints some extra debugging info
  */
@@ -127,6 +138,27 @@
  */
 #define SE_ASSUME_FRESH_STATIC_DATA         1
 
+/**
+ * default policy of the scheduler at the level of basic blocks
+ *
+ * - 0 ... BFS, process basic blocks in the order they were scheduled
+ *
+ * - 1 ... DFS, process the most recently scheduled basic block first
+ *
+ * - 2 ... loop-aware, process basic blocks in the weak topological order of
+ *         the CFG, so that a loop is stabilized before the code following it
+ *
+ * The policy can be overridden at run-time by the sched:{bfs,dfs,loop} option.
+ */
+#define SE_BLOCK_SCHEDULER                  0
+
+/**
+ * upper bound of the amount of memory kept by the call cache (estimated as the
+ * sum of SymHeap::lastId() over the cached heaps); the least recently used
+ * entries are evicted once the bound is exceeded (0 means unlimited)
+ */
+#define SE_CALL_CACHE_BUDGET                0x100000
+
 /**
  * call cache miss count that will trigger function removal (0 means disabled)
  */
@@ -185,6 +217,18 @@
  */
 #define SE_ERROR_RECOVERY_MODE              1
 
+/**
+ * if 1, the garbage collector asks SymHeapCore::valTargetIsReachable() instead
+ * of searching through all the referrers of each junk candidate
+ */
+#define SE_GC_REACH_INDEX                   1
+
+/**
+ * if 1, abstractIfNeeded() does not rescan the parts of the heap that have not
+ * changed since the previous abstraction (see SegDiscovery)
+ */
+#define SE_INCREMENTAL_SEG_DISCOVERY        1
+
 /**
  * the highest integral number we can count to (only partial implementation atm)
  */
@@ -200,11 +244,26 @@
  */
 #define SE_MAX_CALL_DEPTH                   0x40
 
+/**
+ * if greater than 1, execute non-terminal instructions (except calls) on up to
+ * the given count of symbolic heaps of a basic block in parallel [experimental]
+ * (the threads are created once per analysis and reused by each instruction)
+ */
+#define SE_PARALLEL_HEAPS                   0
+
 /**
  * if non-zero, plot each state that caused an error to be reported
  */
 #define SE_PLOT_ERROR_STATES                0
 
+/**
+ * if 1, measure time and allocations of heap entities spent in the particular
+ * phases of the analysis per each function and basic block (see symprof.hh);
+ * the numbers are dumped only if asked by profile:FILE, but they are cheap
+ * enough to be always collected (two clock readings per measured scope)
+ */
+#define SE_PROFILE                          1
+
 /**
  * cost of merged prototype where one case was more generic than the other case
  */
@@ -226,6 +285,12 @@
  */
 #define SE_RESTRICT_SLS_MINLEN              2
 
+/**
+ * if 1, compare cached heap fingerprints before running areEqual() or
+ * joinSymHeaps() on the heaps of a symbolic state
+ */
+#define SE_STATE_FINGERPRINTS               1
+
 /**
  * if 1, the symcut module allows generic minimal lengths to survive a function
  * call/return.  @b Not recommended unless SymCallCache has been rewritten to
@@ -233,6 +298,26 @@
  */
 #define SE_SYMCUT_PRESERVES_MIN_LENGTHS     1
 
+/**
+ * if 1, the symcut module shares the frame of a function call with the caller's
+ * heap (copy-on-write) instead of copying it, and joins the (usually smaller)
+ * result of the call into the frame on return, so that the cost of a call does
+ * not depend on the part of the heap that the callee cannot reach (the entities
+ * taken by the callee stay in the caller's heap as dead ones, a frame with too
+ * many of them is joined by a deep copy instead, see isFrameSparse()).  If the
+ * callee takes the most of the heap, its entry is shared with the caller the
+ * same way, see isEntryDense().
+ */
+#define SE_SYMCUT_ZERO_COPY                 1
+
+/**
+ * if non-zero, keep only the last N to 2N nodes of each path in the trace graph
+ * and replace the rest of the path by a single Trace::TruncatedNode, so that
+ * the trace graph does not grow with the length of the analysis (value 1 makes
+ * the error traces useless, but almost no memory is spent on them then)
+ */
+#define SE_TRACE_MAX_DEPTH                  0
+
 /**
  * - 0 ... disable tracking non-pointer values
  * - 1 ... basic tracking of non-pointer values
@@ -240,11 +325,6 @@
  */
 #define SE_TRACK_NON_POINTER_VALUES         2
 
-/**
- * if 1, use a DFS scheduler at the level of basic blocks; if 0, use BFS
- */
-#define SE_USE_DFS_SCHEDULER                0
-
 /**
  * if 1, do not make deep copy on copy of SymHeap [experimental]
  */
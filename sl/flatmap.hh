@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_FLATMAP_H
+#define H_GUARD_FLATMAP_H
+
+/**
+ * @file flatmap.hh
+ * std::set/std::map replacements backed by a sorted std::vector
+ *
+ * The containers are meant for small databases that are often copied (e.g. on
+ * copy-on-write of SymHeapCore), where a single contiguous block is cheaper
+ * to copy, to destroy, and to search than a tree of nodes.  Unlike std::map,
+ * any insertion or removal invalidates all iterators and references.
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/// sorted set with the interface of std::set (the commonly used part of it)
+template <class TKey>
+class FlatSet {
+    private:
+        typedef std::vector<TKey>                           TCont;
+        TCont                                               cont_;
+
+    public:
+        // for compatibility with STL and Boost libraries
+        typedef TKey                                        key_type;
+        typedef TKey                                        value_type;
+        typedef const TKey&                                 const_reference;
+        typedef typename TCont::const_iterator              const_iterator;
+        typedef const_iterator                              iterator;
+
+        const_iterator begin() const { return cont_.begin(); }
+        const_iterator end()   const { return cont_.end();   }
+
+        bool empty()    const { return cont_.empty(); }
+        size_t size()   const { return cont_.size();  }
+
+        void clear() {
+            cont_.clear();
+        }
+
+        const_iterator lower_bound(const TKey &key) const {
+            return std::lower_bound(cont_.begin(), cont_.end(), key);
+        }
+
+        const_iterator find(const TKey &key) const {
+            const const_iterator it = this->lower_bound(key);
+            if (cont_.end() == it || key < *it)
+                return cont_.end();
+
+            return it;
+        }
+
+        std::pair<const_iterator, bool> insert(const TKey &key) {
+            typename TCont::iterator it =
+                std::lower_bound(cont_.begin(), cont_.end(), key);
+
+            if (cont_.end() != it && !(key < *it))
+                // already there
+                return std::make_pair(const_iterator(it), false);
+
+            it = cont_.insert(it, key);
+            return std::make_pair(const_iterator(it), true);
+        }
+
+        size_t erase(const TKey &key) {
+            typename TCont::iterator it =
+                std::lower_bound(cont_.begin(), cont_.end(), key);
+
+            if (cont_.end() == it || key < *it)
+                return 0;
+
+            cont_.erase(it);
+            return 1;
+        }
+};
+
+/// sorted map with the interface of std::map (the commonly used part of it)
+template <class TKey, class TVal>
+class FlatMap {
+    public:
+        // for compatibility with STL and Boost libraries
+        typedef TKey                                        key_type;
+        typedef TVal                                        mapped_type;
+        typedef std::pair<TKey, TVal>                       value_type;
+
+    private:
+        typedef std::vector<value_type>                     TCont;
+        TCont                                               cont_;
+
+        struct KeyLess {
+            bool operator()(const value_type &item, const TKey &key) const {
+                return item.first < key;
+            }
+        };
+
+    public:
+        typedef const value_type&                           const_reference;
+        typedef typename TCont::iterator                    iterator;
+        typedef typename TCont::const_iterator              const_iterator;
+
+        iterator begin()             { return cont_.begin(); }
+        iterator end()               { return cont_.end();   }
+        const_iterator begin() const { return cont_.begin(); }
+        const_iterator end()   const { return cont_.end();   }
+
+        bool empty()    const { return cont_.empty(); }
+        size_t size()   const { return cont_.size();  }
+
+        void clear() {
+            cont_.clear();
+        }
+
+        iterator lower_bound(const TKey &key) {
+            return std::lower_bound(cont_.begin(), cont_.end(), key, KeyLess());
+        }
+
+        const_iterator lower_bound(const TKey &key) const {
+            return std::lower_bound(cont_.begin(), cont_.end(), key, KeyLess());
+        }
+
+        iterator find(const TKey &key) {
+            const iterator it = this->lower_bound(key);
+            if (cont_.end() == it || key < it->first)
+                return cont_.end();
+
+            return it;
+        }
+
+        const_iterator find(const TKey &key) const {
+            const const_iterator it = this->lower_bound(key);
+            if (cont_.end() == it || key < it->first)
+                return cont_.end();
+
+            return it;
+        }
+
+        std::pair<iterator, bool> insert(const value_type &item) {
+            iterator it = this->lower_bound(item.first);
+            if (cont_.end() != it && !(item.first < it->first))
+                // already there
+                return std::make_pair(it, false);
+
+            it = cont_.insert(it, item);
+            return std::make_pair(it, true);
+        }
+
+        TVal& operator[](const TKey &key) {
+            return this->insert(value_type(key, TVal())).first->second;
+        }
+
+        size_t erase(const TKey &key) {
+            const iterator it = this->find(key);
+            if (cont_.end() == it)
+                return 0;
+
+            cont_.erase(it);
+            return 1;
+        }
+
+        void erase(iterator it) {
+            cont_.erase(it);
+        }
+};
+
+#endif /* H_GUARD_FLATMAP_H */
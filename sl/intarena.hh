@@ -22,15 +22,20 @@
 
 #include "config.h"
 
-#include <map>
+#include <algorithm>
 #include <set>
 #include <vector>
 
-#include <boost/foreach.hpp>
-
-#define IA_AGGRESSIVE_OPTIMIZATION          0
-
-/// ad-hoc implementation;  wastes memory, performance, and human resources
+/**
+ * interval index over right-open intervals [beg, end), each of them labelled
+ * by an object; one object may own several disjoint intervals
+ *
+ * The intervals are kept in a single vector sorted by their lower bounds.  The
+ * length of the longest interval ever inserted bounds the part of the vector
+ * that needs to be scanned by a window query, so that the queries do not need
+ * to start from the beginning.  The whole index is a single allocation, which
+ * makes copy-on-write clones of SymHeapCore cheap.
+ */
 template <typename TInt, typename TObj>
 class IntervalArena {
     public:
@@ -41,12 +46,83 @@ class IntervalArena {
         typedef std::pair<key_type, TObj>           value_type;
 
     private:
-        typedef std::set<TObj>                      TLeaf;
-        typedef std::map</* beg */ TInt, TLeaf>     TLine;
-        typedef std::map</* end */ TInt, TLine>     TCont;
+        struct Item {
+            TInt        beg;
+            TInt        end;
+            TObj        obj;
+
+            Item(TInt beg_, TInt end_, TObj obj_):
+                beg(beg_),
+                end(end_),
+                obj(obj_)
+            {
+            }
+
+            bool operator<(const Item &ref) const {
+                if (beg != ref.beg)
+                    return (beg < ref.beg);
+
+                if (end != ref.end)
+                    return (end < ref.end);
+
+                return (obj < ref.obj);
+            }
+
+            bool operator==(const Item &ref) const {
+                return beg == ref.beg
+                    && end == ref.end
+                    && obj == ref.obj;
+            }
+        };
+
+        /// compare items by their bounds only, regardless of the object
+        struct BoundsLess {
+            bool operator()(const Item &item, const key_type &key) const {
+                if (item.beg != key.first)
+                    return (item.beg < key.first);
+
+                return (item.end < key.second);
+            }
+        };
+
+        typedef std::vector<Item>                   TCont;
+        typedef typename TCont::iterator            TIter;
+        typedef typename TCont::const_iterator      TConstIter;
+
         TCont                                       cont_;
 
+        /// upper bound of (end - beg) over all intervals in cont_
+        TInt                                        maxLen_;
+
+        /// the first item that may intersect the window beginning at winBeg
+        TIter firstCandidate(const TInt winBeg) {
+            const key_type lb(winBeg - maxLen_, winBeg - maxLen_);
+            return std::lower_bound(cont_.begin(), cont_.end(), lb,
+                    BoundsLess());
+        }
+
+        TConstIter firstCandidate(const TInt winBeg) const {
+            const key_type lb(winBeg - maxLen_, winBeg - maxLen_);
+            return std::lower_bound(cont_.begin(), cont_.end(), lb,
+                    BoundsLess());
+        }
+
+        void insert(const Item &item) {
+            const TIter it = std::lower_bound(cont_.begin(), cont_.end(), item);
+            if (cont_.end() != it && *it == item)
+                // already there
+                return;
+
+            cont_.insert(it, item);
+            maxLen_ = std::max(maxLen_, item.end - item.beg);
+        }
+
     public:
+        IntervalArena():
+            maxLen_(0)
+        {
+        }
+
         void add(const key_type &, const TObj);
         void sub(const key_type &, const TObj);
         void intersects(TSet &dst, const key_type &key) const;
@@ -54,6 +130,7 @@ class IntervalArena {
 
         void clear() {
             cont_.clear();
+            maxLen_ = 0;
         }
 
         IntervalArena& operator+=(const value_type &item) {
@@ -74,7 +151,7 @@ void IntervalArena<TInt, TObj>::add(const key_type &key, const TObj obj)
     const TInt end = key.second;
     CL_BREAK_IF(end <= beg);
 
-    cont_[end][beg].insert(obj);
+    this->insert(Item(beg, end, obj));
 }
 
 template <typename TInt, typename TObj>
@@ -84,96 +161,34 @@ void IntervalArena<TInt, TObj>::sub(const key_type &key, const TObj obj)
     const TInt winEnd = key.second;
     CL_BREAK_IF(winEnd <= winBeg);
 
-    std::vector<value_type> recoverList;
-
-    const typename TCont::iterator itEnd = cont_.end();
-    typename TCont::iterator it =
-        cont_.lower_bound(winBeg + /* right-open interval given as key */ 1);
+    std::vector<Item> recoverList;
 
-    while (itEnd != it) {
-        TLine &line = it->second;
-#if !IA_AGGRESSIVE_OPTIMIZATION
-        if (line.empty()) {
-            // skip orphans
-            ++it;
-            continue;
-        }
-#endif
-        typename TLine::iterator lineIt = line.begin();
-        TInt beg = lineIt->first;
-        if (winEnd <= beg) {
-            // we are beyond the window already
-            ++it;
+    // remove all intervals of obj that intersect the window
+    const TIter itBeg = this->firstCandidate(winBeg);
+    TIter dst = itBeg;
+    TIter it = itBeg;
+    for (; cont_.end() != it && it->beg < winEnd; ++it) {
+        if (it->obj != obj || it->end <= winBeg) {
+            // keep this one
+            *dst++ = *it;
             continue;
         }
 
-        const TInt end = it->first;
-        bool anyHit = false;
-
-        const typename TLine::iterator lineItEnd = line.end();
-        do {
-            // make sure the basic window axioms hold
-            CL_BREAK_IF(winEnd <= beg);
-            CL_BREAK_IF(end <= winBeg);
-
-            // remove the object from the current leaf (if found)
-            TLeaf &os = lineIt->second;
-            if (os.erase(obj)) {
-                anyHit = true;
-
-                if (beg < winBeg) {
-                    // schedule "the part above" for re-insertion
-                    const key_type key(beg, winBeg);
-                    const value_type item(key, obj);
-                    recoverList.push_back(item);
-                }
-            }
-
-#if IA_AGGRESSIVE_OPTIMIZATION
-            if (os.empty())
-                // FIXME: Can we remove items from std::map during traversal??
-                line.erase(lineIt++);
-            else
-#endif
-            ++lineIt;
-
-            if (lineItEnd == lineIt)
-                // end of line
-                break;
-
-            beg = lineIt->first;
-        }
-        while (beg < winEnd);
-
-        if (anyHit) {
-            if (winEnd < end) {
-                // schedule "the part beyond" for re-insertion
-                const key_type key(winEnd, end);
-                const value_type item(key, obj);
-                recoverList.push_back(item);
-            }
-
-#if IA_AGGRESSIVE_OPTIMIZATION
-            if (line.empty()) {
-                // FIXME: Can we remove items from std::map during traversal??
-                cont_.erase(it++);
-                continue;
-            }
-#endif
-        }
+        if (it->beg < winBeg)
+            // schedule "the part above" for re-insertion
+            recoverList.push_back(Item(it->beg, winBeg, obj));
 
-        ++it;
+        if (winEnd < it->end)
+            // schedule "the part beyond" for re-insertion
+            recoverList.push_back(Item(winEnd, it->end, obj));
     }
 
-    // go through the recoverList and re-insert the missing parts
-    BOOST_FOREACH(const value_type &rItem, recoverList) {
-        const key_type &key = rItem.first;
-        const TObj obj = rItem.second;
-        const TInt beg = key.first;
-        const TInt end = key.second;
+    cont_.erase(dst, it);
 
-        cont_[end][beg].insert(obj);
-    }
+    // go through the recoverList and re-insert the missing parts
+    for (typename std::vector<Item>::const_iterator rIt = recoverList.begin();
+            recoverList.end() != rIt; ++rIt)
+        this->insert(*rIt);
 }
 
 template <typename TInt, typename TObj>
@@ -183,59 +198,21 @@ void IntervalArena<TInt, TObj>::intersects(TSet &dst, const key_type &key) const
     const TInt winEnd = key.second;
     CL_BREAK_IF(winEnd <= winBeg);
 
-    typename TCont::const_iterator it =
-        cont_.lower_bound(winBeg + /* right-open interval given as key */ 1);
-
-    for (; cont_.end() != it; ++it) {
-        const TLine &line = it->second;
-#if !IA_AGGRESSIVE_OPTIMIZATION
-        if (line.empty())
-            // skip orphans
-            continue;
-#endif
-        typename TLine::const_iterator lineIt = line.begin();
-        TInt beg = lineIt->first;
-        if (winEnd <= beg)
-            // we are beyond the window already
-            continue;
-
-        const typename TLine::const_iterator lineItEnd = line.end();
-        do {
-            // make sure the basic window axioms hold
-            CL_BREAK_IF(winEnd <= beg);
-            CL_BREAK_IF(/* end */ it->first <= winBeg);
-
-            const TLeaf &os = lineIt->second;
-            std::copy(os.begin(), os.end(), std::inserter(dst, dst.begin()));
-
-            // increment for next wheel
-            if (lineItEnd == ++lineIt)
-                // end of line
-                break;
-
-            beg = lineIt->first;
-        }
-        while (beg < winEnd);
+    TConstIter it = this->firstCandidate(winBeg);
+    for (; cont_.end() != it && it->beg < winEnd; ++it) {
+        if (winBeg < it->end)
+            dst.insert(it->obj);
     }
 }
 
 template <typename TInt, typename TObj>
 void IntervalArena<TInt, TObj>::exactMatch(TSet &dst, const key_type &key) const
 {
-    typedef typename TCont::const_iterator TEndIt;
-    const TEndIt itEnd = cont_.find(/* end */ key.second);
-    if (cont_.end() == itEnd)
-        // upper bound not found
-        return;
-
-    const TLine &line = itEnd->second;
-    const typename TLine::const_iterator itBeg = line.find(/* beg */ key.first);
-    if (line.end() == itBeg)
-        // lower bound not found
-        return;
-
-    const TLeaf &leaf = itBeg->second;
-    std::copy(leaf.begin(), leaf.end(), std::inserter(dst, dst.begin()));
+    TConstIter it = std::lower_bound(cont_.begin(), cont_.end(), key,
+            BoundsLess());
+    for (; cont_.end() != it && it->beg == key.first && it->end == key.second;
+            ++it)
+        dst.insert(it->obj);
 }
 
 #endif /* H_GUARD_INTARENA_H */
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "plotsink.hh"
+
+#include <cl/cl_msg.hh>
+
+#include "sync.hh"
+
+#include <map>
+#include <sstream>
+
+#include <boost/foreach.hpp>
+
+#include <zlib.h>
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of PlotSink
+PlotSink *PlotSink::inst_ = 0;
+
+struct PlotSink::Private {
+    /// chunks indexed by their 64bit FNV-1a, the text is compared on a hit
+    typedef std::multimap<unsigned long long, int /* id */> TChunkMap;
+
+    std::string                 fileName;
+    gzFile                      file;
+    Mutex                       lock;
+    TChunkMap                   chunks;
+    TChunkList                  chunkById;  ///< text of the chunk (id - 1)
+    int                         lastChunk;
+
+    // statistics
+    int                         cntPlots;
+    int                         cntRefs;
+    unsigned long long          bytesTotal;
+    unsigned long long          bytesStored;
+
+    Private():
+        file(0),
+        lastChunk(0),
+        cntPlots(0),
+        cntRefs(0),
+        bytesTotal(0ULL),
+        bytesStored(0ULL)
+    {
+    }
+
+    bool write(const std::string &str);
+    int chunkId(const std::string &chunk, std::ostream &defs);
+};
+
+bool PlotSink::Private::write(const std::string &str) {
+    if (str.empty())
+        return true;
+
+    const int len = static_cast<int>(str.size());
+    return (len == gzwrite(this->file, str.data(), len));
+}
+
+int PlotSink::Private::chunkId(const std::string &chunk, std::ostream &defs) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    BOOST_FOREACH(const char c, chunk) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+
+    this->bytesTotal += chunk.size();
+
+    typedef std::pair<TChunkMap::const_iterator, TChunkMap::const_iterator>
+        TRange;
+
+    const TRange range = this->chunks.equal_range(hash);
+    for (TChunkMap::const_iterator it = range.first; it != range.second; ++it)
+        if (chunk == this->chunkById[it->second - 1])
+            // already stored
+            return it->second;
+
+    // define a new chunk
+    const int id = ++this->lastChunk;
+    this->chunks.insert(std::make_pair(hash, id));
+    this->chunkById.push_back(chunk);
+    this->bytesStored += chunk.size();
+    defs << "C " << id << " " << chunk.size() << ":" << chunk << "\n";
+    return id;
+}
+
+PlotSink::PlotSink():
+    d(new Private)
+{
+}
+
+PlotSink::~PlotSink() {
+    if (d->file)
+        gzclose(d->file);
+
+    delete d;
+}
+
+bool PlotSink::open(const std::string &fileName) {
+    CL_BREAK_IF(inst_);
+    PlotSink *sink = new PlotSink;
+    Private *d = sink->d;
+
+    d->fileName = fileName;
+    d->file = gzopen(fileName.c_str(), "wb");
+    if (!d->file
+            || !d->write(PLOT_SINK_MAGIC "\n")
+            || Z_OK != gzflush(d->file, Z_SYNC_FLUSH))
+    {
+        CL_ERROR("unable to create file '" << fileName << "'");
+        delete sink;
+        return false;
+    }
+
+    CL_DEBUG("writing heap graphs to '" << fileName << "'...");
+    inst_ = sink;
+    return true;
+}
+
+void PlotSink::close() {
+    if (!inst_)
+        return;
+
+    Private *d = inst_->d;
+    const int rc = gzclose(d->file);
+    d->file = 0;
+    if (Z_OK != rc)
+        CL_ERROR("error while writing file '" << d->fileName << "'");
+
+    CL_DEBUG("PlotSink: " << d->cntPlots << " heap graphs written to '"
+            << d->fileName << "', "
+            << d->lastChunk << "/" << d->cntRefs << " chunks stored, "
+            << (d->bytesStored >> 10) << "/" << (d->bytesTotal >> 10)
+            << " KiB of dot code stored (before compression)");
+
+    delete inst_;
+    inst_ = 0;
+}
+
+bool PlotSink::append(const std::string &name, const TChunkList &chunks) {
+    MutexGuard<Mutex> guard(d->lock);
+    if (!d->file)
+        return false;
+
+    std::ostringstream defs, plot;
+    plot << "P " << chunks.size() << " " << name.size() << ":" << name;
+    BOOST_FOREACH(const std::string &chunk, chunks)
+        plot << " " << d->chunkId(chunk, defs);
+
+    plot << "\n";
+
+    d->cntPlots ++;
+    d->cntRefs += chunks.size();
+
+    // make the graph available even if we do not finish the analysis
+    if (d->write(defs.str())
+            && d->write(plot.str())
+            && Z_OK == gzflush(d->file, Z_SYNC_FLUSH))
+        return true;
+
+    CL_ERROR("unable to write file '" << d->fileName << "'");
+    return false;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_PLOT_SINK_H
+#define H_GUARD_PLOT_SINK_H
+
+/**
+ * @file plotsink.hh
+ * PlotSink - append-only archive of heap graphs with deduplicated chunks
+ *
+ * The archive is a gzip-compressed stream of records.  A record of kind @b C
+ * defines a chunk of the dot code, a record of kind @b P defines a graph as
+ * a sequence of already defined chunks.  Each chunk is stored only once,
+ * no matter how many graphs it appears in:
+ *
+ * @code
+ * slplot 1
+ * C <chunk id> <length>:<chunk>
+ * P <count of chunks> <length>:<name> <chunk id> <chunk id> ...
+ * @endcode
+ *
+ * The graphs can be regenerated by the slplotx utility.
+ */
+
+#include <string>
+#include <vector>
+
+/// the first line of each archive
+#define PLOT_SINK_MAGIC "slplot 1"
+
+// singleton
+class PlotSink {
+    public:
+        /// return the active sink, zero if the graphs go to separate files
+        static PlotSink* instance() {
+            return inst_;
+        }
+
+        /// redirect all heap graphs to the given archive until close()
+        static bool open(const std::string &fileName);
+
+        /// flush and close the archive, if any, and print statistics
+        static void close();
+
+        typedef std::vector<std::string>                    TChunkList;
+
+        /**
+         * append a graph to the archive, chunks not seen so far are stored
+         * @param name name of the graph without the .dot suffix
+         * @param chunks dot code of the graph, split into chunks that are
+         * likely to appear unchanged in other graphs
+         */
+        bool append(const std::string &name, const TChunkList &chunks);
+
+    private:
+        static PlotSink *inst_;
+        PlotSink();
+        ~PlotSink();
+
+        /// object copying is @b not allowed
+        PlotSink(const PlotSink &);
+
+        /// object copying is @b not allowed
+        PlotSink& operator=(const PlotSink &);
+
+    private:
+        struct Private;
+        Private *d;
+};
+
+#endif /* H_GUARD_PLOT_SINK_H */
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file slplotx.cc
+ * regenerate dot files of heap graphs stored in an archive by PlotSink
+ */
+
+#include "plotsink.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+typedef std::vector<long>                               TIdList;
+typedef std::set<long>                                  TIdSet;
+typedef std::set<std::string>                           TNameSet;
+typedef std::map<long, std::string>                     TChunkMap;
+
+/// sequential reader of a gzip-compressed archive
+class ArchiveReader {
+    public:
+        ArchiveReader(const char *fileName):
+            file_(gzopen(fileName, "rb"))
+        {
+        }
+
+        ~ArchiveReader() {
+            if (file_)
+                gzclose(file_);
+        }
+
+        /// return false if the file could not be opened or has bad format
+        bool rewind();
+
+        /**
+         * read the kind of the next record, 'C' for chunk, 'P' for plot
+         * @return zero at the end of the archive
+         */
+        int nextRecord() {
+            return std::max(gzgetc(file_), 0);
+        }
+
+        bool readNum(long *pDst);
+        bool readStr(std::string *pDst);
+        bool skipStr();
+        bool readEol() {
+            return ('\n' == gzgetc(file_));
+        }
+
+    private:
+        gzFile file_;
+};
+
+bool ArchiveReader::rewind() {
+    if (!file_ || gzrewind(file_))
+        return false;
+
+    const std::string magic(PLOT_SINK_MAGIC "\n");
+    std::string buf(magic.size(), '\0');
+    return (static_cast<int>(buf.size()) ==
+                gzread(file_, &buf[0], buf.size()))
+        && (magic == buf);
+}
+
+bool ArchiveReader::readNum(long *pDst) {
+    if (' ' != gzgetc(file_))
+        return false;
+
+    long num = 0L;
+    int c;
+    while (isdigit(c = gzgetc(file_)))
+        num = 10L * num + (c - '0');
+
+    gzungetc(c, file_);
+    *pDst = num;
+    return true;
+}
+
+bool ArchiveReader::readStr(std::string *pDst) {
+    long len;
+    if (!this->readNum(&len) || ':' != gzgetc(file_))
+        return false;
+
+    pDst->resize(len);
+    return !len || (len == gzread(file_, &(*pDst)[0], len));
+}
+
+bool ArchiveReader::skipStr() {
+    long len;
+    if (!this->readNum(&len) || ':' != gzgetc(file_))
+        return false;
+
+    return (0 <= gzseek(file_, len, SEEK_CUR));
+}
+
+/// one pass through the archive
+class ArchivePass {
+    public:
+        ArchivePass(ArchiveReader &ar):
+            ar_(ar)
+        {
+        }
+
+        virtual ~ArchivePass() { }
+
+        bool run();
+
+    protected:
+        /// return true if the chunk of the given ID should be kept in chunks_
+        virtual bool wantChunk(long id) = 0;
+
+        /// called for each plot, all its chunks are already read at that point
+        virtual bool handlePlot(
+                const std::string      &name,
+                const TIdList          &ids) = 0;
+
+    protected:
+        ArchiveReader              &ar_;
+        TChunkMap                   chunks_;
+};
+
+bool ArchivePass::run() {
+    if (!ar_.rewind())
+        return false;
+
+    for (;;) {
+        long id, cnt;
+        std::string name;
+        TIdList ids;
+
+        const int kind = ar_.nextRecord();
+        switch (kind) {
+            case 0:
+                return true;
+
+            case 'C':
+                if (!ar_.readNum(&id))
+                    return false;
+                if (this->wantChunk(id)) {
+                    if (!ar_.readStr(&chunks_[id]))
+                        return false;
+                }
+                else if (!ar_.skipStr())
+                    return false;
+
+                if (!ar_.readEol())
+                    return false;
+                break;
+
+            case 'P':
+                if (!ar_.readNum(&cnt) || !ar_.readStr(&name))
+                    return false;
+
+                ids.resize(cnt);
+                for (long i = 0; i < cnt; ++i)
+                    if (!ar_.readNum(&ids[i]))
+                        return false;
+
+                if (!ar_.readEol() || !this->handlePlot(name, ids))
+                    return false;
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
+
+/// print the names of all plots in the archive
+class ListPass: public ArchivePass {
+    public:
+        ListPass(ArchiveReader &ar):
+            ArchivePass(ar)
+        {
+        }
+
+    protected:
+        virtual bool wantChunk(long) {
+            return false;
+        }
+
+        virtual bool handlePlot(const std::string &name, const TIdList &) {
+            std::cout << name << "\n";
+            return true;
+        }
+};
+
+/// gather IDs of the chunks needed to regenerate the given plots
+class GatherPass: public ArchivePass {
+    public:
+        GatherPass(ArchiveReader &ar, const TNameSet &names, TIdSet &dst):
+            ArchivePass(ar),
+            names_(names),
+            dst_(dst)
+        {
+        }
+
+    protected:
+        virtual bool wantChunk(long) {
+            return false;
+        }
+
+        virtual bool handlePlot(const std::string &name, const TIdList &ids) {
+            if (names_.count(name))
+                dst_.insert(ids.begin(), ids.end());
+
+            return true;
+        }
+
+    private:
+        const TNameSet             &names_;
+        TIdSet                     &dst_;
+};
+
+/// write the given plots (or all plots if no names are given) to dot files
+class ExtractPass: public ArchivePass {
+    public:
+        ExtractPass(
+                ArchiveReader          &ar,
+                const TNameSet         &names,
+                const TIdSet           &ids):
+            ArchivePass(ar),
+            names_(names),
+            ids_(ids),
+            cntWritten_(0)
+        {
+        }
+
+        int cntWritten() const {
+            return cntWritten_;
+        }
+
+    protected:
+        virtual bool wantChunk(long id) {
+            return names_.empty() || ids_.count(id);
+        }
+
+        virtual bool handlePlot(const std::string &name, const TIdList &ids);
+
+    private:
+        const TNameSet             &names_;
+        const TIdSet               &ids_;
+        int                         cntWritten_;
+};
+
+bool ExtractPass::handlePlot(const std::string &name, const TIdList &ids) {
+    if (!names_.empty() && !names_.count(name))
+        return true;
+
+    const std::string fileName(name + ".dot");
+    std::ofstream out(fileName.c_str(), std::ios::binary);
+    for (TIdList::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+        TChunkMap::const_iterator chunk = chunks_.find(*it);
+        if (chunks_.end() == chunk) {
+            std::cerr << "slplotx: undefined chunk #" << *it
+                << " in '" << name << "'\n";
+            return false;
+        }
+
+        out << chunk->second;
+    }
+
+    if (!out.flush()) {
+        std::cerr << "slplotx: unable to write file '" << fileName << "'\n";
+        return false;
+    }
+
+    ++cntWritten_;
+    return true;
+}
+
+void printUsage() {
+    std::cerr
+        << "Usage: slplotx ARCHIVE            list the heap graphs\n"
+        << "       slplotx ARCHIVE NAME...    write NAME.dot for each NAME\n"
+        << "       slplotx -a ARCHIVE         write all the heap graphs\n";
+}
+
+int main(int argc, char *argv[]) {
+    bool all = false;
+    int argi = 1;
+    if (argi < argc && !strcmp("-a", argv[argi])) {
+        all = true;
+        ++argi;
+    }
+
+    if (argc <= argi) {
+        printUsage();
+        return 1;
+    }
+
+    const char *fileName = argv[argi++];
+    ArchiveReader ar(fileName);
+
+    TNameSet names;
+    for (; argi < argc; ++argi)
+        names.insert(argv[argi]);
+
+    bool ok;
+    int cntWritten = 0;
+    if (!all && names.empty()) {
+        ListPass lp(ar);
+        ok = lp.run();
+    }
+    else {
+        // first gather the chunks we need, so that we do not keep all of them
+        TIdSet ids;
+        GatherPass gp(ar, names, ids);
+        ok = names.empty() || gp.run();
+
+        ExtractPass ep(ar, names, ids);
+        ok = ok && ep.run();
+        cntWritten = ep.cntWritten();
+        std::cerr << "slplotx: " << cntWritten << " heap graphs written\n";
+    }
+
+    if (!ok) {
+        std::cerr << "slplotx: unable to read archive '" << fileName << "'\n";
+        return 1;
+    }
+
+    if (cntWritten < static_cast<int>(names.size())) {
+        std::cerr << "slplotx: some of the requested graphs not found\n";
+        return 1;
+    }
+
+    return 0;
+}
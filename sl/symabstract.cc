@@ -30,6 +30,7 @@
 #include "symjoin.hh"
 #include "symdiscover.hh"
 #include "symgc.hh"
+#include "symprof.hh"
 #include "symseg.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
@@ -627,6 +628,7 @@ void adjustAbstractionThreshold(
 
 bool considerAbstraction(
         SymHeap                     &sh,
+        SegDiscovery                &discovery,
         const BindingOff            &off,
         const TValId                entry,
         const unsigned              lenTotal)
@@ -658,6 +660,10 @@ bool considerAbstraction(
 
     CL_DEBUG("    --- length of the longest segment is " << lenTotal);
 
+    // we are going to change the heap, let the next discovery skip the parts
+    // of the heap that we are not going to touch
+    discovery.snapshot();
+
     // cursor
     TValId cursor = entry;
 
@@ -799,12 +805,15 @@ void abstractIfNeeded(SymHeap &sh) {
 #if SE_DISABLE_SLS && SE_DISABLE_DLS
     return;
 #endif
+    ProfScope prof(PP_ABSTRACT);
     BindingOff          off;
     TValId              entry;
     unsigned            len;
 
-    while ((len = discoverBestAbstraction(sh, &off, &entry))) {
-        if (!considerAbstraction(sh, off, entry, len))
+    // rescan only the parts of the heap changed by the previous iteration
+    SegDiscovery discovery(sh);
+    while ((len = discovery.discoverBest(&off, &entry))) {
+        if (!considerAbstraction(sh, discovery, off, entry, len))
             // the best abstraction given is unfortunately not good enough
             break;
 
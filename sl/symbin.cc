@@ -954,7 +954,9 @@ bool BuiltInTable::handleBuiltIn(
 
     SymHeap &sh = core.sh();
     SymDumpRefHeap shRef(&sh);
-    sh.traceUpdate(new Trace::InsnNode(sh.traceNode(), &insn, /* bin */ true));
+    Trace::Node *trInsn =
+        Trace::InsnNode::share(sh.traceNode(), &insn, /* bin */ true);
+    sh.traceUpdate(trInsn);
 
     const THandler hdl = it->second;
     return hdl(dst, core, insn, name);
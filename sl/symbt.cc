@@ -58,10 +58,12 @@ struct SymBackTrace::Private {
     TStackPP                        ppStack;
     TStack                          btStack;
     TMap                            nestMap;
+    unsigned                        cntMsgs;
 
     Private(const CodeStorage::Storage &stor_, const bool ptrace_):
         stor(stor_),
-        ptrace(ptrace_)
+        ptrace(ptrace_),
+        cntMsgs(0)
     {
     }
 
@@ -153,6 +155,9 @@ const CodeStorage::Storage& SymBackTrace::stor() const {
 bool SymBackTrace::printBackTrace(bool forcePtrace) const {
     using namespace CodeStorage;
 
+    // each backtrace belongs to an error or warning being reported
+    ++d->cntMsgs;
+
     Private::TStackPP ppStack(d->ppStack);
     const bool ptrace = !ppStack.empty() && (d->ptrace || forcePtrace);
 
@@ -178,6 +183,10 @@ bool SymBackTrace::printBackTrace(bool forcePtrace) const {
     return true;
 }
 
+unsigned SymBackTrace::cntMsgs() const {
+    return d->cntMsgs;
+}
+
 void SymBackTrace::pushCall(
         const int                       fncId,
         const struct cl_loc             *loc)
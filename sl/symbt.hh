@@ -117,6 +117,9 @@ class SymBackTrace {
         /// unregister the path tracer associated with the topmost function call
         void popPathTracer(const IPathTracer *);
 
+        /// count of errors and warnings reported with this backtrace so far
+        unsigned cntMsgs() const;
+
     protected:
         /**
          * stream out the backtrace, using CL_NOTE_MSG; or do nothing if the
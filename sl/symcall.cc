@@ -31,11 +31,17 @@
 #include "symheap.hh"
 #include "symjoin.hh"
 #include "symproc.hh"
+#include "symprof.hh"
 #include "symstate.hh"
+#include "symsum.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
 #include "util.hh"
 
+#include <algorithm>
+#include <list>
+#include <map>
+#include <set>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -47,16 +53,54 @@ LOCAL_DEBUG_PLOTTER(symcall, DEBUG_SYMCALL)
 class PerFncCache {
     private:
         typedef std::vector<SymCallCtx *> TCtxMap;
+        typedef std::vector<size_t /* HeapFingerprint::shape */> TShapeList;
+        typedef std::map<size_t /* shape */, std::vector<int> > TIndex;
 
         SymHeapUnion    huni_;
         TCtxMap         ctxMap_;
 #if !SE_ENABLE_CALL_CACHE
         SymCallCtx     *null_;
 #endif
+        TShapeList      shapes_;    ///< fingerprints of the entries in huni_
+        TIndex          index_;     ///< entries bucketed by their fingerprints
         int             missCntSinceLastHit_;
 
         int lookupCore(const SymHeap &sh);
 
+        /// entries of huni_ are only looked up, they never reach an error report
+        static void dropTrace(SymHeap &sh) {
+            sh.traceUpdate(new Trace::TransientNode("PerFncCache"));
+        }
+
+        int insertCore(const SymHeap &sh, const HeapFingerprint &fp) {
+            const int idx = ctxMap_.size();
+            SymHeap shDup(sh);
+            dropTrace(shDup);
+            huni_.insertNew(shDup);
+            ctxMap_.push_back((SymCallCtx *) 0);
+            shapes_.push_back(fp.shape);
+            index_[fp.shape].push_back(idx);
+            CL_BREAK_IF(huni_.size() != ctxMap_.size());
+            return idx;
+        }
+
+        void rebuildIndex() {
+            index_.clear();
+            const int cnt = shapes_.size();
+            for (int idx = 0; idx < cnt; ++idx)
+                index_[shapes_[idx]].push_back(idx);
+        }
+
+        void updateShape(int idx) {
+            HeapFingerprint fp;
+            heapFingerprint(&fp, huni_[idx]);
+            if (fp.shape == shapes_[idx])
+                return;
+
+            shapes_[idx] = fp.shape;
+            this->rebuildIndex();
+        }
+
         void cacheHit() {
             if (0 < missCntSinceLastHit_)
                 missCntSinceLastHit_ = 0;
@@ -100,8 +144,24 @@ class PerFncCache {
             }
 
             CL_BREAK_IF(!areEqual(of, huni_[idx]));
-            Trace::waiveCloneOperation(by);
+            dropTrace(by);
             huni_.swapExisting(idx, by);
+            this->updateShape(idx);
+        }
+
+        /// remove the given (already computed) ctx from the cache
+        void evict(SymCallCtx *ctx) {
+            const TCtxMap::iterator it =
+                std::find(ctxMap_.begin(), ctxMap_.end(), ctx);
+            CL_BREAK_IF(ctxMap_.end() == it);
+
+            const int idx = it - ctxMap_.begin();
+            huni_.eraseExisting(idx);
+            ctxMap_.erase(it);
+            shapes_.erase(shapes_.begin() + idx);
+            this->rebuildIndex();
+
+            delete ctx;
         }
 
         /**
@@ -116,6 +176,16 @@ class PerFncCache {
             return null_ = 0;
 #endif
         }
+
+        /// insert a ctx for the given heap, which is known to be not yet in
+        SymCallCtx*& insertNew(const SymHeap &sh) {
+            HeapFingerprint fp;
+            heapFingerprint(&fp, sh);
+            return ctxMap_[this->insertCore(sh, fp)];
+        }
+
+        /// append the computed entries safe to be reused by other runs to dst
+        void exportSummaries(TCallSummaryList &dst) const;
 };
 
 int PerFncCache::lookupCore(const SymHeap &sh) {
@@ -125,10 +195,19 @@ int PerFncCache::lookupCore(const SymHeap &sh) {
     const int       cnt = huni_.size();
     int             idx;
 
+    JoinSummary js;
+    joinSummary(&js, sh);
+
     // try join
     for(idx = 0; idx < cnt; ++idx) {
+        const JoinSummary &jsIn = huni_.joinSummaryOf(idx);
+        if (!joinMayMatch(jsIn, js))
+            // joinSymHeaps() would fail anyway
+            continue;
+
         const SymHeap &shIn = huni_[idx];
-        if (!joinSymHeaps(&status, &result, shIn, sh))
+        if (!joinSymHeaps(&status, &result, shIn, sh, /* 3-way */ true,
+                    &jsIn, &js))
             // join failed with this heap, try the next one
             continue;
 
@@ -160,30 +239,38 @@ int PerFncCache::lookupCore(const SymHeap &sh) {
         else {
             CL_BREAK_IF(JS_USE_SH2 != status);
             SymHeap shDup(sh);
-            Trace::waiveCloneOperation(shDup);
+            dropTrace(shDup);
             huni_.swapExisting(idx, shDup);
         }
 
+        this->updateShape(idx);
         this->cacheHit();
         return idx;
     }
 
+    HeapFingerprint fp;
+    heapFingerprint(&fp, sh);
+
 #else // 1 == SE_ENABLE_CALL_CACHE means "graph isomorphism only"
-    int idx = huni_.lookup(sh);
-    if (-1 != idx) {
-        this->cacheHit();
-        return idx;
+    // only the entries with the same fingerprint can be isomorphic
+    HeapFingerprint fp;
+    heapFingerprint(&fp, sh);
+
+    const TIndex::const_iterator it = index_.find(fp.shape);
+    if (index_.end() != it) {
+        BOOST_FOREACH(const int idx, /* std::vector<int> */ it->second) {
+            if (!areEqual(sh, huni_[idx]))
+                continue;
+
+            this->cacheHit();
+            return idx;
+        }
     }
 #endif
 
     // cache miss
-    idx = ctxMap_.size();
-    huni_.insertNew(sh);
-    ctxMap_.push_back((SymCallCtx *) 0);
-    CL_BREAK_IF(huni_.size() != ctxMap_.size());
-
     ++missCntSinceLastHit_;
-    return idx;
+    return this->insertCore(sh, fp);
 }
 
 
@@ -194,17 +281,48 @@ struct SymCallCache::Private {
     typedef CodeStorage::TVarSet                        TFncVarSet;
     typedef std::map<int /* uid */, PerFncCache>        TCache;
     typedef std::vector<SymCallCtx *>                   TCtxStack;
+    typedef std::list<SymCallCtx *>                     TLru;
+
+    struct FncStats {
+        unsigned long           hits;
+        unsigned long           misses;
+        unsigned long           evictions;
+
+        FncStats(): hits(0), misses(0), evictions(0) { }
+    };
 
+    typedef std::map<int /* uid */, FncStats>           TStats;
+    typedef std::set<int /* uid */>                     TFncSet;
+
+    /// computed ctxs, the least recently used first (needs to outlive cache)
+    TLru                        lru;
+    size_t                      lruCost;
     TCache                      cache;
     TCtxStack                   ctxStack;
     SymBackTrace                bt;
+    TStats                      stats;
+    SummaryStore               *sumStore;
+    TFncSet                     sumLoaded;  ///< fncs we have asked sumStore for
+    TFncSet                     sumDirty;   ///< fncs with new clean ctxs
+    unsigned long               cntDirtyHits;
 
     void importGlVar(SymHeap &sh, const CVar &cv);
     void resolveHeapCut(TCVarList &cut, SymHeap &sh, TFncRef &fnc);
     SymCallCtx* getCallCtx(const SymHeap &entry, TFncRef fnc);
+    void evictIfNeeded();
+    void loadSummaries(TFncRef fnc);
+    void saveSummaries();
+
+    /// grows whenever something is reported that a cache hit would not repeat
+    unsigned long cntDirt() const {
+        return bt.cntMsgs() + cntDirtyHits;
+    }
 
     Private(TStorRef stor, bool ptrace):
-        bt(stor, ptrace)
+        lruCost(0),
+        bt(stor, ptrace),
+        sumStore(0),
+        cntDirtyHits(0)
     {
     }
 };
@@ -221,9 +339,15 @@ struct SymCallCtx::Private {
     int                         nestLevel;
     bool                        computed;
     bool                        flushed;
+    bool                        inLru;
+    SymCallCache::Private::TLru::iterator lruPos;
+    size_t                      cost;
+    unsigned long               dirtAtStart;
+    bool                        clean;      ///< no messages while computing
 
     void assignReturnValue(SymHeap &sh);
     void destroyStackFrame(SymHeap &sh);
+    void enterLru(SymCallCtx *self);
 
     Private(SymCallCache::Private *cd_):
         cd(cd_),
@@ -233,17 +357,51 @@ struct SymCallCtx::Private {
         callFrame(cd_->bt.stor(),
                 new Trace::TransientNode("SymCallCtx::Private::callFrame")),
         computed(false),
-        flushed(false)
+        flushed(false),
+        inLru(false),
+        cost(0),
+        dirtAtStart(0),
+        clean(false)
     {
     }
 };
 
+void SymCallCtx::Private::enterLru(SymCallCtx *self) {
+    CL_BREAK_IF(this->inLru);
+
+    // estimate the amount of memory we are going to keep
+    this->cost = this->entry.lastId();
+    BOOST_FOREACH(const SymHeap *sh, this->rawResults)
+        this->cost += sh->lastId();
+
+    SymCallCache::Private::TLru &lru = this->cd->lru;
+    this->lruPos = lru.insert(lru.end(), self);
+    this->cd->lruCost += this->cost;
+    this->inLru = true;
+}
+
+void PerFncCache::exportSummaries(TCallSummaryList &dst) const {
+    BOOST_FOREACH(const SymCallCtx *ctx, ctxMap_) {
+        if (!ctx || !ctx->d->computed || !ctx->d->clean)
+            continue;
+
+        CallSummary sum(ctx->d->entry);
+        sum.results = ctx->d->rawResults;
+        dst.push_back(sum);
+    }
+}
+
 SymCallCtx::SymCallCtx(SymCallCache::Private *cd):
     d(new Private(cd))
 {
 }
 
 SymCallCtx::~SymCallCtx() {
+    if (d->inLru) {
+        d->cd->lru.erase(d->lruPos);
+        d->cd->lruCost -= d->cost;
+    }
+
     delete d;
 }
 
@@ -382,7 +540,7 @@ void joinHeapsWithCare(
         ? new CallDoneNode(trResult.node(), trFrame.node(), fnc)
         : new CallDoneNode(trResult.node(), fnc);
 
-    joinHeapsByCVars(&sh, &callFrame);
+    joinHeapsByCVars(&sh, &callFrame, /* src2IsSharedFrame */ true);
     sh.traceUpdate(trDone);
     LDP_PLOT(symcall, sh);
 }
@@ -397,6 +555,14 @@ void SymCallCtx::flushCallResults(SymState &dst) {
     CL_BREAK_IF(this != d->cd->ctxStack.back());
     d->cd->ctxStack.pop_back();
 
+    if (!d->computed) {
+        // the results can be reused by other runs if nothing has been reported
+        // while computing them (the messages would not be repeated on reuse)
+        d->clean = (d->dirtAtStart == d->cd->cntDirt());
+        if (d->clean)
+            d->cd->sumDirty.insert(uidOf(*d->fnc));
+    }
+
     // go through the results and make them of the form that the caller likes
     const unsigned cnt = d->rawResults.size();
     for (unsigned i = 0; i < cnt; ++i) {
@@ -438,10 +604,21 @@ void SymCallCtx::flushCallResults(SymState &dst) {
         dst.insert(sh);
     }
 
+    if (!d->inLru)
+        // just computed
+        d->enterLru(this);
+
     // mark as done
     d->computed = true;
     d->flushed = true;
 
+    // till the next call, neither the entry nor the frame can reach an error
+    // report, so do not let them keep the trace of this call site alive
+    TStorRef stor = d->entry.stor();
+    d->entry.traceUpdate(new TransientNode("SymCallCtx::Private::entry"));
+    d->callFrame = SymHeap(stor,
+            new TransientNode("SymCallCtx::Private::callFrame"));
+
     // leave backtrace
     d->cd->bt.popCall();
 }
@@ -485,13 +662,42 @@ SymCallCache::SymCallCache(TStorRef stor, bool ptrace):
 }
 
 SymCallCache::~SymCallCache() {
+    if (d->sumStore) {
+        d->saveSummaries();
+        delete d->sumStore;
+    }
+
     delete d;
 }
 
+void SymCallCache::enableSummaries(
+        const std::string               &dir,
+        const std::string               &tag)
+{
+    CL_BREAK_IF(d->sumStore);
+    d->sumStore = new SummaryStore(d->bt.stor(), dir, tag);
+}
+
 SymBackTrace& SymCallCache::bt() {
     return d->bt;
 }
 
+void SymCallCache::printStats() const {
+    TStorRef stor = d->bt.stor();
+    BOOST_FOREACH(Private::TStats::const_reference item, d->stats) {
+        const CodeStorage::Fnc &fnc = *stor.fncs[/* uid */ item.first];
+        const Private::FncStats &fs = item.second;
+        CL_DEBUG_MSG(locationOf(fnc), "SymCallCache: " << nameOf(fnc) << "()"
+                << ": " << fs.hits << " hit(s)"
+                << ", " << fs.misses << " miss(es)"
+                << ", " << fs.evictions << " eviction(s)");
+    }
+
+    CL_DEBUG("SymCallCache: " << d->lru.size() << " computed entries kept"
+            << ", estimated cost " << d->lruCost << " (budget "
+            << SE_CALL_CACHE_BUDGET << ")");
+}
+
 void pullGlVar(SymHeap &result, SymHeap origin, const CVar &cv) {
     // do not try to combine things, it causes problems
     CL_BREAK_IF(!areEqual(result, SymHeap(origin.stor(), origin.traceNode())));
@@ -685,16 +891,87 @@ void setCallArgs(
     srcProc.killInsn(insn);
 }
 
+void SymCallCache::Private::evictIfNeeded() {
+#if SE_CALL_CACHE_BUDGET
+    TLru::iterator it = this->lru.begin();
+    while (SE_CALL_CACHE_BUDGET < this->lruCost && this->lru.end() != it) {
+        SymCallCtx *ctx = *it++;
+        if (ctx->inUse())
+            // used by the current backtrace, we cannot drop it now
+            continue;
+
+        const int uid = uidOf(*ctx->d->fnc);
+        CL_DEBUG_MSG(locationOf(*ctx->d->fnc),
+                "SE_CALL_CACHE_BUDGET exceeded, evicting a call cache entry of "
+                << nameOf(*ctx->d->fnc) << "()");
+
+        // this removes the ctx from lru, so that 'it' remains valid
+        this->cache[uid].evict(ctx);
+        ++this->stats[uid].evictions;
+    }
+#endif
+}
+
+void SymCallCache::Private::loadSummaries(TFncRef fnc) {
+    TCallSummaryList sums;
+    if (!this->sumStore->load(sums, fnc))
+        return;
+
+    PerFncCache &pfc = this->cache[uidOf(fnc)];
+    BOOST_FOREACH(const CallSummary &sum, sums) {
+        SymCallCtx *&ctx = pfc.insertNew(sum.entry);
+        ctx = new SymCallCtx(this);
+        ctx->d->fnc     = &fnc;
+        ctx->d->entry   = sum.entry;
+        Trace::waiveCloneOperation(ctx->d->entry);
+
+        BOOST_FOREACH(const SymHeap *sh, sum.results)
+            ctx->d->rawResults.insert(*sh);
+
+        // the ctx is ready to be used as if we have just computed it
+        ctx->d->computed    = true;
+        ctx->d->flushed     = true;
+        ctx->d->clean       = true;
+        ctx->d->enterLru(ctx);
+    }
+}
+
+void SymCallCache::Private::saveSummaries() {
+    TStorRef stor = this->bt.stor();
+    BOOST_FOREACH(const int uid, this->sumDirty) {
+        const TCache::const_iterator it = this->cache.find(uid);
+        if (this->cache.end() == it)
+            // removed from the cache in the meanwhile
+            continue;
+
+        TCallSummaryList sums;
+        it->second.exportSummaries(sums);
+        if (!sums.empty())
+            this->sumStore->save(*stor.fncs[uid], sums);
+    }
+}
+
 SymCallCtx* SymCallCache::Private::getCallCtx(const SymHeap &entry, TFncRef fnc) {
-    // cache lookup
+    // make some room for the entry we may need to create
+    this->evictIfNeeded();
+
     const int uid = uidOf(fnc);
+#if SE_ENABLE_CALL_CACHE
+    if (this->sumStore && insertOnce(this->sumLoaded, uid))
+        // the first call of fnc, check what we have from the previous runs
+        this->loadSummaries(fnc);
+#endif
+
+    // cache lookup
     PerFncCache &pfc = this->cache[uid];
     SymCallCtx *&ctx = pfc.lookup(entry);
     if (!ctx) {
         // cache miss
+        ++this->stats[uid].misses;
         ctx = new SymCallCtx(this);
         ctx->d->fnc     = &fnc;
         ctx->d->entry   = entry;
+        ctx->d->dirtAtStart = this->cntDirt();
         Trace::waiveCloneOperation(ctx->d->entry);
 
         // enter ctx stack
@@ -721,6 +998,14 @@ SymCallCtx* SymCallCache::Private::getCallCtx(const SymHeap &entry, TFncRef fnc)
     // enter ctx stack
     this->ctxStack.push_back(ctx);
 
+    // keep the most recently used ctx at the end of lru
+    ++this->stats[uid].hits;
+    this->lru.splice(this->lru.end(), this->lru, ctx->d->lruPos);
+
+    if (!ctx->d->clean)
+        // the messages reported while computing ctx are not going to repeat
+        ++this->cntDirtyHits;
+
     // all OK, return the cached ctx
     return ctx;
 }
@@ -730,6 +1015,7 @@ SymCallCtx* SymCallCache::getCallCtx(
         const CodeStorage::Fnc          &fnc,
         const CodeStorage::Insn         &insn)
 {
+    ProfScope prof(PP_CALL_CACHE);
     const struct cl_loc *loc = &insn.loc;
     CL_DEBUG_MSG(loc, "SymCallCache is looking for " << nameOf(fnc) << "()...");
 
@@ -769,7 +1055,9 @@ SymCallCtx* SymCallCache::getCallCtx(
 
     SymHeap callFrame(entry.stor(), trFrame);
     splitHeapByCVars(&entry, cut, &callFrame);
-    callFrame.valDestroyTarget(VAL_ADDR_OF_RET);
+    if (isPossibleToDeref(callFrame.valTarget(VAL_ADDR_OF_RET)))
+        // the frame may share an already destroyed VAL_ADDR_OF_RET with caller
+        callFrame.valDestroyTarget(VAL_ADDR_OF_RET);
     entry.traceUpdate(trEntry);
 
     LDP_PLOT(symcall, entry);
@@ -28,6 +28,8 @@
 
 #include "symheap.hh"
 
+#include <string>
+
 class SymBackTrace;
 class SymState;
 class SymCallCtx;
@@ -46,6 +48,17 @@ class SymCallCache {
 
         SymBackTrace& bt();
 
+        /// print hits, misses and evictions per function in verbose mode
+        void printStats() const;
+
+        /**
+         * load the results of functions computed by the previous runs from
+         * the given directory, and save the newly computed ones on destruction
+         * @param dir directory to keep the function summaries in
+         * @param tag anything else the results depend on (run-time options)
+         */
+        void enableSummaries(const std::string &dir, const std::string &tag);
+
         /**
          * cache entry point.  This returns either existing, or a newly created
          * call context.
@@ -22,6 +22,7 @@
 
 #include <cl/cl_msg.hh>
 
+#include "symprof.hh"
 #include "symseg.hh"
 #include "symutil.hh"
 #include "util.hh"
@@ -336,6 +337,7 @@ bool areEqual(
         const SymHeap           &sh1,
         const SymHeap           &sh2)
 {
+    ProfScope prof(PP_CMP);
     SymHeap &sh1Writable = const_cast<SymHeap &>(sh1);
     SymHeap &sh2Writable = const_cast<SymHeap &>(sh2);
 
@@ -366,3 +368,92 @@ bool areEqual(
     return sh1.matchPreds(sh2, vMap[0])
         && sh2.matchPreds(sh1, vMap[1]);
 }
+
+namespace {
+    inline void mixHash(size_t &seed, const size_t val) {
+        seed ^= val + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    size_t rootFingerprint(
+            const SymHeap           &sh,
+            const TValId            root,
+            const bool              seenAsAbstract)
+    {
+        size_t hash = 0;
+
+        // these are checked by matchRoots() for each pair of roots
+        const TSizeRange size = sh.valSizeOfTarget(root);
+        mixHash(hash, size.lo);
+        mixHash(hash, size.hi);
+        mixHash(hash, sh.valTargetProtoLevel(root));
+
+        TUniBlockMap bMap;
+        sh.gatherUniformBlocks(bMap, root);
+        mixHash(hash, bMap.size());
+
+        if (!seenAsAbstract)
+            // kind and minimal length are compared for abstract targets only
+            return hash;
+
+        mixHash(hash, sh.valTargetKind(root));
+        mixHash(hash, sh.segMinLength(root));
+        return hash;
+    }
+}
+
+void heapFingerprint(HeapFingerprint *pDst, const SymHeap &shRO) {
+    SymHeap &sh = const_cast<SymHeap &>(shRO);
+
+    size_t shape = 0;
+
+    // start with program variables (in the order given by their CVar)
+    TCVarSet vars;
+    gatherProgramVars(vars, sh);
+
+    typedef std::map<TValId, bool /* seen as abstract */> TRootMap;
+    TRootMap roots;
+    WorkList<TValId> wl;
+    BOOST_FOREACH(const CVar &cv, vars) {
+        mixHash(shape, cv.uid);
+        mixHash(shape, cv.inst);
+
+        const TValId root = sh.addrOfVar(cv, /* createIfNeeded */ false);
+        roots[root] = false;
+        wl.schedule(root);
+    }
+
+    // go through all roots reachable from program variables
+    TValId root;
+    while (wl.next(root)) {
+        ObjList objs;
+        sh.gatherLiveObjects(objs, root);
+        BOOST_FOREACH(const ObjHandle &obj, objs) {
+            const TValId val = obj.value();
+            if (val <= 0)
+                continue;
+
+            const EValueTarget code = sh.valTarget(val);
+            if (!isPossibleToDeref(code))
+                continue;
+
+            // VT_RANGE values do not expose the kind of their target
+            const TValId next = sh.valRoot(val);
+            bool &seenAsAbstract = roots[next];
+            if (isAbstract(code))
+                seenAsAbstract = true;
+
+            wl.schedule(next);
+        }
+    }
+
+    // the order of roots is not preserved by isomorphism, combine them by sum
+    size_t sum = 0;
+    BOOST_FOREACH(TRootMap::const_reference item, roots)
+        sum += rootFingerprint(sh, /* root */ item.first, item.second);
+
+    mixHash(shape, roots.size());
+    mixHash(shape, sum);
+    mixHash(shape, sh.cntNeqPreds());
+
+    pDst->shape = shape;
+}
@@ -65,4 +65,24 @@ bool matchUniBlocks(
         const TValId            root1,
         const TValId            root2);
 
+/// summary of a symbolic heap that is cheap to compare, see heapFingerprint()
+struct HeapFingerprint {
+    size_t              shape;      ///< hash of the isomorphism-invariant shape
+
+    HeapFingerprint():
+        shape(0)
+    {
+    }
+};
+
+/**
+ * compute an isomorphism-invariant fingerprint of the given symbolic heap
+ *
+ * The shape covers the set of program variables, the count of Neq predicates
+ * and the multiset of root objects reachable from program variables (size,
+ * prototype level, count of uniform blocks, kind and minimal length of
+ * segments).  If areEqual(sh1, sh2) holds, the shapes of sh1 and sh2 are equal.
+ */
+void heapFingerprint(HeapFingerprint *pDst, const SymHeap &sh);
+
 #endif /* H_GUARD_SYM_CMP_H */
@@ -329,7 +329,8 @@ void deepCopy(DeepCopyData &dc) {
 }
 
 void prune(const SymHeap &src, SymHeap &dst,
-           /* NON-const */ DeepCopyData::TCut &cut, bool forwardOnly = false)
+           /* NON-const */ DeepCopyData::TCut &cut, bool forwardOnly = false,
+           TValSet *pRootsTaken = 0)
 {
     DeepCopyData dc(src, dst, cut, !forwardOnly);
     DeepCopyData::TCut snap(cut);
@@ -348,8 +349,223 @@ void prune(const SymHeap &src, SymHeap &dst,
 
     // go through the worklist
     deepCopy(dc);
+
+    if (!pRootsTaken)
+        return;
+
+    // collect the roots of all objects that we have copied from 'src'
+    BOOST_FOREACH(TValMap::const_reference item, dc.valMap) {
+        const TValId root = src.valRoot(item.first);
+        if (root <= 0 || VAL_ADDR_OF_RET == root)
+            continue;
+
+        if (isPossibleToDeref(src.valTarget(root)))
+            pRootsTaken->insert(root);
+    }
 }
 
+#if SE_SYMCUT_ZERO_COPY
+/**
+ * true if a heap with cntIds IDs and cntRoots live roots holds more than twice
+ * as many IDs per live root as a compact heap with cntIdsRef IDs and
+ * cntRootsRef live roots, i.e. if the greater part of it is made of dead
+ * (VT_DELETED/VT_LOST) entities
+ */
+bool isSparse(
+        const unsigned long         cntIds,
+        const unsigned long         cntRoots,
+        const unsigned long         cntIdsRef,
+        const unsigned long         cntRootsRef)
+{
+    const unsigned long idsPerRoot = 1UL + cntIdsRef / (1UL + cntRootsRef);
+    return 2UL * idsPerRoot * (1UL + cntRoots) < cntIds;
+}
+
+/**
+ * collect the roots that prune() would take from 'src' when cutting it by cset
+ * (enlarging cset the same way as prune() does), without copying anything
+ *
+ * @return a rough count of IDs the roots taken are made of
+ */
+unsigned long gatherRootsTaken(
+        TValSet                     &rootsTaken,
+        DeepCopyData::TCut          &cset,
+        const SymHeap               &src)
+{
+    SymHeap &sh = /* XXX */ const_cast<SymHeap &>(src);
+
+    WorkList<TValId> wl;
+    BOOST_FOREACH(const CVar &cv, cset)
+        wl.schedule(sh.addrOfVar(cv, /* createIfNeeded */ false));
+
+    if (sh.valLastKnownTypeOfTarget(VAL_ADDR_OF_RET))
+        wl.schedule(VAL_ADDR_OF_RET);
+
+    unsigned long cntIds = 0UL;
+
+    TValId root;
+    while (wl.next(root)) {
+        if (VAL_ADDR_OF_RET != root)
+            rootsTaken.insert(root);
+
+        if (isProgramVar(sh.valTarget(root)))
+            // enlarge the cut if needed
+            cset.insert(sh.cVarByRoot(root));
+
+        // go from the root backward, as trackUses() does
+        ObjList refs;
+        sh.pointedBy(refs, root);
+        BOOST_FOREACH(const ObjHandle &obj, refs)
+            wl.schedule(sh.valRoot(obj.placedAt()));
+
+        // go forward through all values stored in the root, as deepCopy() does
+        ObjList objs;
+        sh.gatherLiveObjects(objs, root);
+        cntIds += 1UL + 2UL * objs.size();
+        BOOST_FOREACH(const ObjHandle &obj, objs) {
+            if (isComposite(obj.objType(), /* includingArray */ false))
+                continue;
+
+            const TValId val = obj.value();
+            if (val <= 0)
+                continue;
+
+            const TValId valRoot = sh.valRoot(val);
+            if (VAL_NULL == valRoot)
+                continue;
+
+            if (isPossibleToDeref(sh.valTarget(valRoot))) {
+                wl.schedule(valRoot);
+                continue;
+            }
+
+            // a value that is not an address, take all objects that use it
+            ObjList uses;
+            sh.usedBy(uses, val, /* liveOnly */ true);
+            BOOST_FOREACH(const ObjHandle &use, uses)
+                wl.schedule(sh.valRoot(use.placedAt()));
+        }
+    }
+
+    return cntIds;
+}
+
+/**
+ * true if it is cheaper to share 'src' with the callee and destroy the roots
+ * not taken (see shareEntry()) than to copy the roots taken by prune().  This
+ * holds if the roots taken outnumber the rest of the heap at least 1:2, and
+ * 'src' is not sparse already (otherwise the dead entities of 'src' would be
+ * passed to the callee and from there, through the cached results, back to the
+ * callers without any bound).
+ */
+bool isEntryDense(
+        const SymHeap               &src,
+        const TValSet               &rootsTaken,
+        const unsigned long         cntIdsTaken)
+{
+    const unsigned long cntTaken = rootsTaken.size();
+    const unsigned long cntAll = src.cntLiveRoots();
+    CL_BREAK_IF(cntAll < cntTaken);
+    if (2UL * cntTaken <= cntAll - cntTaken)
+        return false;
+
+    return !isSparse(src.lastId(), cntAll, cntIdsTaken, cntTaken);
+}
+
+/// turn the fresh heap 'entry' into a shared copy of 'src' with rootsTaken only
+void shareEntry(SymHeap &entry, const SymHeap &src, const TValSet &rootsTaken)
+{
+    // take all the entities of 'src' copy-on-write, keep the trace of 'entry'
+    SymHeap sh(src);
+    sh.traceUpdate(entry.traceNode());
+
+    // no root taken can be reached from the rest of the heap and vice versa,
+    // so the rest of the heap can be dropped as a whole
+    TValList live;
+    sh.gatherRootObjects(live);
+    BOOST_FOREACH(const TValId root, live)
+        if (!hasKey(rootsTaken, root))
+            sh.valDestroyTarget(root);
+
+    entry.swap(sh);
+}
+
+/// turn the fresh heap 'frame' into a shared copy of 'src' without rootsTaken
+void shareFrame(SymHeap &frame, const SymHeap &src, const TValSet &rootsTaken)
+{
+    // take all the entities of 'src' copy-on-write, keep the trace of 'frame'
+    SymHeap sh(src);
+    sh.traceUpdate(frame.traceNode());
+
+    // the part of the heap taken by the other side cannot be reached from the
+    // rest of the heap, so we just drop it (only the entities touched by this
+    // get actually copied)
+    BOOST_FOREACH(const TValId root, rootsTaken)
+        sh.valDestroyTarget(root);
+
+    frame.swap(sh);
+}
+
+/**
+ * each call joined by joinIntoShared() leaves the roots destroyed by
+ * shareFrame() in the caller's heap as dead (VT_DELETED/VT_LOST) entities,
+ * which are never reclaimed since SH_REUSE_FREE_IDS is off.  Once the frame
+ * holds more than twice as many IDs per live root as the result of the call
+ * (built by a deep copy), we rather join by a deep copy of the frame, which
+ * drops all the dead entities.  This keeps the dead part of the caller's heap
+ * below roughly a half of it, no matter how many calls have been made.
+ */
+bool isFrameSparse(const SymHeap &frame, const SymHeap &result)
+{
+    return isSparse(frame.lastId(), frame.cntLiveRoots(),
+                    result.lastId(), result.cntLiveRoots());
+}
+
+/// cut 'src' by cset into 'entry', either by a deep copy, or by shareEntry()
+void cutEntry(
+        SymHeap                     &entry,
+        const SymHeap               &src,
+        DeepCopyData::TCut          &cset,
+        TValSet                     &rootsTaken)
+{
+    const unsigned long cntIds = gatherRootsTaken(rootsTaken, cset, src);
+    if (isEntryDense(src, rootsTaken, cntIds)) {
+        // the callee takes the most of 'src', share it with the callee
+        shareEntry(entry, src, rootsTaken);
+        return;
+    }
+
+#ifdef NDEBUG
+    prune(src, entry, cset);
+#else
+    // check that prune() takes the same roots as gatherRootsTaken() does
+    TValSet rootsPruned;
+    prune(src, entry, cset, /* forwardOnly */ false, &rootsPruned);
+    CL_BREAK_IF(rootsPruned != rootsTaken);
+#endif
+}
+
+/// join *srcDst into a shared copy of the frame src2 (see shareFrame())
+void joinIntoShared(SymHeap *srcDst, const SymHeap &src2)
+{
+    SymHeap dst(src2);
+    dst.traceUpdate(srcDst->traceNode());
+
+    // VAL_ADDR_OF_RET is not covered by program variables, take it over
+    const TObjType clt = srcDst->valLastKnownTypeOfTarget(VAL_ADDR_OF_RET);
+    if (clt)
+        dst.valSetLastKnownTypeOfTarget(VAL_ADDR_OF_RET, clt);
+
+    // gather _all_ program variables of *srcDst
+    DeepCopyData::TCut cset;
+    gatherProgramVars(cset, *srcDst);
+
+    // forward-only merge of *srcDst into dst
+    prune(*srcDst, dst, cset, /* optimization */ true);
+    srcDst->swap(dst);
+}
+#endif
+
 void splitHeapByCVars(
         SymHeap                     *srcDst,
         const TCVarList             &cut,
@@ -378,7 +594,14 @@ void splitHeapByCVars(
     const unsigned cntOrig = cset.size();
 #endif
     SymHeap dst(srcDst->stor(), new Trace::TransientNode("splitHeapByCVars()"));
-    prune(*srcDst, dst, cset);
+#if SE_SYMCUT_ZERO_COPY
+    // remember what we take from *srcDst so that we can share the rest of it
+    TValSet rootsTaken;
+    if (saveFrameTo)
+        cutEntry(dst, *srcDst, cset, rootsTaken);
+    else
+#endif
+        prune(*srcDst, dst, cset);
 
     if (!saveFrameTo) {
         // we're done
@@ -400,7 +623,11 @@ void splitHeapByCVars(
             complement.insert(cv);
 
     // compute the corresponding frame
+#if SE_SYMCUT_ZERO_COPY
+    shareFrame(*saveFrameTo, *srcDst, rootsTaken);
+#else
     prune(*srcDst, *saveFrameTo, complement);
+#endif
 
     // print some statistics
 #if DEBUG_SYMCUT || !defined NDEBUG
@@ -437,10 +664,20 @@ void splitHeapByCVars(
 
 void joinHeapsByCVars(
         SymHeap                     *srcDst,
-        const SymHeap               *src2)
+        const SymHeap               *src2,
+        const bool                  src2IsSharedFrame)
 {
 #if SE_DISABLE_SYMCUT
     return;
+#endif
+#if SE_SYMCUT_ZERO_COPY
+    if (src2IsSharedFrame && !isFrameSparse(*src2, *srcDst)) {
+        // *src2 shares its entities with the caller, copy the other way
+        joinIntoShared(srcDst, *src2);
+        return;
+    }
+#else
+    (void) src2IsSharedFrame;
 #endif
     // gather _all_ program variables of *src2
     DeepCopyData::TCut cset;
@@ -39,7 +39,8 @@ class SymBackTrace;
  * @param cut list of program variables to cut the heap by
  * @param saveFrameTo if not null, it must point to a fresh instance of
  * SymHeap; it will be used to stored the (possibly empty) part of heap that is
- * cut off
+ * cut off (with SE_SYMCUT_ZERO_COPY, both *srcDst and *saveFrameTo may then
+ * share their entities with the original heap)
  */
 void splitHeapByCVars(
         SymHeap                     *srcDst,
@@ -50,9 +51,13 @@ void splitHeapByCVars(
  * split two disjunct symbolic heaps together, going from program variables
  * @param srcDst the instance of heap to operate on
  * @param src2 the other instance of heap, which is used read-only
+ * @param src2IsSharedFrame true if *src2 was obtained as saveFrameTo from
+ * splitHeapByCVars(), so that it may share its entities with the caller's heap
+ * (only relevant with SE_SYMCUT_ZERO_COPY)
  */
 void joinHeapsByCVars(
         SymHeap                     *srcDst,
-        const SymHeap               *src2);
+        const SymHeap               *src2,
+        bool                        src2IsSharedFrame = false);
 
 #endif /* H_GUARD_SYM_CUT_H */
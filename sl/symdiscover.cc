@@ -28,9 +28,11 @@
 #include "symjoin.hh"
 #include "symseg.hh"
 #include "symutil.hh"
+#include "sync.hh"
 #include "util.hh"
 
 #include <algorithm>                // for std::copy()
+#include <map>
 #include <set>
 
 #include <boost/foreach.hpp>
@@ -512,12 +514,31 @@ bool slSegOnPath(
 struct SegCandidate {
     TValId                      entry;
     TBindingCandidateList       offList;
+    std::vector<TRankMap>       rankList;   ///< segDiscover() per each offList
 };
 
 typedef std::vector<SegCandidate> TSegCandidateList;
 
-unsigned /* len */ selectBestAbstraction(
+/// collect binding candidates of the given entry and discover their segments
+bool /* found any */ probeSegEntry(
+        SegCandidate                *pSegc,
         SymHeap                     &sh,
+        const TValId                at)
+{
+    // use ProbeEntryVisitor visitor to validate the potential segment entry
+    pSegc->entry = at;
+    const ProbeEntryVisitor visitor(pSegc->offList, at);
+    traverseLivePtrs(sh, at, visitor);
+
+    const unsigned cnt = pSegc->offList.size();
+    pSegc->rankList.resize(cnt);
+    for (unsigned i = 0; i < cnt; ++i)
+        segDiscover(pSegc->rankList[i], sh, pSegc->offList[i], at);
+
+    return !!cnt;
+}
+
+unsigned /* len */ selectBestAbstraction(
         const TSegCandidateList     &candidates,
         BindingOff                  *pOff,
         TValId                      *entry)
@@ -540,9 +561,10 @@ unsigned /* len */ selectBestAbstraction(
 
         // go through binding candidates
         const SegCandidate &segc = candidates[idx];
-        BOOST_FOREACH(const BindingOff &off, segc.offList) {
-            TRankMap rMap;
-            segDiscover(rMap, sh, off, segc.entry);
+        const unsigned cntOffs = segc.offList.size();
+        for (unsigned i = 0; i < cntOffs; ++i) {
+            const BindingOff &off = segc.offList[i];
+            const TRankMap &rMap = segc.rankList[i];
 
             // go through all cost/length pairs
             BOOST_FOREACH(TRankMap::const_reference rank, rMap) {
@@ -603,18 +625,281 @@ unsigned /* len */ discoverBestAbstraction(
     TValList addrs;
     sh.gatherRootObjects(addrs, isOnHeap);
     BOOST_FOREACH(const TValId at, addrs) {
-        // use ProbeEntryVisitor visitor to validate the potential segment entry
         SegCandidate segc;
-        const ProbeEntryVisitor visitor(segc.offList, at);
-        traverseLivePtrs(sh, at, visitor);
-        if (segc.offList.empty())
+        if (!probeSegEntry(&segc, sh, at))
             // found nothing
             continue;
 
         // append a segment candidate
-        segc.entry = at;
         candidates.push_back(segc);
     }
 
-    return selectBestAbstraction(sh, candidates, off, entry);
+    return selectBestAbstraction(candidates, off, entry);
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of SegDiscovery
+static SHARED_CNT(unsigned) cntFullDiscoveries;
+static SHARED_CNT(unsigned) cntIncDiscoveries;
+static SHARED_CNT(unsigned) cntEntriesProbed;
+static SHARED_CNT(unsigned) cntEntriesReused;
+
+/// everything segDiscover() and ProbeEntryVisitor may ever read about a root
+typedef std::vector<long>                               TRootSig;
+typedef std::map<TValId, TRootSig>                      TRootSigMap;
+typedef std::map<TValId, TValId /* component */>        TCompMap;
+typedef std::map<TValId /* entry */, SegCandidate>      TSegCache;
+
+struct SegDiscovery::Private {
+    SymHeap                     &sh;
+    bool                        initialized;
+    TRootSigMap                 sigs;
+    TCompMap                    comps;
+    TSegCache                   cache;
+
+    Private(SymHeap &sh_):
+        sh(sh_),
+        initialized(false)
+    {
+    }
+
+    void rootSig(TRootSig &dst, const TValId root) const;
+    void takeSnapshot(TRootSigMap &dstSigs, TCompMap *pComps) const;
+    void invalidate();
+    unsigned discover(BindingOff *pOff, TValId *pEntry);
+};
+
+void SegDiscovery::Private::rootSig(TRootSig &dst, const TValId root) const {
+    const EValueTarget code = sh.valTarget(root);
+    dst.push_back(code);
+    if (!isPossibleToDeref(code))
+        return;
+
+    const EObjKind kind = sh.valTargetKind(root);
+    dst.push_back(kind);
+    if (OK_CONCRETE != kind && OK_OBJ_OR_NULL != kind) {
+        const BindingOff &off = sh.segBinding(root);
+        dst.push_back(off.head);
+        dst.push_back(off.next);
+        dst.push_back(off.prev);
+        dst.push_back(sh.segMinLength(root));
+    }
+
+    const TSizeRange size = sh.valSizeOfTarget(root);
+    dst.push_back(size.lo);
+    dst.push_back(size.hi);
+    dst.push_back(sh.valTargetProtoLevel(root));
+    dst.push_back(reinterpret_cast<long>(sh.valLastKnownTypeOfTarget(root)));
+
+    // the contents of the root, including the targets of the pointers
+    ObjList live;
+    sh.gatherLiveObjects(live, root);
+    BOOST_FOREACH(const ObjHandle &obj, live) {
+        dst.push_back(obj.placedAt());
+        dst.push_back(reinterpret_cast<long>(obj.objType()));
+
+        const TValId val = obj.value();
+        dst.push_back(val);
+        if (val <= 0)
+            continue;
+
+        const EValueTarget valCode = sh.valTarget(val);
+        dst.push_back(valCode);
+        if (isPossibleToDeref(valCode))
+            dst.push_back(sh.valTargetKind(val));
+    }
+
+    TUniBlockMap bMap;
+    sh.gatherUniformBlocks(bMap, root);
+    BOOST_FOREACH(TUniBlockMap::const_reference item, bMap) {
+        const UniformBlock &bl = item.second;
+        dst.push_back(bl.off);
+        dst.push_back(bl.size);
+        dst.push_back(bl.tplValue);
+    }
+
+    // the objects pointing at/inside the root
+    ObjList refs;
+    sh.pointedBy(refs, root);
+    std::vector<TValId> refAddrs;
+    BOOST_FOREACH(const ObjHandle &obj, refs)
+        refAddrs.push_back(obj.placedAt());
+
+    std::sort(refAddrs.begin(), refAddrs.end());
+    dst.push_back(refAddrs.size());
+    std::copy(refAddrs.begin(), refAddrs.end(), std::back_inserter(dst));
+}
+
+static TValId compOf(TCompMap &comps, TValId root) {
+    // union-find without ranks, path halving
+    TValId &parent = comps[root];
+    if (!parent)
+        parent = root;
+
+    while (comps[root] != root) {
+        TValId &up = comps[root];
+        up = comps[up];
+        root = up;
+    }
+
+    return root;
+}
+
+void SegDiscovery::Private::takeSnapshot(
+        TRootSigMap                 &dstSigs,
+        TCompMap                    *pComps)
+    const
+{
+    TValList roots;
+    sh.gatherRootObjects(roots, isOnHeap);
+    BOOST_FOREACH(const TValId root, roots)
+        this->rootSig(dstSigs[root], root);
+
+    if (!pComps)
+        return;
+
+    // split the heap into weakly connected components, the program variables
+    // are left aside since they are not candidates for abstraction anyway
+    TCompMap &comps = *pComps;
+    BOOST_FOREACH(const TValId root, roots) {
+        ObjList ptrs;
+        sh.gatherLivePointers(ptrs, root);
+        BOOST_FOREACH(const ObjHandle &obj, ptrs) {
+            const TValId val = obj.value();
+            if (val <= 0 || !isOnHeap(sh.valTarget(val)))
+                continue;
+
+            const TValId c1 = compOf(comps, root);
+            const TValId c2 = compOf(comps, sh.valRoot(val));
+            comps[c1] = c2;
+        }
+    }
+
+    // flatten the map so that it can be used without any updates
+    BOOST_FOREACH(const TValId root, roots)
+        comps[root] = compOf(comps, root);
+}
+
+void SegDiscovery::Private::invalidate() {
+    TRootSigMap now;
+    this->takeSnapshot(now, /* pComps */ 0);
+
+    // components of the last snapshot touched since then
+    std::set<TValId> dirty;
+    BOOST_FOREACH(TRootSigMap::const_reference item, this->sigs) {
+        const TValId root = item.first;
+        const TRootSigMap::const_iterator it = now.find(root);
+        if (now.end() != it && it->second == item.second)
+            continue;
+
+        // root changed or destroyed
+        dirty.insert(this->comps[root]);
+    }
+
+    // newly created roots need to be connected to an old root (which is then
+    // changed as well) unless they are isolated, so it is safe to skip them
+
+    TSegCache::iterator it = this->cache.begin();
+    while (this->cache.end() != it) {
+        const TValId entry = it->first;
+        const TCompMap::const_iterator itComp = this->comps.find(entry);
+        if (this->comps.end() != itComp && !hasKey(dirty, itComp->second))
+            ++it;
+        else
+            this->cache.erase(it++);
+    }
+}
+
+unsigned /* len */ SegDiscovery::Private::discover(
+        BindingOff                  *pOff,
+        TValId                      *pEntry)
+{
+    if (this->initialized) {
+        ++::cntIncDiscoveries;
+        this->invalidate();
+    }
+    else {
+        // no snapshot the cached results could be checked against
+        ++::cntFullDiscoveries;
+        this->cache.clear();
+    }
+
+    TSegCandidateList candidates;
+
+    // go through all potential segment entries in the order given by SymHeap
+    TValList addrs;
+    sh.gatherRootObjects(addrs, isOnHeap);
+    BOOST_FOREACH(const TValId at, addrs) {
+        TSegCache::iterator it = this->cache.find(at);
+        if (this->cache.end() == it) {
+            // not cached, or invalidated by the last abstraction
+            ++::cntEntriesProbed;
+            it = this->cache.insert(std::make_pair(at, SegCandidate())).first;
+            probeSegEntry(&it->second, sh, at);
+        }
+        else
+            ++::cntEntriesReused;
+
+        const SegCandidate &segc = it->second;
+        if (!segc.offList.empty())
+            candidates.push_back(segc);
+    }
+
+    const unsigned len = selectBestAbstraction(candidates, pOff, pEntry);
+
+    // the snapshot is taken by SegDiscovery::snapshot() only if the heap is
+    // going to be abstracted, which is not the common case
+    this->sigs.clear();
+    this->comps.clear();
+    this->initialized = false;
+    return len;
+}
+
+SegDiscovery::SegDiscovery(SymHeap &sh):
+    d(new Private(sh))
+{
+}
+
+SegDiscovery::~SegDiscovery() {
+    delete d;
+}
+
+unsigned /* len */ SegDiscovery::discoverBest(
+        BindingOff                  *pOff,
+        TValId                      *pEntry)
+{
+#if SE_INCREMENTAL_SEG_DISCOVERY
+    const unsigned len = d->discover(pOff, pEntry);
+#   if DEBUG_SYMDISCOVER
+    // cross-check the result with the full discovery
+    BindingOff offFull;
+    TValId entryFull;
+    const unsigned lenFull = discoverBestAbstraction(d->sh, &offFull,
+                                                     &entryFull);
+    CL_BREAK_IF(len != lenFull);
+    CL_BREAK_IF(len && (*pEntry != entryFull || *pOff != offFull));
+    if (len != lenFull)
+        CL_ERROR("SegDiscovery::discoverBest() disagrees with full discovery");
+#   endif
+    return len;
+#else
+    ++::cntFullDiscoveries;
+    return discoverBestAbstraction(d->sh, pOff, pEntry);
+#endif
+}
+
+void SegDiscovery::snapshot() {
+#if SE_INCREMENTAL_SEG_DISCOVERY
+    // remember the state of the heap the cached results are valid for
+    d->takeSnapshot(d->sigs, &d->comps);
+    d->initialized = true;
+#endif
+}
+
+void printSegDiscoveryStats() {
+    CL_DEBUG("segment discovery: "
+            << ::cntFullDiscoveries << " full, "
+            << ::cntIncDiscoveries << " incremental, "
+            << ::cntEntriesProbed << " entries probed, "
+            << ::cntEntriesReused << " entries reused");
 }
@@ -52,4 +52,43 @@ unsigned /* len */ discoverBestAbstraction(
         BindingOff              *bf,
         TValId                  *entry);
 
+/**
+ * discoverBestAbstraction() keeping its results across subsequent calls on the
+ * same symbolic heap.  Before the heap is changed by an abstraction, snapshot()
+ * splits it into weakly connected components.  Only the entry candidates of
+ * the components that have changed since the snapshot are discovered again,
+ * so that each abstraction step costs only a rescan of the list it touched.
+ * @note the cached results are valid only as long as the heap is modified
+ * merely by the abstraction itself, so do not keep the object for long
+ */
+class SegDiscovery {
+    public:
+        SegDiscovery(SymHeap &sh);
+        ~SegDiscovery();
+
+        /// the same as discoverBestAbstraction(), but incremental
+        unsigned /* len */ discoverBest(BindingOff *bf, TValId *entry);
+
+        /**
+         * remember the state of the heap right before it is changed by the
+         * abstraction just discovered; unless called, the next discoverBest()
+         * does a full discovery
+         */
+        void snapshot();
+
+    private:
+        /// object copying is @b not allowed
+        SegDiscovery(const SegDiscovery &);
+
+        /// object copying is @b not allowed
+        SegDiscovery& operator=(const SegDiscovery &);
+
+    private:
+        struct Private;
+        Private *d;
+};
+
+/// print counts of full/incremental discoveries so far (in verbose mode)
+void printSegDiscoveryStats();
+
 #endif /* H_GUARD_SYMDISCOVER_H */
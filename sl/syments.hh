@@ -21,6 +21,8 @@
 #define H_GUARD_SYM_ENTS_H
 
 #include "config.h"
+#include "symprof.hh"
+#include "sync.hh"
 
 #include <vector>
 
@@ -40,7 +42,7 @@
 #if SH_COPY_ON_WRITE
 class RefCounter {
     private:
-        typedef int TCnt;
+        typedef SHARED_CNT(int) TCnt;
         TCnt cnt_;
 
     public:
@@ -78,12 +80,10 @@ class RefCounter {
             return false;
         }
 
-        bool /* needCloning */ requireExclusivity() {
-            if (!this->isShared())
-                return false;
-
-            --cnt_;
-            return true;
+        /// the caller keeps its reference, it is released by leave() once the
+        /// clone exists, so that the object cannot die while being cloned
+        bool /* needCloning */ requireExclusivity() const {
+            return this->isShared();
         }
 
         bool /* wasLast */ leave() {
@@ -140,34 +140,61 @@ template <enum ERefCntObjKind TKind> struct RefCntLib;
 template <>
 struct RefCntLib<RCO_VIRTUAL>: public RefCntLibBase {
     template <class T> static void enter(T *&ptr) {
-        if (/* needCloning */ ptr->refCnt.enter())
-            ptr = ptr->clone();
+        if (!/* needCloning */ ptr->refCnt.enter())
+            return;
+
+        ptr = ptr->clone();
+        profCountAlloc(sizeof(T));
     }
 
     template <class T> static void requireExclusivity(T *&ptr) {
-        if (/* needCloning */ ptr->refCnt.requireExclusivity())
-            ptr = ptr->clone();
+        if (!/* needCloning */ ptr->refCnt.requireExclusivity())
+            return;
+
+        // clone the object while we still hold our reference to it
+        T *dup = ptr->clone();
+        profCountAlloc(sizeof(T));
+        RefCntLibBase::leave(ptr);
+        ptr = dup;
     }
 };
 
 template <>
 struct RefCntLib<RCO_NON_VIRT>: public RefCntLibBase {
     template <class T> static void enter(T *&ptr) {
-        if (/* needCloning */ ptr->refCnt.enter())
-            ptr = new T(*ptr);
+        if (!/* needCloning */ ptr->refCnt.enter())
+            return;
+
+        ptr = new T(*ptr);
+        profCountAlloc(sizeof(T));
     }
 
     template <class T> static void requireExclusivity(T *&ptr) {
-        if (/* needCloning */ ptr->refCnt.requireExclusivity())
-            ptr = new T(*ptr);
+        if (!/* needCloning */ ptr->refCnt.requireExclusivity())
+            return;
+
+        // clone the object while we still hold our reference to it
+        T *dup = new T(*ptr);
+        profCountAlloc(sizeof(T));
+        RefCntLibBase::leave(ptr);
+        ptr = dup;
     }
 };
 
 
+/**
+ * table of heap entities indexed by their IDs
+ *
+ * The table is split into fixed-size chunks, which are shared among copies of
+ * the table the same way as the entities themselves.  Copying an EntStore only
+ * bumps the reference count of the table; the first write access then clones
+ * the list of chunks and the single chunk being written to, so the cost of a
+ * write does not depend on the count of entities in the heap.
+ */
 template <class TBaseEnt>
 class EntStore {
     public:
-        EntStore() { }
+        inline EntStore();
         inline EntStore(const EntStore &);
         inline ~EntStore();
 
@@ -178,7 +205,7 @@ class EntStore {
 
         template <typename TId> TId lastId() const {
             // we need to be careful with integral arithmetic on enums
-            const long last = -1L + ents_.size();
+            const long last = -1L + table_->size;
             return static_cast<TId>(last);
         }
 
@@ -199,45 +226,154 @@ class EntStore {
         // intentionally not implemented
         EntStore& operator=(const EntStore &);
 
-        std::vector<TBaseEnt *>                 ents_;
+        /// count of entity slots per chunk, needs to be a power of two
+        static const unsigned ChunkSize = 64U;
+
+        struct Chunk {
+            RefCounter                          refCnt;
+            TBaseEnt                           *ents[ChunkSize];
+
+            Chunk() {
+                for (unsigned i = 0U; i < ChunkSize; ++i)
+                    ents[i] = 0;
+            }
+
+            Chunk(const Chunk &ref) {
+                for (unsigned i = 0U; i < ChunkSize; ++i) {
+                    ents[i] = ref.ents[i];
+                    if (ents[i])
+                        RefCntLib<RCO_VIRTUAL>::enter(ents[i]);
+                }
+            }
+
+            ~Chunk() {
+                for (unsigned i = 0U; i < ChunkSize; ++i)
+                    if (ents[i])
+                        RefCntLib<RCO_VIRTUAL>::leave(ents[i]);
+            }
+        };
+
+        struct Table {
+            RefCounter                          refCnt;
+            std::vector<Chunk *>                chunks;
+            unsigned                            size;
+
+            Table():
+                size(0U)
+            {
+            }
+
+            Table(const Table &ref):
+                chunks(ref.chunks),
+                size(ref.size)
+            {
+                BOOST_FOREACH(Chunk *&chunk, chunks)
+                    RefCntLib<RCO_NON_VIRT>::enter(chunk);
+            }
+
+            ~Table() {
+                BOOST_FOREACH(Chunk *chunk, chunks)
+                    RefCntLib<RCO_NON_VIRT>::leave(chunk);
+            }
+        };
+
+        Table                                  *table_;
 
 #if SH_REUSE_FREE_IDS
         std::queue<unsigned>                    freeIds_;
 #endif
+
+        /// read-only access to the slot of the given ID
+        TBaseEnt* slotRO(const unsigned id) const {
+            return table_->chunks[id / ChunkSize]->ents[id % ChunkSize];
+        }
+
+        /// writable access to the slot, the chunk is unshared if necessary
+        inline TBaseEnt*& slotRW(const unsigned id);
+
+        /// make room for at least (id + 1) entities
+        inline void ensureSize(const unsigned id);
 };
 
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of EntStore
+template <class TBaseEnt>
+EntStore<TBaseEnt>::EntStore():
+    table_(new Table)
+{
+}
+
+template <class TBaseEnt>
+EntStore<TBaseEnt>::EntStore(const EntStore &ref):
+    table_(ref.table_)
+#if SH_REUSE_FREE_IDS
+    , freeIds_(ref.freeIds_)
+#endif
+{
+    RefCntLib<RCO_NON_VIRT>::enter(table_);
+}
+
+template <class TBaseEnt>
+EntStore<TBaseEnt>::~EntStore() {
+    RefCntLib<RCO_NON_VIRT>::leave(table_);
+}
+
+template <class TBaseEnt>
+TBaseEnt*& EntStore<TBaseEnt>::slotRW(const unsigned id) {
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(table_);
+
+    Chunk *&chunk = table_->chunks[id / ChunkSize];
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(chunk);
+    return chunk->ents[id % ChunkSize];
+}
+
+template <class TBaseEnt>
+void EntStore<TBaseEnt>::ensureSize(const unsigned id) {
+    if (id < table_->size)
+        return;
+
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(table_);
+    while (table_->chunks.size() * ChunkSize <= id) {
+        table_->chunks.push_back(new Chunk);
+        profCountAlloc(sizeof(Chunk));
+    }
+
+    table_->size = id + 1U;
+}
+
 template <class TBaseEnt>
 template <typename TId>
 TId EntStore<TBaseEnt>::assignId(TBaseEnt *ptr) {
     CL_BREAK_IF(ptr->refCnt.isShared());
+    profCountAlloc(sizeof(TBaseEnt));
 
 #if SH_REUSE_FREE_IDS
     if (!this->freeIds_.empty()) {
         const TId id = static_cast<TId>(this->freeIds_.front());
         this->freeIds_.pop();
-        this->ents_[id] = ptr;
+        this->slotRW(id) = ptr;
         CL_DEBUG("reusing heap ID #" << id 
-                << " (heap size is " << this->ents_.size() << ")");
+                << " (heap size is " << table_->size << ")");
         return id;
     }
 #endif
-    this->ents_.push_back(ptr);
-    return this->lastId<TId>();
+    const unsigned id = table_->size;
+    this->ensureSize(id);
+    this->slotRW(id) = ptr;
+    return static_cast<TId>(id);
 }
 
 template <class TBaseEnt>
 template <typename TId>
 void EntStore<TBaseEnt>::assignId(const TId id, TBaseEnt *ptr) {
     CL_BREAK_IF(ptr->refCnt.isShared());
+    profCountAlloc(sizeof(TBaseEnt));
 
     // make sure we have enough space allocated
-    if (this->lastId<TId>() < id)
-        ents_.resize(id + 1, 0);
+    this->ensureSize(id);
 
-    TBaseEnt *&ref = ents_[id];
+    TBaseEnt *&ref = this->slotRW(id);
 
     // if this fails, you wanted to overwrite pointer to a valid entity
     CL_BREAK_IF(ref);
@@ -251,7 +387,7 @@ void EntStore<TBaseEnt>::releaseEnt(const TId id) {
 #if SH_REUSE_FREE_IDS
     freeIds_.push(id);
 #endif
-    RefCntLib<RCO_VIRTUAL>::leave(ents_[id]);
+    RefCntLib<RCO_VIRTUAL>::leave(this->slotRW(id));
 }
 
 template <class TBaseEnt>
@@ -260,23 +396,7 @@ bool EntStore<TBaseEnt>::isValidEnt(const TId id) const {
     if (this->outOfRange(id))
         return false;
 
-    return !!ents_[id];
-}
-
-template <class TBaseEnt>
-EntStore<TBaseEnt>::EntStore(const EntStore &ref):
-    ents_(ref.ents_)
-{
-    BOOST_FOREACH(TBaseEnt *&ent, ents_)
-        if (ent)
-            RefCntLib<RCO_VIRTUAL>::enter(ent);
-}
-
-template <class TBaseEnt>
-EntStore<TBaseEnt>::~EntStore() {
-    BOOST_FOREACH(TBaseEnt *ent, ents_)
-        if (ent)
-            RefCntLib<RCO_VIRTUAL>::leave(ent);
+    return !!this->slotRO(id);
 }
 
 template <class TBaseEnt>
@@ -287,7 +407,7 @@ inline const TBaseEnt* EntStore<TBaseEnt>::getEntRO(const TId id)
     CL_BREAK_IF(this->outOfRange(id));
 
     // if this fails, the ID is no longer valid
-    const TBaseEnt *ptr = ents_[id];
+    const TBaseEnt *ptr = this->slotRO(id);
     CL_BREAK_IF(!ptr);
     return ptr;
 }
@@ -299,7 +419,7 @@ inline TBaseEnt* EntStore<TBaseEnt>::getEntRW(const TId id)
 #ifndef NDEBUG
     this->getEntRO(id);
 #endif
-    TBaseEnt *&entRW = ents_[id];
+    TBaseEnt *&entRW = this->slotRW(id);
     RefCntLib<RCO_VIRTUAL>::requireExclusivity(entRW);
     return entRW;
 }
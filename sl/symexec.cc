@@ -30,8 +30,10 @@
 #include "symabstract.hh"
 #include "symcall.hh"
 #include "symdebug.hh"
+#include "symdiscover.hh"
 #include "sympath.hh"
 #include "symproc.hh"
+#include "symprof.hh"
 #include "symstate.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
@@ -42,6 +44,17 @@
 #include <sstream>
 #include <stdexcept>
 
+#if 1 < SE_PARALLEL_HEAPS
+#   include <algorithm>
+#   include <atomic>
+#   include <condition_variable>
+#   include <exception>
+#   include <functional>
+#   include <mutex>
+#   include <thread>
+#   include <boost/scoped_array.hpp>
+#endif
+
 #include <boost/foreach.hpp>
 
 LOCAL_DEBUG_PLOTTER(nondetCond, DEBUG_SE_NONDET_COND)
@@ -65,6 +78,111 @@ struct ExecStackItem {
 
 typedef std::deque<ExecStackItem> TExecStack;
 
+#if 1 < SE_PARALLEL_HEAPS
+// /////////////////////////////////////////////////////////////////////////////
+// WorkerPool
+/// threads created once per SymExec and reused by each parallel instruction
+class WorkerPool {
+    public:
+        typedef std::function<void ()>          TJob;
+
+        WorkerPool(const unsigned cntThreads);
+        ~WorkerPool();
+
+        /// run job by up to cntWorkers threads of the pool and the calling one
+        void run(const TJob &job, unsigned cntWorkers);
+
+    private:
+        // copying NOT allowed
+        WorkerPool(const WorkerPool &);
+        WorkerPool& operator=(const WorkerPool &);
+
+        void workerLoop();
+
+    private:
+        std::vector<std::thread>                threads_;
+        std::mutex                              mutex_;
+        std::condition_variable                 cvWork_;
+        std::condition_variable                 cvDone_;
+        const TJob                             *job_;
+        unsigned                                round_;
+        unsigned                                cntWanted_;
+        unsigned                                cntRunning_;
+        bool                                    quit_;
+};
+
+WorkerPool::WorkerPool(const unsigned cntThreads):
+    job_(0),
+    round_(0U),
+    cntWanted_(0U),
+    cntRunning_(0U),
+    quit_(false)
+{
+    for (unsigned i = 0U; i < cntThreads; ++i)
+        threads_.push_back(std::thread(&WorkerPool::workerLoop, this));
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+
+    cvWork_.notify_all();
+    BOOST_FOREACH(std::thread &th, threads_)
+        th.join();
+}
+
+void WorkerPool::workerLoop() {
+    unsigned lastRound = 0U;
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!quit_ && (lastRound == round_ || !cntWanted_))
+            cvWork_.wait(lock);
+
+        if (quit_)
+            return;
+
+        // take part in the current round (at most once)
+        lastRound = round_;
+        --cntWanted_;
+        const TJob *job = job_;
+        lock.unlock();
+
+        (*job)();
+
+        lock.lock();
+        if (!--cntRunning_)
+            cvDone_.notify_all();
+    }
+}
+
+void WorkerPool::run(const TJob &job, unsigned cntWorkers) {
+    cntWorkers = std::min<unsigned>(cntWorkers, threads_.size());
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        CL_BREAK_IF(cntRunning_);
+        job_ = &job;
+        cntWanted_ = cntWorkers;
+        cntRunning_ = cntWorkers;
+        ++round_;
+    }
+
+    cvWork_.notify_all();
+
+    // the calling thread works as one of the workers
+    job();
+
+    // wait for the other workers to finish the round
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (cntRunning_)
+        cvDone_.wait(lock);
+
+    job_ = 0;
+}
+#endif
+
 // /////////////////////////////////////////////////////////////////////////////
 // SymExec
 class SymExec: public IStatsProvider {
@@ -73,7 +191,20 @@ class SymExec: public IStatsProvider {
             stor_(stor),
             params_(ep),
             callCache_(stor, ep.ptrace)
+#if 1 < SE_PARALLEL_HEAPS
+            , workers_(SE_PARALLEL_HEAPS - 1)
+#endif
         {
+            if (ep.summaryDir.empty())
+                return;
+
+            // the options that the computed results depend on
+            std::ostringstream tag;
+            tag << "track_uninit:" << ep.trackUninit
+                << " oom:" << ep.oomSimulation
+                << " error_label:" << ep.errLabel;
+
+            callCache_.enableSummaries(ep.summaryDir, tag.str());
         }
 
         /// just to avoid memory leakage in case an exception falls through
@@ -99,6 +230,9 @@ class SymExec: public IStatsProvider {
         SymExecParams                           params_;
         SymCallCache                            callCache_;
         TExecStack                              execStack_;
+#if 1 < SE_PARALLEL_HEAPS
+        WorkerPool                              workers_;
+#endif
 };
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -110,13 +244,20 @@ class SymExecEngine: public IStatsProvider {
                 const SymHeap           &entry,
                 const IStatsProvider    &stats,
                 const SymExecParams     &ep,
+#if 1 < SE_PARALLEL_HEAPS
+                WorkerPool              &workers,
+#endif
                 SymBackTrace            &bt):
             stor_(entry.stor()),
             params_(ep),
+#if 1 < SE_PARALLEL_HEAPS
+            workers_(workers),
+#endif
             bt_(bt),
             dst_(results),
             stats_(stats),
             ptracer_(stateMap_),
+            sched_(ep.schedPolicy),
             block_(0),
             insnIdx_(0),
             heapIdx_(0),
@@ -149,6 +290,9 @@ class SymExecEngine: public IStatsProvider {
     private:
         const CodeStorage::Storage      &stor_;
         SymExecParams                   params_;
+#if 1 < SE_PARALLEL_HEAPS
+        WorkerPool                      &workers_;
+#endif
         SymBackTrace                    &bt_;
         SymState                        &dst_;
         const IStatsProvider            &stats_;
@@ -195,6 +339,16 @@ class SymExecEngine: public IStatsProvider {
         void execCondInsn();
         void execTermInsn();
         bool execNontermInsn();
+        bool execNontermInsnCore(
+                SymState                            &dst,
+                bool                                *pFatal,
+                const SymHeap                       &origin)
+            const;
+#if 1 < SE_PARALLEL_HEAPS
+        struct ParallelBatch;
+        bool execInsnInParallel(SymStateMarked &origin);
+        void execParallelWorker(ParallelBatch *) const;
+#endif
         bool execInsn();
         bool execBlock();
         void processPendingSignals();
@@ -250,7 +404,7 @@ void SymExecEngine::execReturn() {
     SymHeap sh(origin);
 
     Trace::Node *trOrig = origin.traceNode();
-    Trace::Node *trRet = new Trace::InsnNode(trOrig, insn, /* bin */ false);
+    Trace::Node *trRet = Trace::InsnNode::share(trOrig, insn, /* bin */ false);
     sh.traceUpdate(trRet);
 
     const struct cl_operand &src = opList[0];
@@ -329,7 +483,7 @@ void SymExecEngine::updateStateInBranch(
     SymProc proc(sh, &bt_);
     proc.setLocation(lw_);
 
-    sh.traceUpdate(new Trace::CondNode(sh.traceNode()->parent(),
+    sh.traceUpdate(Trace::CondNode::share(sh.traceNode()->parent(),
                 &insnCmp, &insnCnd, /* det */ false, branch));
 
     const enum cl_binop_e code = static_cast<enum cl_binop_e>(insnCmp.subCode);
@@ -381,7 +535,7 @@ bool SymExecEngine::bypassNonPointers(
     proc.killInsn(insnCmp);
 
     SymHeap sh1(sh);
-    sh1.traceUpdate(new Trace::CondNode(sh.traceNode(),
+    sh1.traceUpdate(Trace::CondNode::share(sh.traceNode(),
                 &insnCmp, &insnCnd, /* det */ false, /* branch */ true));
 
     CL_DEBUG_MSG(lw_, "-T- CL_INSN_COND updates TRUE branch");
@@ -391,7 +545,7 @@ bool SymExecEngine::bypassNonPointers(
     this->updateState(sh1, insnCnd.targets[/* then label */ 0]);
 
     SymHeap sh2(sh);
-    sh2.traceUpdate(new Trace::CondNode(sh.traceNode(),
+    sh2.traceUpdate(Trace::CondNode::share(sh.traceNode(),
                 &insnCmp, &insnCnd, /* det */ false, /* branch */ false));
 
     CL_DEBUG_MSG(lw_, "-F- CL_INSN_COND updates FALSE branch");
@@ -438,7 +592,7 @@ void SymExecEngine::execCondInsn() {
     // check whether we know where to go
     switch (val) {
         case VAL_TRUE:
-            sh.traceUpdate(new Trace::CondNode(sh.traceNode(),
+            sh.traceUpdate(Trace::CondNode::share(sh.traceNode(),
                         insnCmp, insnCnd, /* det */ true, /* branch */ true));
 
             CL_DEBUG_MSG(lw_, ".T. CL_INSN_COND got VAL_TRUE");
@@ -448,7 +602,7 @@ void SymExecEngine::execCondInsn() {
             return;
 
         case VAL_FALSE:
-            sh.traceUpdate(new Trace::CondNode(sh.traceNode(),
+            sh.traceUpdate(Trace::CondNode::share(sh.traceNode(),
                         insnCmp, insnCnd, /* det */ true, /* branch */ false));
 
             CL_DEBUG_MSG(lw_, ".F. CL_INSN_COND got VAL_FALSE");
@@ -519,6 +673,25 @@ void SymExecEngine::execTermInsn() {
 }
 
 bool /* handled */ SymExecEngine::execNontermInsn() {
+    bool fatal = false;
+    const SymHeap &origin = localState_[heapIdx_];
+    if (!this->execNontermInsnCore(nextLocalState_, &fatal, origin))
+        return false;
+
+    if (fatal)
+        // suppress the annoying warnings 'end of foo() not reached' since we
+        // have already told user that there was something more serious going on
+        endReached_ = true;
+
+    return /* insn handled */ true;
+}
+
+bool /* handled */ SymExecEngine::execNontermInsnCore(
+        SymState                                    &dst,
+        bool                                        *pFatal,
+        const SymHeap                               &origin)
+    const
+{
     const CodeStorage::Insn *insn = block_->operator[](insnIdx_);
 
     // set some properties of the execution
@@ -529,7 +702,6 @@ bool /* handled */ SymExecEngine::execNontermInsn() {
     ep.errLabel         = params_.errLabel;
 
     // working area for non-terminal instructions
-    const SymHeap &origin = localState_[heapIdx_];
     SymHeap sh(origin);
     SymExecCore core(sh, &bt_, ep);
     core.setLocation(lw_);
@@ -538,19 +710,122 @@ bool /* handled */ SymExecEngine::execNontermInsn() {
     Trace::waiveCloneOperation(sh);
 
     // execute the instruction
-    if (!core.exec(nextLocalState_, *insn)) {
+    if (!core.exec(dst, *insn)) {
         CL_BREAK_IF(CL_INSN_CALL != insn->code);
         return false;
     }
 
-    if (core.hasFatalError())
-        // suppress the annoying warnings 'end of foo() not reached' since we
-        // have already told user that there was something more serious going on
-        endReached_ = true;
-
+    *pFatal = core.hasFatalError();
     return /* insn handled */ true;
 }
 
+#if 1 < SE_PARALLEL_HEAPS
+/// heaps of a basic block being executed by more threads at a time
+struct SymExecEngine::ParallelBatch {
+    typedef std::vector<unsigned>                   TIdxList;
+
+    TIdxList                            heaps;      ///< indexes to localState_
+    std::atomic<unsigned>               next;       ///< next item of heaps
+    std::vector<SymHeapList>            results;
+    boost::scoped_array<ClMsgQueue>     msgs;
+    std::vector<char>                   fatal;
+    std::vector<std::exception_ptr>     errors;
+
+    ParallelBatch(const TIdxList &heaps_):
+        heaps(heaps_),
+        next(0U),
+        results(heaps_.size()),
+        msgs(new ClMsgQueue[heaps_.size()]),
+        fatal(heaps_.size(), false),
+        errors(heaps_.size())
+    {
+    }
+};
+
+void SymExecEngine::execParallelWorker(ParallelBatch *batch) const {
+    // account the work of this thread to the block being executed
+    ProfBlock profBlock(bt_.topFnc(), block_);
+    const unsigned cnt = batch->heaps.size();
+
+    unsigned i;
+    while ((i = batch->next++) < cnt) {
+        const unsigned idx = batch->heaps[i];
+
+        // hold back our messages till the ordered merge in execInsnInParallel
+        ClMsgQueue &msgs = batch->msgs[i];
+        msgs.install();
+
+        CL_DEBUG_MSG(lw_, "*** processing heap #" << idx
+                     << " (initial size of state was " << localState_.size()
+                     << ")");
+
+        try {
+            bool fatal = false;
+            const SymHeap &origin = localState_[idx];
+            if (!this->execNontermInsnCore(batch->results[i], &fatal, origin))
+                CL_BREAK_IF("execParallelWorker() got CL_INSN_CALL");
+
+            batch->fatal[i] = fatal;
+        }
+        catch (...) {
+            // rethrown by execInsnInParallel() in the right order
+            batch->errors[i] = std::current_exception();
+        }
+
+        msgs.uninstall();
+    }
+}
+
+bool /* handled */ SymExecEngine::execInsnInParallel(SymStateMarked &origin) {
+    const CodeStorage::Insn *insn = block_->operator[](insnIdx_);
+    if (cl_is_term_insn(insn->code) || CL_INSN_CALL == insn->code)
+        // only non-terminal insns that never suspend the engine
+        return false;
+
+    // gather heaps of localState_ that we need to process
+    ParallelBatch::TIdxList heaps;
+    const unsigned hCnt = localState_.size();
+    for (unsigned i = 0; i < hCnt; ++i)
+        if (insnIdx_ || !origin.isDone(i))
+            heaps.push_back(i);
+
+    if (heaps.size() < 2)
+        // nothing to run in parallel
+        return false;
+
+    if (!insnIdx_) {
+        // mark as processed now since they can be re-scheduled right away
+        BOOST_FOREACH(const unsigned idx, heaps)
+            origin.setDone(idx);
+    }
+
+    // time to respond to a single pending signal
+    this->processPendingSignals();
+
+    // wake up the worker threads, the current thread works as one of them
+    ParallelBatch batch(heaps);
+    const WorkerPool::TJob job =
+        std::bind(&SymExecEngine::execParallelWorker, this, &batch);
+    workers_.run(job, /* cntWorkers */ heaps.size() - 1U);
+
+    // merge the results in the order of heaps, as a single thread would do
+    for (unsigned i = 0; i < heaps.size(); ++i) {
+        batch.msgs[i].flush();
+        if (batch.errors[i])
+            std::rethrow_exception(batch.errors[i]);
+
+        BOOST_FOREACH(const SymHeap *sh, batch.results[i])
+            nextLocalState_.insert(*sh);
+
+        if (batch.fatal[i])
+            // see SymExecEngine::execNontermInsn()
+            endReached_ = true;
+    }
+
+    return true;
+}
+#endif
+
 bool /* complete */ SymExecEngine::execInsn() {
     const CodeStorage::Insn *insn = block_->operator[](insnIdx_);
 
@@ -581,6 +856,12 @@ bool /* complete */ SymExecEngine::execInsn() {
     // used only if (0 == insnIdx_)
     SymStateMarked &origin = stateMap_[block_];
 
+#if 1 < SE_PARALLEL_HEAPS
+    if (!heapIdx_ && this->execInsnInParallel(origin))
+        // all heaps processed by the worker threads
+        return true;
+#endif
+
     // go through the remainder of symbolic heaps corresponding to localState_
     const unsigned hCnt = localState_.size();
     for (/* we allow resume */; heapIdx_ < hCnt; ++heapIdx_) {
@@ -624,6 +905,8 @@ bool /* complete */ SymExecEngine::execInsn() {
 }
 
 bool /* complete */ SymExecEngine::execBlock() {
+    ProfBlock profBlock(bt_.topFnc(), block_);
+    ProfScope prof(PP_BLOCK);
     const std::string &name = block_->name();
 
     if (insnIdx_ || heapIdx_) {
@@ -794,7 +1077,20 @@ void SymExecEngine::printStats() const {
             ", " << localState_.size() << " src heap(s)"
             ", " << nextLocalState_.size() << " dst heap(s)"
             ", insn #" << insnIdx_ <<
-            ", heap #" << heapIdx_);
+            ", heap #" << heapIdx_ <<
+            ", " << sched_.cntExecuted() << " basic block(s) executed");
+
+    // global statistics of heap comparisons
+    const SymStateStats &ss = symStateStats();
+    CL_NOTE_MSG(lw_,
+            "... " << ss.lookups << " state lookup(s)"
+            ", " << ss.cmpCalls << " heap comparison(s)"
+            ", " << ss.cmpSkipped << " skipped by fingerprints"
+            ", " << ss.inserts << " state insertion(s)"
+            ", " << ss.joinCalls << " join attempt(s)"
+            ", " << ss.joinSkipped << " skipped by fingerprints"
+            ", " << ss.reschedules << " heap(s) scheduled again"
+            ", " << ss.reschedSaved << " re-execution(s) saved by entailment");
 
     if (block_)
         // print statistics for the basic block just being computed
@@ -965,6 +1261,9 @@ void SymExec::enterCall(SymCallCtx *ctx, SymState &results) {
             ctx->entry(),
             /* IStatsProvider */ *this,
             params_,
+#if 1 < SE_PARALLEL_HEAPS
+            workers_,
+#endif
             callCache_.bt());
 
     // initialize a stack item
@@ -1026,6 +1325,9 @@ void SymExec::execFnc(
         SymState &results = engine->callResults();
         const SymHeap &entry = engine->callEntry();
         const CodeStorage::Insn &insn = engine->callInsn();
+
+        // account the call cache lookup to the basic block of the caller
+        ProfBlock profBlock(callCache_.bt().topFnc(), insn.bb);
         const CodeStorage::Fnc *fnc = this->resolveCallInsn(results, entry, insn);
 
         SymCallCtx *ctx = 0;
@@ -1059,7 +1361,9 @@ void SymExec::execFnc(
 }
 
 void SymExec::printStats() const {
-    // TODO: print SymCallCache stats here as soon as we have implemented some
+    callCache_.printStats();
+    printSegDiscoveryStats();
+    Trace::printStats();
 
     BOOST_FOREACH(const ExecStackItem &item, execStack_) {
         const IStatsProvider *provider = item.eng;
@@ -1080,6 +1384,7 @@ void execTopCall(
     try {
         SymExec se(entry.stor(), ep);
         se.execFnc(results, entry, insn, fnc);
+        se.printStats();
         // SymExec::~SymExec() is going to be executed as leaving this block
     }
     catch (const std::runtime_error &e) {
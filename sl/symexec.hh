@@ -22,13 +22,15 @@
 
 #include <string>
 
+#include "config.h"
+#include "symstate.hh"
+
 /**
  * @file symexec.hh
  * SymExec - top level algorithm of the @b symbolic @b execution
  */
 
 class SymHeap;
-class SymState;
 
 namespace CodeStorage {
     struct Fnc;
@@ -41,12 +43,17 @@ struct SymExecParams {
     bool skipPlot;          ///< simply ignore all ___sl_plot* calls
     bool ptrace;            ///< enable path tracing (a bit chatty)
     std::string errLabel;   ///< if not empty, treat reaching the label as error
+    std::string summaryDir; ///< if not empty, persist fnc summaries in the dir
+    std::string profileFile;///< if not empty, dump the profile to the file
+    std::string plotArchive;///< if not empty, write heap graphs to the archive
+    ESchedPolicy schedPolicy;   ///< how to pick the next basic block
 
     SymExecParams():
         trackUninit(false),
         oomSimulation(false),
         skipPlot(false),
-        ptrace(false)
+        ptrace(false),
+        schedPolicy(static_cast<ESchedPolicy>(SE_BLOCK_SCHEDULER))
     {
     }
 };
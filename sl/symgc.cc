@@ -24,6 +24,7 @@
 
 #include "symheap.hh"
 #include "symplot.hh"
+#include "symprof.hh"
 #include "symseg.hh"
 #include "symutil.hh"
 #include "worklist.hh"
@@ -47,7 +48,7 @@ void gatherReferredRoots(TValList &dst, SymHeap &sh, TValId at) {
     }
 }
 
-bool isJunk(SymHeap &sh, TValId root) {
+bool isJunkCore(SymHeap &sh, TValId root) {
     WorkList<TValId> wl(root);
 
     while (wl.next(root)) {
@@ -69,7 +70,24 @@ bool isJunk(SymHeap &sh, TValId root) {
     return true;
 }
 
+bool isJunk(SymHeap &sh, TValId root) {
+#if SE_GC_REACH_INDEX
+    const bool junk = !sh.valTargetIsReachable(root);
+#   if DEBUG_SYMGC_REACH
+    // cross-check the answer with the exhaustive search
+    if (junk != isJunkCore(sh, root)) {
+        CL_ERROR("symgc: reachability index disagrees with exhaustive search");
+        CL_BREAK_IF("please debug me!");
+    }
+#   endif
+    return junk;
+#else
+    return isJunkCore(sh, root);
+#endif
+}
+
 bool gcCore(SymHeap &sh, TValId root, TValList *leakList, bool sharedOnly) {
+    ProfScope prof(PP_GC);
     CL_BREAK_IF(sh.valOffset(root));
     bool detected = false;
 
@@ -40,6 +40,14 @@
  */
 bool collectJunk(SymHeap &sh, TValId root, TValList *leakList = 0);
 
+/**
+ * exhaustive search through all the referrers of the given root entity, no
+ * index involved.  Return true if there is no chain of pointers leading to
+ * the entity from anything not on heap.  Useful to cross-check the answers
+ * of SymHeapCore::valTargetIsReachable().
+ */
+bool isJunkCore(SymHeap &sh, TValId root);
+
 /// experimental
 bool collectSharedJunk(SymHeap &sh, TValId root, TValList *leakList = 0);
 
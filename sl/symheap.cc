@@ -25,6 +25,7 @@
 #include <cl/clutil.hh>
 #include <cl/storage.hh>
 
+#include "flatmap.hh"
 #include "intarena.hh"
 #include "symabstract.hh"
 #include "syments.hh"
@@ -52,11 +53,11 @@ assignInvalidIfNotFound(
         TCont                                           &cont,
         const typename TCont::value_type::first_type    &item)
 {
-    if (!hasKey(cont, item))
-        // -1 means "invalid", e.g. VAL_INVALID in case [T = map<???, TValId>]
-        cont[item] = static_cast<typename TCont::value_type::second_type>(-1);
+    // -1 means "invalid", e.g. VAL_INVALID in case [T = map<???, TValId>]
+    const typename TCont::value_type::second_type inval =
+        static_cast<typename TCont::value_type::second_type>(-1);
 
-    return cont[item];
+    return cont.insert(std::make_pair(item, inval)).first->second;
 }
 
 static bool bypassSelfChecks;
@@ -474,11 +475,16 @@ struct RootValue: public AnchorValue {
     TObjType                        lastKnownClt;
     TProtoLevel                     protoLevel;
 
+    // reachability index, see SymHeapCore::valTargetIsReachable()
+    TObjId                          reachVia;
+    TObjIdSet                       reachChildren;
+
     RootValue(EValueTarget code_, EValueOrigin origin_):
         AnchorValue(code_, origin_),
         size(IR::rngFromNum(0)),
         lastKnownClt(0),
-        protoLevel(/* not a prototype */ 0)
+        protoLevel(/* not a prototype */ 0),
+        reachVia(OBJ_INVALID)
     {
     }
 
@@ -490,10 +496,10 @@ struct RootValue: public AnchorValue {
 // cppcheck-suppress noConstructor
 class CustomValueMapper {
     private:
-        typedef std::map<int /* uid */, TValId>                 TCustomByUid;
-        typedef std::map<IR::TInt, TValId>                      TCustomByNum;
-        typedef std::map<double, TValId>                        TCustomByReal;
-        typedef std::map<std::string, TValId>                   TCustomByString;
+        typedef FlatMap<int /* uid */, TValId>                  TCustomByUid;
+        typedef FlatMap<IR::TInt, TValId>                       TCustomByNum;
+        typedef FlatMap<double, TValId>                         TCustomByReal;
+        typedef FlatMap<std::string, TValId>                    TCustomByString;
 
         TCustomByUid        fncMap;
         TCustomByNum        numMap;
@@ -571,6 +577,10 @@ struct SymHeapCore::Private {
 
     bool /* wasPtr */ releaseValueOf(TObjId obj, TValId val);
     void registerValueOf(TObjId obj, TValId val);
+
+    bool reachIndexed(TValId root);
+    void reachInvalidate(TValId root);
+    bool reachSearch(TValId root);
     void splitBlockByObject(TObjId block, TObjId obj);
     bool writeCharToString(TValId *pValDst, const TValId, const TOffset);
     bool reinterpretSingleObj(HeapObject *dstData, const BlockEntity *srcData);
@@ -653,6 +663,9 @@ bool /* wasPtr */ SymHeapCore::Private::releaseValueOf(TObjId obj, TValId val) {
         // kill all related Neq predicates
         TValList neqs;
         this->neqDb->gatherRelatedValues(neqs, val);
+        if (!neqs.empty())
+            RefCntLib<RCO_NON_VIRT>::requireExclusivity(this->neqDb);
+
         BOOST_FOREACH(const TValId valNeq, neqs) {
             CL_DEBUG("releaseValueOf() kills an orphan Neq predicate");
             this->neqDb->del(valNeq, val);
@@ -671,6 +684,10 @@ bool /* wasPtr */ SymHeapCore::Private::releaseValueOf(TObjId obj, TValId val) {
     if (1 != rootData->usedByGl.erase(obj))
         CL_BREAK_IF("SymHeapCore::Private::releaseValueOf(): offset detected");
 
+    if (obj == rootData->reachVia)
+        // we are killing the pointer the reachability of root was proven by
+        this->reachInvalidate(root);
+
     return /* wasPtr */ true;
 }
 
@@ -692,6 +709,133 @@ void SymHeapCore::Private::registerValueOf(TObjId obj, TValId val) {
     RootValue *rootData;
     this->ents.getEntRW(&rootData, root);
     rootData->usedByGl.insert(obj);
+
+    if (OBJ_INVALID != rootData->reachVia || !isOnHeap(rootData->code))
+        // no need to update the reachability index
+        return;
+
+    const BlockEntity *objData;
+    this->ents.getEntRO(&objData, obj);
+    const TValId parent = objData->root;
+    if (!this->reachIndexed(parent))
+        // the pointer is placed in a root of unknown reachability
+        return;
+
+    // the root is now reachable via the just written pointer
+    rootData->reachVia = obj;
+
+    RootValue *parentData;
+    this->ents.getEntRW(&parentData, parent);
+    parentData->reachChildren.insert(obj);
+}
+
+/**
+ * true for roots not on heap and for heap roots with a known witness pointer
+ *
+ * A root gets its witness pointer (reachVia) only while the root owning the
+ * pointer is already indexed, and it keeps the pointer till it is invalidated
+ * together with all roots indexed via it.  The witness pointers thus form a
+ * forest whose trees are rooted by entities not on heap, so no cycle of heap
+ * roots can ever prove its own reachability.
+ */
+bool SymHeapCore::Private::reachIndexed(TValId root) {
+    const RootValue *rootData;
+    this->ents.getEntRO(&rootData, root);
+    return !isOnHeap(rootData->code)
+        || (OBJ_INVALID != rootData->reachVia);
+}
+
+/// forget the reachability of the given root and all roots proven via it
+void SymHeapCore::Private::reachInvalidate(TValId root) {
+    WorkList<TValId> wl(root);
+    while (wl.next(root)) {
+        RootValue *rootData;
+        this->ents.getEntRW(&rootData, root);
+
+        const TObjId via = rootData->reachVia;
+        rootData->reachVia = OBJ_INVALID;
+
+        TObjIdSet children;
+        children.swap(rootData->reachChildren);
+
+        if (OBJ_INVALID != via) {
+            // detach the root from its parent
+            const BlockEntity *viaData;
+            this->ents.getEntRO(&viaData, via);
+
+            RootValue *parentData;
+            this->ents.getEntRW(&parentData, viaData->root);
+            parentData->reachChildren.erase(via);
+        }
+
+        // schedule all roots the reachability of which depends on this root
+        BOOST_FOREACH(const TObjId obj, children) {
+            const BlockEntity *objData;
+            this->ents.getEntRO(&objData, obj);
+
+            const BaseValue *valData;
+            this->ents.getEntRO(&valData, objData->value);
+            wl.schedule(valData->valRoot);
+        }
+    }
+}
+
+/**
+ * look for a path to the given root from a root of known reachability by
+ * going backward through the pointers, and add the path to the index if found
+ */
+bool SymHeapCore::Private::reachSearch(TValId root) {
+    if (this->reachIndexed(root))
+        // already indexed
+        return true;
+
+    // a pointer leading from each visited root towards the searched one
+    std::map<TValId, TObjId> next;
+
+    TValId at = root;
+    WorkList<TValId> wl(at);
+    while (wl.next(at)) {
+        const RootValue *atData;
+        this->ents.getEntRO(&atData, at);
+
+        BOOST_FOREACH(const TObjId obj, atData->usedByGl) {
+            const BlockEntity *objData;
+            this->ents.getEntRO(&objData, obj);
+
+            const TValId ref = objData->root;
+            if (!wl.schedule(ref))
+                // already visited
+                continue;
+
+            next[ref] = obj;
+            if (!this->reachIndexed(ref))
+                continue;
+
+            // path found, add it to the index (the parent is always indexed)
+            for (TValId parent = ref; root != parent;) {
+                const TObjId via = next[parent];
+                this->ents.getEntRO(&objData, via);
+
+                const BaseValue *valData;
+                this->ents.getEntRO(&valData, objData->value);
+                const TValId child = valData->valRoot;
+
+                RootValue *rootData;
+                this->ents.getEntRW(&rootData, parent);
+                rootData->reachChildren.insert(via);
+
+                this->ents.getEntRW(&rootData, child);
+                CL_BREAK_IF(OBJ_INVALID != rootData->reachVia);
+                rootData->reachVia = via;
+                parent = child;
+            }
+
+            return true;
+        }
+    }
+
+    // no path found
+    return false;
 }
 
 // runs only in debug build
@@ -1505,6 +1649,11 @@ unsigned SymHeapCore::pointedByCount(TValId root) const {
     return rootData->usedByGl.size();
 }
 
+bool SymHeapCore::valTargetIsReachable(TValId root) {
+    CL_BREAK_IF(this->valOffset(root));
+    return d->reachSearch(root);
+}
+
 unsigned SymHeapCore::lastId() const {
     return d->ents.lastId<unsigned>();
 }
@@ -2603,6 +2752,10 @@ void SymHeapCore::gatherRelatedValues(TValList &dst, TValId val) const {
     d->coinDb->gatherRelatedValues(dst, val);
 }
 
+void SymHeapCore::gatherNeqPreds(TValList &dst, TValId val) const {
+    d->neqDb->gatherRelatedValues(dst, val);
+}
+
 void SymHeapCore::copyRelevantPreds(SymHeapCore &dst, const TValMap &valMap)
     const
 {
@@ -2699,6 +2852,10 @@ bool SymHeapCore::matchPreds(const SymHeapCore &ref, const TValMap &valMap)
     return true;
 }
 
+unsigned SymHeapCore::cntNeqPreds() const {
+    return d->neqDb->size();
+}
+
 TValId SymHeapCore::placedAt(TObjId obj) {
     if (obj < 0)
         return VAL_INVALID;
@@ -2975,6 +3132,10 @@ void SymHeapCore::gatherRootObjects(TValList &dst, bool (*filter)(EValueTarget))
             dst.push_back(at);
 }
 
+unsigned SymHeapCore::cntLiveRoots() const {
+    return d->liveRoots->size();
+}
+
 TObjId SymHeapCore::valGetComposite(TValId val) const {
     const BaseValue *valData;
     d->ents.getEntRO(&valData, val);
@@ -3102,6 +3263,9 @@ TObjType SymHeapCore::valLastKnownTypeOfTarget(TValId root) const {
 }
 
 void SymHeapCore::Private::destroyRoot(TValId root) {
+    // remove the root from the reachability index
+    this->reachInvalidate(root);
+
     RootValue *rootData;
     this->ents.getEntRW(&rootData, root);
 
@@ -341,6 +341,15 @@ class SymHeapCore {
         /// return how many objects point at/inside the given root entity
         unsigned pointedByCount(TValId root) const;
 
+        /**
+         * return false if the given root entity is on heap and there is no
+         * chain of pointers leading to it from any entity not on heap.  The
+         * answer is based on an index that is updated incrementally whenever
+         * a pointer is written or killed, so only the part of heap not yet
+         * covered by the index needs to be traversed.
+         */
+        bool valTargetIsReachable(TValId root);
+
         /// write an uninitialized or nullified block of memory
         void writeUniformBlock(
                 const TValId                addr,
@@ -377,12 +386,18 @@ class SymHeapCore {
         /// collect values connect with the given value via an extra predicate
         void gatherRelatedValues(TValList &dst, TValId val) const;
 
+        /// collect values bound to the given value by a stored Neq predicate
+        void gatherNeqPreds(TValList &dst, TValId val) const;
+
         /// transfer as many as possible extra heap predicates from this to dst
         void copyRelevantPreds(SymHeapCore &dst, const TValMap &valMap) const;
 
         /// true if all Neq predicates can be mapped to Neq predicates in ref
         bool matchPreds(const SymHeapCore &ref, const TValMap &valMap) const;
 
+        /// return count of Neq predicates (matchPreds() needs them to match)
+        unsigned cntNeqPreds() const;
+
     public:
         /// translate the given address by the given offset
         TValId valByOffset(TValId, TOffset offset);
@@ -433,6 +448,9 @@ class SymHeapCore {
         /// list of root heap entities satisfying the given filtering predicate
         void gatherRootObjects(TValList &dst, bool (*)(EValueTarget) = 0) const;
 
+        /// count of live root heap entities (cheaper than gatherRootObjects())
+        unsigned cntLiveRoots() const;
+
         /// list of live objects (including ptrs) owned by the given root entity
         void gatherLiveObjects(ObjList &dst, TValId root) const;
 
@@ -27,10 +27,12 @@
 #include "symcmp.hh"
 #include "symgc.hh"
 #include "symplot.hh"
+#include "symprof.hh"
 #include "symseg.hh"
 #include "symstate.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
+#include "sync.hh"
 #include "worklist.hh"
 #include "util.hh"
 
@@ -59,7 +61,7 @@ void debugSymJoin(const bool enable) {
 #define SJ_VALP(v1, v2) "(v1 = #" << v1 << ", v2 = #" << v2 << ")"
 #define SJ_OBJP(o1, o2) "(o1 = #" << o1 << ", o2 = #" << o2 << ")"
 
-static int cntJoinOps = -1;
+static SHARED_CNT(int) cntJoinOps(-1);
 
 namespace {
     void debugPlot(
@@ -2697,16 +2699,72 @@ bool validateStatus(const SymJoinCtx &ctx) {
     return false;
 }
 
+void joinSummary(JoinSummary *pDst, const SymHeap &sh) {
+    JoinSummary js;
+
+    // asymmetric gl variables are not allowed by traverseProgramVarsGeneric()
+    TValList live;
+    sh.gatherRootObjects(live, isProgramVar);
+    BOOST_FOREACH(const TValId root, live) {
+        if (VAL_ADDR_OF_RET == root)
+            continue;
+
+        const CVar cv(sh.cVarByRoot(root));
+        if (cv.inst)
+            // local variables can be recovered
+            continue;
+
+        // combine the hashes by sum, the order of roots is not defined
+        size_t hash = cv.uid;
+        hash ^= hash + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        js.glVars += hash;
+        ++js.cntGlVars;
+    }
+
+    // the type of return value needs to match in joinReturnAddrs()
+    js.retClt = sh.valLastKnownTypeOfTarget(VAL_ADDR_OF_RET);
+
+    *pDst = js;
+}
+
+bool joinMayMatch(const JoinSummary &js1, const JoinSummary &js2) {
+    if (js1.cntGlVars != js2.cntGlVars || js1.glVars != js2.glVars)
+        // gl variables mismatch
+        return false;
+
+    return joinClt(/* pDst */ 0, js1.retClt, js2.retClt);
+}
+
 bool joinSymHeaps(
         EJoinStatus             *pStatus,
         SymHeap                 *pDst,
         const SymHeap           &sh1,
         const SymHeap           &sh2,
-        const bool              allowThreeWay)
+        const bool              allowThreeWay,
+        const JoinSummary       *pJs1,
+        const JoinSummary       *pJs2)
 {
+    ProfScope prof(PP_JOIN);
     SJ_DEBUG("--> joinSymHeaps()");
     TStorRef stor = sh1.stor();
     CL_BREAK_IF(&stor != &sh2.stor());
+
+    // reject hopeless pairs of heaps before the join context is built, reuse
+    // the summaries cached by the caller if available
+    JoinSummary js1, js2;
+    if (!pJs1) {
+        joinSummary(&js1, sh1);
+        pJs1 = &js1;
+    }
+    if (!pJs2) {
+        joinSummary(&js2, sh2);
+        pJs2 = &js2;
+    }
+    if (!joinMayMatch(*pJs1, *pJs2)) {
+        SJ_DEBUG("<-- joinSymHeaps() rejected by joinMayMatch()");
+        CL_BREAK_IF(debuggingSymJoin && areEqual(sh1, sh2));
+        return false;
+    }
     *pDst = SymHeap(stor, new Trace::TransientNode("joinSymHeaps()"));
 
     // initialize symbolic join ctx
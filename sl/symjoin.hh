@@ -64,13 +64,42 @@ bool joinData(
         const TValId            src,
         const bool              bidir);
 
-/// @todo some dox
+/**
+ * cheap summary of a symbolic heap that allows to reject pairs of heaps which
+ * joinSymHeaps() would refuse anyway, before any join context is built
+ */
+struct JoinSummary {
+    unsigned                cntGlVars;  ///< count of live gl variables
+    size_t                  glVars;     ///< order-independent hash of them
+    const struct cl_type    *retClt;    ///< last known type of return value
+
+    JoinSummary():
+        cntGlVars(0),
+        glVars(0),
+        retClt(0)
+    {
+    }
+};
+
+/// compute JoinSummary of the given symbolic heap
+void joinSummary(JoinSummary *pDst, const SymHeap &sh);
+
+/// false if joinSymHeaps() is guaranteed to fail on the summarized heaps
+bool joinMayMatch(const JoinSummary &js1, const JoinSummary &js2);
+
+/**
+ * @todo some dox
+ * @param pJs1 JoinSummary of sh1 if the caller has it cached (computed if NULL)
+ * @param pJs2 JoinSummary of sh2 if the caller has it cached (computed if NULL)
+ */
 bool joinSymHeaps(
         EJoinStatus             *pStatus,
         SymHeap                 *dst,
         const SymHeap           &sh1,
         const SymHeap           &sh2,
-        const bool              allowThreeWay = true);
+        const bool              allowThreeWay = true,
+        const JoinSummary       *pJs1 = 0,
+        const JoinSummary       *pJs2 = 0);
 
 /// enable/disable debugging of symjoin
 void debugSymJoin(const bool enable);
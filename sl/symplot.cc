@@ -25,8 +25,10 @@
 #include <cl/storage.hh>
 
 #include "plotenum.hh"
+#include "plotsink.hh"
 #include "symheap.hh"
 #include "sympred.hh"
+#include "symprof.hh"
 #include "symseg.hh"
 #include "util.hh"
 #include "worklist.hh"
@@ -36,30 +38,81 @@
 #include <iomanip>
 #include <map>
 #include <set>
+#include <sstream>
 #include <string>
 
 #include <boost/foreach.hpp>
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of plotHeap()
+
+/// ID of an auxiliary node, which depends only on the chunk it is plotted in
+struct AuxId {
+    char                                phase;
+    TValId                              scope;
+    int                                 nth;
+};
+
+std::ostream& operator<<(std::ostream &str, const AuxId &id) {
+    return str << id.phase << id.scope << "_" << id.nth;
+}
+
 struct PlotData {
     typedef std::map<TValId, bool /* isRoot */>             TValues;
     typedef std::map<TValId, ObjList>                       TLiveObjs;
-    typedef std::pair<int /* ID */, TValId>                 TDangVal;
+    typedef std::pair<AuxId, TValId>                        TDangVal;
     typedef std::vector<TDangVal>                           TDangValues;
 
     SymHeap                             &sh;
+    std::ostringstream                  chunkBuf;
+    PlotSink::TChunkList                *chunks;
     std::ostream                        &out;
-    int                                 last;
+    AuxId                               last;
     TValues                             values;
     TLiveObjs                           liveObjs;
     TDangValues                         dangVals;
 
+    /// write the dot code directly to the given stream
     PlotData(const SymHeap &sh_, std::ostream &out_):
         sh(const_cast<SymHeap &>(sh_)),
-        out(out_),
-        last(0)
+        chunks(0),
+        out(out_)
     {
+        this->cutChunk('h', VAL_INVALID);
+    }
+
+    /// split the dot code into chunks, see PlotSink::append()
+    PlotData(const SymHeap &sh_, PlotSink::TChunkList &chunks_):
+        sh(const_cast<SymHeap &>(sh_)),
+        chunks(&chunks_),
+        out(chunkBuf)
+    {
+        this->cutChunk('h', VAL_INVALID);
+    }
+
+    /**
+     * start a new chunk of the dot code, the chunks of equal phase and scope
+     * are plotted equally as long as the corresponding part of heap is equal
+     */
+    void cutChunk(const char phase, const TValId scope) {
+        last.phase = phase;
+        last.scope = scope;
+        last.nth   = 0;
+        if (!chunks)
+            return;
+
+        const std::string chunk(chunkBuf.str());
+        if (chunk.empty())
+            return;
+
+        chunks->push_back(chunk);
+        chunkBuf.str("");
+    }
+
+    /// return a fresh ID of an auxiliary node in the current chunk
+    AuxId auxId() {
+        ++last.nth;
+        return last;
     }
 };
 
@@ -471,7 +524,7 @@ void plotUniformBlocks(PlotData &plot, const TValId root) {
         const UniformBlock &bl = item.second;
 
         // plot block node
-        const int id = ++plot.last;
+        const AuxId id = plot.auxId();
 #if !SYMPLOT_FLAT_MODE
         plot.out << "\t" << SL_QUOTE("lonely" << id)
             << " [shape=box, color=blue, fontcolor=blue, label=\"UNIFORM_BLOCK "
@@ -662,7 +715,7 @@ void plotCompositeObj(PlotData &plot, const TValId at, const TCont &liveObjs)
 
     // open cluster
     plot.out
-        << "subgraph \"cluster" << (++plot.last)
+        << "subgraph \"cluster" << at
         << "\" {\n\trank=same;\n\tlabel=" << SL_QUOTE(label)
         << ";\n\tcolor=" << color
         << ";\n\tfontcolor=" << color
@@ -751,6 +804,8 @@ void plotRootObjects(PlotData &plot) {
             // DLS peers are never plotted directly at this level
             continue;
 
+        plot.cutChunk('r', root);
+
         // gather live objects
         ObjList liveObjs;
         sh.gatherLiveObjects(liveObjs, root);
@@ -882,7 +937,7 @@ void plotCustomValue(
         const TValId                    val,
         const char                     *edgeLabel)
 {
-    const int id = ++plot.last;
+    const AuxId id = plot.auxId();
     plot.out << "\t" << SL_QUOTE("lonely" << id) << " [shape=plaintext";
 
     describeCustomValue(plot, val);
@@ -1001,6 +1056,7 @@ void plotNonRootValues(PlotData &plot) {
 
         // plot a value node
         const TValId val = item.first;
+        plot.cutChunk('v', val);
         plotValue(plot, val);
 
         const TValId root = sh.valRoot(val);
@@ -1035,6 +1091,7 @@ void plotNonRootValues(PlotData &plot) {
     }
 
     // go through value prototypes used in uniform blocks
+    plot.cutChunk('p', VAL_INVALID);
     BOOST_FOREACH(PlotData::TDangValues::const_reference item, plot.dangVals) {
         const TValId val = item.second;
         if (val <= 0)
@@ -1068,20 +1125,13 @@ const char* valNullLabel(const SymHeapCore &sh, const TObjId obj) {
     }
 }
 
-void plotAuxValue(
-        PlotData                       &plot,
-        const int                       node,
-        const TValId                    val,
-        const bool                      isObj,
-        const char                     *edgeLabel = 0)
-{
+/// plot a node representing the given special value and return its ID
+AuxId plotAuxNode(PlotData &plot, const TValId val, const char *nullLabel) {
     const char *color = "blue";
-    const char *label = "NULL";
+    const char *label = nullLabel;
 
     switch (val) {
         case VAL_NULL:
-            if (isObj)
-                label = valNullLabel(plot.sh, static_cast<TObjId>(node));
             break;
 
         case VAL_TRUE:
@@ -1099,16 +1149,30 @@ void plotAuxValue(
             label = "VAL_INVALID";
     }
 
-    const int id = ++plot.last;
+    const AuxId id = plot.auxId();
     plot.out << "\t" << SL_QUOTE("lonely" << id)
         << " [shape=plaintext, fontcolor=" << color
         << ", label=" << SL_QUOTE(label) << "];\n";
 
+    return id;
+}
+
+void plotAuxValue(
+        PlotData                       &plot,
+        const int                       node,
+        const TValId                    val,
+        const bool                      isObj,
+        const char                     *edgeLabel = 0)
+{
+    const char *nullLabel = (isObj)
+        ? valNullLabel(plot.sh, static_cast<TObjId>(node))
+        : "NULL";
+
+    const AuxId id = plotAuxNode(plot, val, nullLabel);
+
     const char *prefix = "";
     if (edgeLabel)
         prefix = "obj";
-    else if (!isObj)
-        prefix = "lonely";
 
     plot.out << "\t" << SL_QUOTE(prefix << node)
         << " -> " << SL_QUOTE("lonely" << id)
@@ -1191,7 +1255,7 @@ void plotHasValueFlat(
 }
 
 void plotNeqZero(PlotData &plot, const TValId val) {
-    const int id = ++plot.last;
+    const AuxId id = plot.auxId();
     plot.out << "\t" << SL_QUOTE("lonely" << id)
         << " [shape=plaintext, fontcolor=blue, label=NULL];\n";
 
@@ -1202,7 +1266,7 @@ void plotNeqZero(PlotData &plot, const TValId val) {
 }
 
 void plotNeqCustom(PlotData &plot, const TValId val, const TValId valCustom) {
-    const int id = ++plot.last;
+    const AuxId id = plot.auxId();
     plot.out << "\t" << SL_QUOTE("lonely" << id)
         << " [shape=plaintext";
 
@@ -1264,6 +1328,7 @@ void plotNeqEdges(PlotData &plot) {
     }
 
     // plot "neq" edges
+    plot.cutChunk('n', VAL_INVALID);
     np.plotNeqEdges(plot);
 }
 
@@ -1275,6 +1340,7 @@ void plotFlatEdges(PlotData &plot) {
         const TValId at = item.first;
         const TValId root = sh.valRoot(at);
         const TOffset beg = sh.valOffset(at);
+        plot.cutChunk('e', at);
 
         BOOST_FOREACH(const ObjHandle &obj, /* ObjList */ item.second) {
             const TObjType clt = obj.objType();
@@ -1300,6 +1366,7 @@ void plotFlatEdges(PlotData &plot) {
         // get all uniform blocks inside the given root
         TUniBlockMap bMap;
         sh.gatherUniformBlocks(bMap, root);
+        plot.cutChunk('u', root);
 
         // plot flat edges for all uniform blocks at the current root
         BOOST_FOREACH(TUniBlockMap::const_reference item, bMap) {
@@ -1315,22 +1382,29 @@ void plotFlatEdges(PlotData &plot) {
 
 void plotHasValueEdges(PlotData &plot) {
     // plot "hasValue" edges
-    BOOST_FOREACH(PlotData::TLiveObjs::const_reference item, plot.liveObjs)
+    BOOST_FOREACH(PlotData::TLiveObjs::const_reference item, plot.liveObjs) {
+        plot.cutChunk('e', /* at */ item.first);
         BOOST_FOREACH(const ObjHandle &obj, /* ObjList */ item.second)
             plotHasValue(plot, obj.objId(), obj.value());
+    }
 
     // plot "hasValue" edges for uniform block prototypes
     BOOST_FOREACH(PlotData::TDangValues::const_reference item, plot.dangVals) {
-        const int id = item.first;
+        const AuxId &id = item.first;
         const TValId val = item.second;
 
-        if (val <= 0) {
-            plotAuxValue(plot, id, val, /* isObj */ false);
-            continue;
-        }
+        // the blocks of a single root go to a single chunk
+        if ('u' != plot.last.phase || id.scope != plot.last.scope)
+            plot.cutChunk('u', id.scope);
+
+        std::ostringstream target;
+        if (val <= 0)
+            target << "lonely" << plotAuxNode(plot, val, "NULL");
+        else
+            target << val;
 
         plot.out << "\t" << SL_QUOTE("lonely" << id)
-            << " -> " << SL_QUOTE(val)
+            << " -> " << SL_QUOTE(target.str())
             << " [color=blue, fontcolor=blue];\n";
     }
 }
@@ -1350,6 +1424,46 @@ void plotEverything(PlotData &plot) {
 #endif
 }
 
+void plotGraph(
+        PlotData                        &plot,
+        const std::string               &plotName,
+        const TValList                  &startingPoints,
+        const bool                      digForward)
+{
+    // open graph
+    plot.out << "digraph " << SL_QUOTE(plotName)
+        << " {\n\tlabel=<<FONT POINT-SIZE=\"18\">" << plotName
+        << "</FONT>>;\n\tclusterrank=local;\n\tlabelloc=t;\n";
+
+    // do our stuff
+    digValues(plot, startingPoints, digForward);
+    plotEverything(plot);
+
+    // close graph
+    plot.cutChunk('t', VAL_INVALID);
+    plot.out << "}\n";
+    plot.cutChunk('t', VAL_INVALID);
+}
+
+bool plotHeapToSink(
+        PlotSink                        *sink,
+        const SymHeap                   &sh,
+        const std::string               &plotName,
+        const struct cl_loc             *loc,
+        const TValList                  &startingPoints,
+        const bool                      digForward)
+{
+    if (loc)
+        CL_NOTE_MSG(loc, "appending heap graph '" << plotName << "'...");
+    else
+        CL_DEBUG("appending heap graph '" << plotName << "'...");
+
+    PlotSink::TChunkList chunks;
+    PlotData plot(sh, chunks);
+    plotGraph(plot, plotName, startingPoints, digForward);
+    return sink->append(plotName, chunks);
+}
+
 bool plotHeap(
         const SymHeap                   &sh,
         const std::string               &name,
@@ -1357,8 +1471,16 @@ bool plotHeap(
         const TValList                  &startingPoints,
         const bool                      digForward)
 {
+    ProfScope prof(PP_PLOT);
     PlotEnumerator *pe = PlotEnumerator::instance();
     std::string plotName(pe->decorate(name));
+
+    PlotSink *sink = PlotSink::instance();
+    if (sink)
+        // write the heap graph to the archive instead of a separate file
+        return plotHeapToSink(sink, sh, plotName, loc, startingPoints,
+                digForward);
+
     std::string fileName(plotName + ".dot");
 
     // create a dot file
@@ -1368,18 +1490,6 @@ bool plotHeap(
         return false;
     }
 
-    // open graph
-    out << "digraph " << SL_QUOTE(plotName)
-        << " {\n\tlabel=<<FONT POINT-SIZE=\"18\">" << plotName
-        << "</FONT>>;\n\tclusterrank=local;\n\tlabelloc=t;\n";
-
-    // check whether we can write to stream
-    if (!out.flush()) {
-        CL_ERROR("unable to write file '" << fileName << "'");
-        out.close();
-        return false;
-    }
-
     if (loc)
         CL_NOTE_MSG(loc, "writing heap graph to '" << fileName << "'...");
     else
@@ -1389,12 +1499,12 @@ bool plotHeap(
     PlotData plot(sh, out);
 
     // do our stuff
-    digValues(plot, startingPoints, digForward);
-    plotEverything(plot);
+    plotGraph(plot, plotName, startingPoints, digForward);
 
-    // close graph
-    out << "}\n";
     const bool ok = !!out;
+    if (!ok)
+        CL_ERROR("unable to write file '" << fileName << "'");
+
     out.close();
     return ok;
 }
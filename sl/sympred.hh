@@ -21,17 +21,15 @@
 #define H_GUARD_SYM_PRED_H
 
 #include "config.h"
+#include "flatmap.hh"
 #include "util.hh"
 
-#include <map>
-#include <set>
-
 /// a symmetric relation
 template <class TKey, bool IREFLEXIVE>
 class SymPairSet {
     protected:
         typedef std::pair<TKey /* lt */, TKey /* gt */>     TItem;
-        typedef std::set<TItem>                             TCont;
+        typedef FlatSet<TItem>                              TCont;
         TCont cont_;
 
     public:
@@ -39,6 +37,10 @@ class SymPairSet {
             return cont_.empty();
         }
 
+        unsigned size() const {
+            return cont_.size();
+        }
+
         bool chk(TKey k1, TKey k2) const {
             sortValues(k1, k2);
             const TItem item(k1, k2);
@@ -66,7 +68,7 @@ template <class TKey, class TVal>
 class SymPairMap {
     protected:
         typedef std::pair<TKey /* lt */, TKey /* gt */>     TItem;
-        typedef std::map<TItem, TVal>                       TMap;
+        typedef FlatMap<TItem, TVal>                        TMap;
         TMap db_;
 
     public:
@@ -32,10 +32,12 @@
 #include "symgc.hh"
 #include "symheap.hh"
 #include "symplot.hh"
+#include "symprof.hh"
 #include "symseg.hh"
 #include "symstate.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
+#include "sync.hh"
 #include "util.hh"
 
 #include <stack>
@@ -47,13 +49,18 @@
 
 // /////////////////////////////////////////////////////////////////////////////
 // SymProc implementation
+
+// backtraces, path tracers and plots are shared by threads of SymExecEngine
+static Mutex printBackTraceMutex;
+
 void SymProc::printBackTrace(EMsgLevel level, bool forcePtrace) {
     // update trace graph
     Trace::MsgNode *trMsg = new Trace::MsgNode(sh_.traceNode(), level, lw_);
     sh_.traceUpdate(trMsg);
     CL_BREAK_IF(!chkTraceGraphConsistency(trMsg));
 
-    // print the backtrace
+    // print the backtrace (one thread at a time)
+    MutexGuard<Mutex> guard(printBackTraceMutex);
     if (bt_->printBackTrace(forcePtrace))
         printMemUsage("SymBackTrace::printBackTrace");
 
@@ -1986,7 +1993,8 @@ bool SymExecCore::execCore(
     this->killInsn(insn);
 
     Trace::Node *trOrig = sh_.traceNode();
-    Trace::Node *trInsn = new Trace::InsnNode(trOrig, &insn, /* bin */ false);
+    Trace::Node *trInsn =
+        Trace::InsnNode::share(trOrig, &insn, /* bin */ false);
     sh_.traceUpdate(trInsn);
     dst.insert(sh_);
     return true;
@@ -2067,6 +2075,7 @@ bool SymExecCore::concretizeLoop(
 }
 
 bool SymExecCore::exec(SymState &dst, const CodeStorage::Insn &insn) {
+    ProfScope prof(PP_INSN);
     TOpIdxList derefs;
 
     const cl_insn_e code = insn.code;
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "symprof.hh"
+
+#include <cl/cl_msg.hh>
+#include <cl/storage.hh>
+
+#include "sync.hh"
+
+#if SE_PROFILE
+#   include <algorithm>
+#   include <fstream>
+#   include <iomanip>
+#   include <map>
+#   include <sstream>
+#   include <vector>
+
+#   include <time.h>
+
+#   include <boost/foreach.hpp>
+
+// /////////////////////////////////////////////////////////////////////////////
+// allocation counters of the current thread
+static THREAD_LOCAL unsigned long long cntAllocs;
+static THREAD_LOCAL unsigned long long cntAllocBytes;
+
+void profCountAlloc(size_t size) {
+    ++::cntAllocs;
+    ::cntAllocBytes += size;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of ProfRecord
+struct ProfCounters {
+    SHARED_CNT(unsigned long long)  cnt;
+    SHARED_CNT(unsigned long long)  totalNs;
+    SHARED_CNT(unsigned long long)  selfNs;
+    SHARED_CNT(unsigned long long)  allocs;
+    SHARED_CNT(unsigned long long)  allocBytes;
+
+    ProfCounters():
+        cnt(0ULL),
+        totalNs(0ULL),
+        selfNs(0ULL),
+        allocs(0ULL),
+        allocBytes(0ULL)
+    {
+    }
+};
+
+/// a snapshot of ProfCounters, which can be copied and summed up
+struct ProfSum {
+    unsigned long long              cnt;
+    unsigned long long              totalNs;
+    unsigned long long              selfNs;
+    unsigned long long              allocs;
+    unsigned long long              allocBytes;
+
+    ProfSum():
+        cnt(0ULL),
+        totalNs(0ULL),
+        selfNs(0ULL),
+        allocs(0ULL),
+        allocBytes(0ULL)
+    {
+    }
+
+    void operator+=(const ProfCounters &pc) {
+        cnt         += pc.cnt;
+        totalNs     += pc.totalNs;
+        selfNs      += pc.selfNs;
+        allocs      += pc.allocs;
+        allocBytes  += pc.allocBytes;
+    }
+
+    void operator+=(const ProfSum &ps) {
+        cnt         += ps.cnt;
+        totalNs     += ps.totalNs;
+        selfNs      += ps.selfNs;
+        allocs      += ps.allocs;
+        allocBytes  += ps.allocBytes;
+    }
+};
+
+/// numbers measured for a single basic block (or a function as a whole)
+struct ProfRecord {
+    const CodeStorage::Fnc         *fnc;
+    const CodeStorage::Block       *bb;
+    ProfCounters                    phases[PP_LAST];
+
+    ProfRecord(const CodeStorage::Fnc *fnc_, const CodeStorage::Block *bb_):
+        fnc(fnc_),
+        bb(bb_)
+    {
+    }
+};
+
+typedef std::pair<const CodeStorage::Fnc *, const CodeStorage::Block *> TKey;
+typedef std::map<TKey, ProfRecord *>                    TRecordMap;
+
+/// all records ever created, they are never destroyed
+static TRecordMap recordMap;
+static Mutex recordMapLock;
+
+/// scopes that are not accounted to any basic block go here
+static ProfRecord outOfBlocks(0, 0);
+
+static ProfRecord* lookupRecord(
+        const CodeStorage::Fnc      *fnc,
+        const CodeStorage::Block    *bb)
+{
+    MutexGuard<Mutex> guard(::recordMapLock);
+
+    ProfRecord *&rec = ::recordMap[TKey(fnc, bb)];
+    if (!rec)
+        rec = new ProfRecord(fnc, bb);
+
+    return rec;
+}
+
+// the state of the profiler in the current thread
+static THREAD_LOCAL ProfRecord *curRecord;
+static THREAD_LOCAL ProfScope *curScope;
+static THREAD_LOCAL unsigned phaseDepth[PP_LAST];
+
+static unsigned long long nowNs() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts))
+        return 0ULL;
+
+    return 1000000000ULL * ts.tv_sec + ts.tv_nsec;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of ProfScope and ProfBlock
+ProfScope::ProfScope(EProfPhase phase):
+    phase_(phase),
+    rec_((::curRecord) ? ::curRecord : &::outOfBlocks),
+    parent_(::curScope),
+    outermost_(!::phaseDepth[phase]++),
+    startNs_(nowNs()),
+    startAllocs_(::cntAllocs),
+    startBytes_(::cntAllocBytes),
+    nestedNs_(0ULL),
+    nestedAllocs_(0ULL),
+    nestedBytes_(0ULL)
+{
+    ::curScope = this;
+}
+
+ProfScope::~ProfScope() {
+    const unsigned long long ns     = nowNs() - startNs_;
+    const unsigned long long allocs = ::cntAllocs - startAllocs_;
+    const unsigned long long bytes  = ::cntAllocBytes - startBytes_;
+
+    ProfCounters &pc = rec_->phases[phase_];
+    pc.cnt          += 1ULL;
+    pc.selfNs       += ns - nestedNs_;
+    pc.allocs       += allocs - nestedAllocs_;
+    pc.allocBytes   += bytes - nestedBytes_;
+    if (outermost_)
+        pc.totalNs  += ns;
+
+    if (parent_) {
+        parent_->nestedNs_      += ns;
+        parent_->nestedAllocs_  += allocs;
+        parent_->nestedBytes_   += bytes;
+    }
+
+    --::phaseDepth[phase_];
+    ::curScope = parent_;
+}
+
+ProfBlock::ProfBlock(
+        const CodeStorage::Fnc      *fnc,
+        const CodeStorage::Block    *bb):
+    prev_(::curRecord)
+{
+    ::curRecord = lookupRecord(fnc, bb);
+}
+
+ProfBlock::~ProfBlock() {
+    ::curRecord = prev_;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// reports
+static const char *phaseNames[PP_LAST] = {
+    "block",
+    "insn",
+    "call_cache",
+    "join",
+    "cmp",
+    "abstract",
+    "gc",
+    "plot"
+};
+
+struct ProfSumList {
+    std::string                     name;
+    ProfSum                         phases[PP_LAST];
+
+    unsigned long long selfNs() const {
+        unsigned long long sum = 0ULL;
+        for (int i = 0; i < PP_LAST; ++i)
+            sum += phases[i].selfNs;
+
+        return sum;
+    }
+
+    bool operator<(const ProfSumList &ref) const {
+        // sort by self time in descending order
+        return ref.selfNs() < this->selfNs();
+    }
+};
+
+typedef std::vector<ProfSumList>                        TSumLists;
+
+static std::string fncNameOf(const ProfRecord &rec) {
+    return (rec.fnc)
+        ? nameOf(*rec.fnc)
+        : "(none)";
+}
+
+/// collect the numbers per phase, per function and per basic block
+static void collectProfile(ProfSumList &total, TSumLists &fncs, TSumLists &bbs)
+{
+    MutexGuard<Mutex> guard(::recordMapLock);
+
+    std::vector<const ProfRecord *> recs;
+    recs.push_back(&::outOfBlocks);
+    BOOST_FOREACH(TRecordMap::const_reference item, ::recordMap)
+        recs.push_back(item.second);
+
+    typedef std::map<const CodeStorage::Fnc *, unsigned> TFncIdx;
+    TFncIdx fncIdx;
+
+    total.name = "(total)";
+    BOOST_FOREACH(const ProfRecord *rec, recs) {
+        TFncIdx::iterator it = fncIdx.find(rec->fnc);
+        if (fncIdx.end() == it) {
+            it = fncIdx.insert(std::make_pair(rec->fnc, fncs.size())).first;
+            fncs.push_back(ProfSumList());
+            fncs.back().name = fncNameOf(*rec);
+        }
+
+        ProfSumList &fncSum = fncs[it->second];
+
+        ProfSumList bbSum;
+        bbSum.name = fncSum.name;
+        if (rec->bb)
+            bbSum.name += "/" + rec->bb->name();
+
+        for (int i = 0; i < PP_LAST; ++i) {
+            const ProfCounters &pc = rec->phases[i];
+            total.phases[i] += pc;
+            fncSum.phases[i] += pc;
+            bbSum.phases[i] += pc;
+        }
+
+        bbs.push_back(bbSum);
+    }
+
+    std::stable_sort(fncs.begin(), fncs.end());
+    std::stable_sort(bbs.begin(), bbs.end());
+}
+
+static std::string fmtNs(unsigned long long ns) {
+    std::ostringstream str;
+    str << std::fixed << std::setprecision(3)
+        << (static_cast<double>(ns) / 1e9) << " s";
+    return str.str();
+}
+
+static std::string fmtBytes(unsigned long long bytes) {
+    std::ostringstream str;
+    str << std::fixed << std::setprecision(2)
+        << (static_cast<double>(bytes) / (1U << /* MiB */ 20)) << " MB";
+    return str.str();
+}
+
+static void printSumList(const ProfSumList &sl) {
+    for (int i = 0; i < PP_LAST; ++i) {
+        const ProfSum &ps = sl.phases[i];
+        if (!ps.cnt)
+            continue;
+
+        CL_DEBUG("profile: " << sl.name << ": "
+                << phaseNames[i]
+                << ": cnt = " << ps.cnt
+                << ", total = " << fmtNs(ps.totalNs)
+                << ", self = " << fmtNs(ps.selfNs)
+                << ", allocs = " << ps.allocs
+                << " (" << fmtBytes(ps.allocBytes) << ")");
+    }
+}
+
+void printProfile() {
+    ProfSumList total;
+    TSumLists fncs, bbs;
+    collectProfile(total, fncs, bbs);
+    printSumList(total);
+
+    static const unsigned TOP_N = 8;
+    for (unsigned i = 0; i < fncs.size() && i < TOP_N; ++i)
+        printSumList(fncs[i]);
+
+    for (unsigned i = 0; i < bbs.size() && i < TOP_N; ++i)
+        printSumList(bbs[i]);
+}
+
+static std::string jsonQuote(const std::string &str) {
+    std::ostringstream out;
+    out << '"';
+    BOOST_FOREACH(const char c, str) {
+        if ('"' == c || '\\' == c)
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                << static_cast<int>(c) << std::dec;
+        else
+            out << c;
+    }
+
+    out << '"';
+    return out.str();
+}
+
+static void dumpSumList(std::ostream &out, const ProfSumList &sl) {
+    out << "{ \"name\": " << jsonQuote(sl.name) << ", \"phases\": {";
+
+    bool first = true;
+    for (int i = 0; i < PP_LAST; ++i) {
+        const ProfSum &ps = sl.phases[i];
+        if (!ps.cnt)
+            continue;
+
+        if (!first)
+            out << ",";
+
+        first = false;
+        out << "\n      \"" << phaseNames[i] << "\": {"
+            << " \"count\": "       << ps.cnt
+            << ", \"total_ns\": "   << ps.totalNs
+            << ", \"self_ns\": "    << ps.selfNs
+            << ", \"allocs\": "     << ps.allocs
+            << ", \"alloc_bytes\": "<< ps.allocBytes
+            << " }";
+    }
+
+    out << " } }";
+}
+
+static void dumpSumLists(std::ostream &out, const TSumLists &lists) {
+    out << "[";
+    for (unsigned i = 0; i < lists.size(); ++i) {
+        out << ((i) ? ",\n    " : "\n    ");
+        dumpSumList(out, lists[i]);
+    }
+
+    out << "\n  ]";
+}
+
+bool dumpProfile(const std::string &fileName) {
+    ProfSumList total;
+    TSumLists fncs, bbs;
+    collectProfile(total, fncs, bbs);
+
+    std::fstream out(fileName.c_str(), std::ios::out);
+    if (!out) {
+        CL_ERROR("unable to create file '" << fileName << "'");
+        return false;
+    }
+
+    out << "{\n  \"total\": ";
+    dumpSumList(out, total);
+    out << ",\n  \"functions\": ";
+    dumpSumLists(out, fncs);
+    out << ",\n  \"blocks\": ";
+    dumpSumLists(out, bbs);
+    out << "\n}\n";
+
+    const bool ok = !!out.flush();
+    if (ok)
+        CL_DEBUG("profile written to '" << fileName << "'");
+    else
+        CL_ERROR("unable to write file '" << fileName << "'");
+
+    return ok;
+}
+
+#else // SE_PROFILE
+
+void printProfile() {
+}
+
+bool dumpProfile(const std::string &) {
+    return false;
+}
+
+#endif // SE_PROFILE
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_SYM_PROF_H
+#define H_GUARD_SYM_PROF_H
+
+/**
+ * @file symprof.hh
+ * ProfScope, ProfBlock - lightweight profiler of the symbolic execution
+ *
+ * Each ProfScope measures the wall-clock time and the count and size of
+ * allocations of heap entities and copy-on-write data (see syments.hh) done
+ * by the current thread till the end of the scope.  The
+ * numbers are accounted to the basic block most recently entered by ProfBlock
+ * in the current thread.  The @b total numbers of a phase do not include the
+ * nested scopes of the same phase, the @b self numbers do not include any
+ * nested scope at all.  The whole machinery compiles to nothing unless
+ * SE_PROFILE is enabled in config.h.
+ */
+
+#include "config.h"
+
+#include <cstddef>
+#include <string>
+
+namespace CodeStorage {
+    struct Block;
+    struct Fnc;
+}
+
+/// phases of the analysis distinguished by the profiler
+enum EProfPhase {
+    PP_BLOCK = 0,       ///< SymExecEngine::execBlock() as a whole
+    PP_INSN,            ///< instruction handlers of SymExecCore
+    PP_CALL_CACHE,      ///< SymCallCache::getCallCtx()
+    PP_JOIN,            ///< joinSymHeaps()
+    PP_CMP,             ///< areEqual()
+    PP_ABSTRACT,        ///< abstractIfNeeded()
+    PP_GC,              ///< collectJunk() and collectSharedJunk()
+    PP_PLOT,            ///< plotHeap()
+    PP_LAST             ///< not a phase, only count of the phases
+};
+
+#if SE_PROFILE
+
+/// account an allocation of the given size to the scopes of current thread
+void profCountAlloc(size_t size);
+
+struct ProfRecord;
+
+/// measure the given phase till the end of scope
+class ProfScope {
+    public:
+        ProfScope(EProfPhase phase);
+        ~ProfScope();
+
+    private:
+        /// object copying is @b not allowed
+        ProfScope(const ProfScope &);
+
+        /// object copying is @b not allowed
+        ProfScope& operator=(const ProfScope &);
+
+    private:
+        const EProfPhase        phase_;
+        ProfRecord              *rec_;
+        ProfScope               *parent_;
+        bool                    outermost_;
+        unsigned long long      startNs_;
+        unsigned long long      startAllocs_;
+        unsigned long long      startBytes_;
+        unsigned long long      nestedNs_;
+        unsigned long long      nestedAllocs_;
+        unsigned long long      nestedBytes_;
+};
+
+/// account the scopes of the current thread to the given basic block
+class ProfBlock {
+    public:
+        /// @param bb basic block, zero means the function as a whole
+        ProfBlock(const CodeStorage::Fnc *fnc, const CodeStorage::Block *bb);
+        ~ProfBlock();
+
+    private:
+        /// object copying is @b not allowed
+        ProfBlock(const ProfBlock &);
+
+        /// object copying is @b not allowed
+        ProfBlock& operator=(const ProfBlock &);
+
+    private:
+        ProfRecord              *prev_;
+};
+
+#else // SE_PROFILE
+
+/// dummy implementation, compiles to nothing
+inline void profCountAlloc(size_t) { }
+
+/// dummy implementation, compiles to nothing
+struct ProfScope {
+    ProfScope(EProfPhase) { }
+};
+
+/// dummy implementation, compiles to nothing
+struct ProfBlock {
+    ProfBlock(const CodeStorage::Fnc *, const CodeStorage::Block *) { }
+};
+
+#endif // SE_PROFILE
+
+/// print the numbers per phase, the top functions and basic blocks (verbose)
+void printProfile();
+
+/**
+ * dump all the numbers measured so far to the given file in JSON format
+ * @return false if SE_PROFILE is disabled or the file could not be written
+ */
+bool dumpProfile(const std::string &fileName);
+
+#endif /* H_GUARD_SYM_PROF_H */
@@ -37,11 +37,8 @@
 
 #include <boost/foreach.hpp>
 
-#if SE_USE_DFS_SCHEDULER
-#   include <stack>
-#else
-#   include <queue>
-#endif
+#include <queue>
+#include <stack>
 
 #define SS_DEBUG(...) do {                                                  \
     if (::debugSymState)                                                    \
@@ -51,7 +48,13 @@
 // set to 'true' if you wonder why SymState matches states as it does (noisy)
 static bool debugSymState = static_cast<bool>(DEBUG_SYMSTATE);
 
-static int cntLookups = -1;
+static SHARED_CNT(int) cntLookups(-1);
+
+static SymStateStats stats;
+
+const SymStateStats& symStateStats() {
+    return ::stats;
+}
 
 namespace {
     void debugPlot(const char *name, int idx, const SymHeap &sh) {
@@ -77,6 +80,7 @@ void SymState::clear() {
         delete sh;
 
     heaps_.clear();
+    fprints_.clear();
 }
 
 SymState::~SymState() {
@@ -91,6 +95,9 @@ SymState& SymState::operator=(const SymState &ref) {
     BOOST_FOREACH(const SymHeap *sh, ref.heaps_)
         heaps_.push_back(new SymHeap(*sh));
 
+    // the clones have the same fingerprints
+    fprints_ = ref.fprints_;
+
     return *this;
 }
 
@@ -107,6 +114,45 @@ void SymState::insertNew(const SymHeap &sh) {
 
     // append the pointer to our container
     heaps_.push_back(dup);
+    fprints_.push_back(CachedFingerprint());
+}
+
+SymState::CachedFingerprint& SymState::cachedFingerprint(int nth) const {
+    const SymHeap &sh = *heaps_[nth];
+    CachedFingerprint &cached = fprints_.at(nth);
+    if (cached.lastId != sh.lastId()) {
+        // the heap has been changed in place since then
+        cached = CachedFingerprint();
+        cached.lastId = sh.lastId();
+    }
+
+    return cached;
+}
+
+const HeapFingerprint& SymState::fingerprint(int nth) const {
+    CachedFingerprint &cached = this->cachedFingerprint(nth);
+    if (!cached.fpValid) {
+        heapFingerprint(&cached.fp, *heaps_[nth]);
+        cached.fpValid = true;
+    }
+
+    return cached.fp;
+}
+
+const JoinSummary& SymState::joinSummaryOf(int nth) const {
+    CachedFingerprint &cached = this->cachedFingerprint(nth);
+    if (!cached.jsValid) {
+        joinSummary(&cached.js, *heaps_[nth]);
+        cached.jsValid = true;
+    }
+
+    return cached.js;
+}
+
+void SymState::cacheJoinSummary(int nth, const JoinSummary &js) const {
+    CachedFingerprint &cached = this->cachedFingerprint(nth);
+    cached.js = js;
+    cached.jsValid = true;
 }
 
 bool SymState::insert(const SymHeap &sh, bool /* allowThreeWay */ ) {
@@ -128,16 +174,31 @@ int SymHeapUnion::lookup(const SymHeap &lookFor) const {
         return -1;
 
     ++::cntLookups;
+    ++::stats.lookups;
     SS_DEBUG(">>> lookup() starts, cnt = " << cnt);
     debugPlot("lookup", 0, lookFor);
 
+#if SE_STATE_FINGERPRINTS
+    HeapFingerprint fp;
+    heapFingerprint(&fp, lookFor);
+#endif
+
     for(int idx = 0; idx < cnt; ++idx) {
         const int nth = idx + 1;
-        SS_DEBUG("--> lookup() tries sh #" << idx << ", cnt = " << cnt);
-
         const SymHeap &sh = this->operator[](idx);
+
+#if SE_STATE_FINGERPRINTS
+        if (fp.shape != this->fingerprint(idx).shape) {
+            // the heaps cannot be isomorphic
+            CL_BREAK_IF(::debugSymState && areEqual(lookFor, sh));
+            ++::stats.cmpSkipped;
+            continue;
+        }
+#endif
+        SS_DEBUG("--> lookup() tries sh #" << idx << ", cnt = " << cnt);
         debugPlot("lookup", nth, sh);
 
+        ++::stats.cmpCalls;
         if (areEqual(lookFor, sh)) {
             SS_DEBUG("<<< lookup() returns sh #" << idx << ", cnt = " << cnt);
             return idx;
@@ -162,9 +223,26 @@ void SymStateWithJoin::packSuffix(unsigned idx) {
         TStorRef stor = shNew.stor();
         CL_BREAK_IF(&stor != &shOld.stor());
 
+#if SE_STATE_FINGERPRINTS
+        const JoinSummary *pJsNew = &this->joinSummaryOf(suffix);
+        const JoinSummary *pJsOld = &this->joinSummaryOf(idx);
+        if (!joinMayMatch(*pJsNew, *pJsOld)) {
+            // joinSymHeaps() would fail anyway
+            ++::stats.joinSkipped;
+            ++idx;
+            continue;
+        }
+#else
+        const JoinSummary *pJsNew = 0;
+        const JoinSummary *pJsOld = 0;
+#endif
+        ++::stats.joinCalls;
+
         EJoinStatus     status;
         SymHeap         result(stor, new Trace::TransientNode("packSuffix()"));
-        if (!joinSymHeaps(&status, &result, shNew, shOld)) {
+        if (!joinSymHeaps(&status, &result, shNew, shOld, /* 3-way */ true,
+                    pJsNew, pJsOld))
+        {
             ++idx;
             continue;
         }
@@ -179,8 +257,9 @@ void SymStateWithJoin::packSuffix(unsigned idx) {
                 break;
 
             case JS_USE_SH2:
-                this->swapExisting(suffix, shOld);
-                break;
+                // shOld entails shNew, keep shOld (as it is) instead
+                this->replaceExisting(suffix, idx);
+                continue;
 
             case JS_THREE_WAY:
                 this->swapExisting(suffix, result);
@@ -192,6 +271,8 @@ void SymStateWithJoin::packSuffix(unsigned idx) {
 }
 
 bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
+    ++::stats.inserts;
+
     const int cnt = this->size();
     if (!cnt) {
         // no heaps inside, insert the first now
@@ -204,10 +285,29 @@ bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
             new Trace::TransientNode("SymStateWithJoin::insert()"));
     int             idx;
 
+#if SE_STATE_FINGERPRINTS
+    JoinSummary js;
+    joinSummary(&js, shNew);
+#endif
+
     ++::cntLookups;
     for(idx = 0; idx < cnt; ++idx) {
         const SymHeap &shOld = this->operator[](idx);
-        if (joinSymHeaps(&status, &result, shOld, shNew, allowThreeWay))
+#if SE_STATE_FINGERPRINTS
+        const JoinSummary *pJsOld = &this->joinSummaryOf(idx);
+        const JoinSummary *pJsNew = &js;
+        if (!joinMayMatch(*pJsNew, *pJsOld)) {
+            // joinSymHeaps() would fail anyway
+            ++::stats.joinSkipped;
+            continue;
+        }
+#else
+        const JoinSummary *pJsOld = 0;
+        const JoinSummary *pJsNew = 0;
+#endif
+        ++::stats.joinCalls;
+        if (joinSymHeaps(&status, &result, shOld, shNew, allowThreeWay,
+                    pJsOld, pJsNew))
             // join succeeded
             break;
     }
@@ -215,6 +315,9 @@ bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
     if (idx == cnt) {
         // nothing to join here
         this->insertNew(shNew);
+#if SE_STATE_FINGERPRINTS
+        this->cacheJoinSummary(cnt, js);
+#endif
         return true;
     }
 
@@ -261,23 +364,171 @@ bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
 }
 
 
+// /////////////////////////////////////////////////////////////////////////////
+// SymStateMarked implementation
+void SymStateMarked::swapExisting(int nth, SymHeap &sh) {
+    SymStateWithJoin::swapExisting(nth, sh);
+
+    // an already inserted heap has been generalized, we need to schedule it
+    // once again
+    if (done_.at(nth))
+        ++::stats.reschedules;
+
+    done_[nth] = false;
+}
+
+void SymStateMarked::replaceExisting(int nth, int by) {
+    SymStateWithJoin::replaceExisting(nth, by);
+
+    // the heap at 'by' has been kept as it is, so the results of its
+    // processing (if any) already cover the heap it replaces
+    const bool done = done_.at(by);
+    if (done)
+        // swapExisting() would have scheduled it once again
+        ++::stats.reschedSaved;
+
+    done_[nth] = done;
+    done_.erase(done_.begin() + by);
+}
+
+
 // /////////////////////////////////////////////////////////////////////////////
 // BlockScheduler implementation
 struct BlockScheduler::Private {
-#if SE_USE_DFS_SCHEDULER
-    typedef std::stack<TBlock>                              TSched;
-#else
-    typedef std::queue<TBlock>                              TSched;
-#endif
     typedef std::map<TBlock, unsigned /* cnt */>            TDone;
+    typedef std::map<TBlock, unsigned /* wto */>            TOrder;
+    typedef std::pair<unsigned /* wto */, TBlock>           TPrioItem;
+
+    ESchedPolicy                    policy;
+    TBlockSet                       todo;
+    std::queue<TBlock>              fifo;
+    std::stack<TBlock>              lifo;
+    std::set<TPrioItem>             prio;
+    TOrder                          order;
+    TDone                           done;
+    unsigned                        cntExecuted;
+
+    Private(ESchedPolicy policy_):
+        policy(policy_),
+        cntExecuted(0U)
+    {
+    }
 
-    TBlockSet           todo;
-    TSched              sched;
-    TDone               done;
+    unsigned orderOf(const TBlock bb);
+    void computeOrder(const TBlock entry);
 };
 
-BlockScheduler::BlockScheduler():
-    d(new Private)
+/// state of Bourdoncle's algorithm computing a weak topological order
+struct WtoCtx {
+    typedef BlockScheduler::TBlock                          TBlock;
+    typedef std::map<TBlock, unsigned /* dfn */>            TDfn;
+
+    static const unsigned           DFN_DONE = static_cast<unsigned>(-1);
+
+    TDfn                            dfn;
+    std::stack<TBlock>              stack;
+    unsigned                        num;
+    BlockScheduler::TBlockList      revOrder;
+
+    WtoCtx():
+        num(0U)
+    {
+    }
+
+    unsigned visit(const TBlock bb);
+    void component(const TBlock head);
+};
+
+unsigned WtoCtx::visit(const TBlock bb) {
+    this->stack.push(bb);
+    const unsigned dfnBb = (this->dfn[bb] = ++this->num);
+    unsigned head = dfnBb;
+    bool loop = false;
+
+    BOOST_FOREACH(const TBlock bbNext, bb->back()->targets) {
+        unsigned min = this->dfn[bbNext];
+        if (!min)
+            min = this->visit(bbNext);
+
+        if (min <= head) {
+            head = min;
+            loop = true;
+        }
+    }
+
+    if (head != dfnBb)
+        // bb is a part of a component headed by a block up in the DFS stack
+        return head;
+
+    this->dfn[bb] = DFN_DONE;
+    TBlock top = this->stack.top();
+    this->stack.pop();
+    if (!loop) {
+        this->revOrder.push_back(bb);
+        return head;
+    }
+
+    // bb is head of a loop, forget the blocks of its body and number them again
+    while (top != bb) {
+        this->dfn[top] = 0U;
+        top = this->stack.top();
+        this->stack.pop();
+    }
+
+    this->component(bb);
+    return head;
+}
+
+void WtoCtx::component(const TBlock head) {
+    BOOST_FOREACH(const TBlock bbNext, head->back()->targets)
+        if (!this->dfn[bbNext])
+            this->visit(bbNext);
+
+    // the order is built backwards, the head goes in front of the loop body
+    this->revOrder.push_back(head);
+}
+
+/// number the blocks of the given CFG by the weak topological order (Bourdoncle
+/// 1993), so that the head of each loop precedes its body, and the whole loop
+/// (including the nested ones) precedes the blocks that follow the loop
+void BlockScheduler::Private::computeOrder(const TBlock entry) {
+    WtoCtx ctx;
+
+    // blocks already numbered are treated as if they were processed already
+    BOOST_FOREACH(TOrder::const_reference item, this->order)
+        ctx.dfn[/* bb */ item.first] = WtoCtx::DFN_DONE;
+
+    ctx.visit(entry);
+
+    // blocks of a CFG are numbered consecutively after those already known
+    const TBlockList &revOrder = ctx.revOrder;
+    const unsigned base = this->order.size();
+    const unsigned cnt = revOrder.size();
+    for (unsigned i = 0U; i < cnt; ++i)
+        this->order[revOrder[cnt - 1U - i]] = base + i;
+}
+
+unsigned BlockScheduler::Private::orderOf(const TBlock bb) {
+    TOrder::const_iterator it = this->order.find(bb);
+    if (this->order.end() != it)
+        return it->second;
+
+    // first block of this CFG we see, number all blocks reachable from entry
+    const TBlock entry = bb->cfg()->entry();
+    if (!hasKey(this->order, entry)) {
+        this->computeOrder(entry);
+        it = this->order.find(bb);
+        if (this->order.end() != it)
+            return it->second;
+    }
+
+    // not reachable from the entry of its CFG, put it behind the others
+    this->computeOrder(bb);
+    return this->order[bb];
+}
+
+BlockScheduler::BlockScheduler(ESchedPolicy policy):
+    d(new Private(policy))
 {
 }
 
@@ -290,6 +541,14 @@ BlockScheduler::~BlockScheduler() {
     delete d;
 }
 
+ESchedPolicy BlockScheduler::policy() const {
+    return d->policy;
+}
+
+unsigned BlockScheduler::cntExecuted() const {
+    return d->cntExecuted;
+}
+
 unsigned BlockScheduler::cntWaiting() const {
     return d->todo.size();
 }
@@ -311,7 +570,20 @@ bool BlockScheduler::schedule(const TBlock bb) {
         // already in the queue
         return false;
 
-    d->sched.push(bb);
+    switch (d->policy) {
+        case SP_BFS:
+            d->fifo.push(bb);
+            break;
+
+        case SP_DFS:
+            d->lifo.push(bb);
+            break;
+
+        case SP_LOOP:
+            d->prio.insert(Private::TPrioItem(d->orderOf(bb), bb));
+            break;
+    }
+
     return true;
 }
 
@@ -320,17 +592,30 @@ bool BlockScheduler::getNext(TBlock *dst) {
         return false;
 
     // take the first block in the queue
-#if SE_USE_DFS_SCHEDULER
-    const TBlock bb = d->sched.top();
-#else
-    const TBlock bb = d->sched.front();
-#endif
-    d->sched.pop();
+    TBlock bb = 0;
+    switch (d->policy) {
+        case SP_BFS:
+            bb = d->fifo.front();
+            d->fifo.pop();
+            break;
+
+        case SP_DFS:
+            bb = d->lifo.top();
+            d->lifo.pop();
+            break;
+
+        case SP_LOOP:
+            bb = d->prio.begin()->second;
+            d->prio.erase(d->prio.begin());
+            break;
+    }
+
     if (1 != d->todo.erase(bb))
         CL_BREAK_IF("BlockScheduler malfunction");
 
     *dst = bb;
     d->done[bb]++;
+    d->cntExecuted++;
     return true;
 }
 
@@ -343,6 +628,11 @@ void BlockScheduler::printStats() const {
         rMap[/* cnt */ item.second].push_back(/* bb */ item.first);
     }
 
+    static const char *policyNames[] = { "BFS", "DFS", "loop-aware" };
+    CL_NOTE("___ " << policyNames[d->policy] << " scheduler executed "
+            << d->cntExecuted << " basic block(s), "
+            << d->done.size() << " of them distinct");
+
     BOOST_FOREACH(TRMap::const_reference item, rMap) {
         const unsigned cnt = item.first;
         BOOST_FOREACH(const TBlock bb, /* TBlockList */ item.second) {
@@ -28,7 +28,10 @@
 #include <set>
 #include <vector>
 
+#include "symcmp.hh"
 #include "symheap.hh"
+#include "symjoin.hh"
+#include "sync.hh"
 
 namespace CodeStorage {
     class Block;
@@ -53,6 +56,7 @@ class SymState {
 
         virtual void swap(SymState &other) {
             heaps_.swap(other.heaps_);
+            fprints_.swap(other.fprints_);
         }
 
         /**
@@ -91,18 +95,57 @@ class SymState {
         virtual void eraseExisting(int nth) {
             delete heaps_[nth];
             heaps_.erase(heaps_.begin() + nth);
+            fprints_.erase(fprints_.begin() + nth);
         }
 
         virtual void swapExisting(int nth, SymHeap &sh) {
             SymHeap &existing = *heaps_.at(nth);
             existing.swap(sh);
+            fprints_.at(nth) = CachedFingerprint();
         }
 
+        /**
+         * replace the nth SymHeap object by the one at position @b by, which
+         * is known to entail it, and erase the original position of the latter
+         */
+        virtual void replaceExisting(int nth, int by) {
+            delete heaps_.at(nth);
+            heaps_[nth] = heaps_.at(by);
+            fprints_.at(nth) = fprints_.at(by);
+            heaps_.erase(heaps_.begin() + by);
+            fprints_.erase(fprints_.begin() + by);
+        }
+
+        /// return fingerprint of the nth SymHeap object, computed on demand
+        const HeapFingerprint& fingerprint(int nth) const;
+
+        /// return JoinSummary of the nth SymHeap object, computed on demand
+        const JoinSummary& joinSummaryOf(int nth) const;
+
+        /// store an already computed JoinSummary of the nth SymHeap object
+        void cacheJoinSummary(int nth, const JoinSummary &js) const;
+
         /// lookup/insert optimization in SymCallCache implementation
         friend class PerFncCache;
 
     private:
+        struct CachedFingerprint {
+            bool                fpValid;
+            bool                jsValid;
+            unsigned            lastId;     ///< SymHeap::lastId() when computed
+            HeapFingerprint     fp;
+            JoinSummary         js;
+
+            CachedFingerprint(): fpValid(false), jsValid(false), lastId(0) { }
+        };
+
+        CachedFingerprint& cachedFingerprint(int nth) const;
+
         TList heaps_;
+
+        /// fingerprints of heaps_; symjoin may create variables in the heaps
+        /// it reads, so the cache is valid only as long as lastId() is kept
+        mutable std::vector<CachedFingerprint> fprints_;
 };
 
 class SymHeapList: public SymState {
@@ -153,7 +196,9 @@ class SymStateWithJoin: public SymHeapUnion {
  * Extension of SymStateWithJoin, which distinguishes among already processed
  * symbolic heaps and symbolic heaps scheduled for processing.  Newly inserted
  * symbolic heaps are always marked as scheduled.  They can be marked as done
- * later, using the setDone() method.
+ * later, using the setDone() method.  If a heap is generalized by a heap that
+ * has already been processed, the done flag moves along with the latter, so
+ * that the basic block is not executed once again for the same heap.
  */
 class SymStateMarked: public SymStateWithJoin {
     public:
@@ -189,13 +234,9 @@ class SymStateMarked: public SymStateWithJoin {
             done_.erase(done_.begin() + nth);
         }
 
-        virtual void swapExisting(int nth, SymHeap &sh) {
-            SymStateWithJoin::swapExisting(nth, sh);
+        virtual void swapExisting(int nth, SymHeap &sh);
 
-            // an already inserted heap has been generalized, we need to
-            // schedule it once again
-            done_.at(nth) = false;
-        }
+        virtual void replaceExisting(int nth, int by);
 
     public:
         /// check if the nth symbolic heap has been already processed
@@ -265,12 +306,36 @@ class SymStateMap {
         Private *d;
 };
 
+/// counters of heap comparisons performed while maintaining symbolic states
+struct SymStateStats {
+    typedef SHARED_CNT(unsigned long) TCnt;
+
+    TCnt                lookups;        ///< SymHeapUnion::lookup() calls
+    TCnt                cmpCalls;       ///< areEqual() actually called
+    TCnt                cmpSkipped;     ///< areEqual() avoided by fingerprints
+    TCnt                inserts;        ///< SymStateWithJoin::insert() calls
+    TCnt                joinCalls;      ///< joinSymHeaps() actually called
+    TCnt                joinSkipped;    ///< joinSymHeaps() avoided by fingerprints
+    TCnt                reschedules;    ///< processed heaps scheduled again
+    TCnt                reschedSaved;   ///< re-executions avoided by entailment
+};
+
+/// global counters of SymHeapUnion and SymStateWithJoin
+const SymStateStats& symStateStats();
+
 class IStatsProvider {
     public:
         virtual ~IStatsProvider() { }
         virtual void printStats() const = 0;
 };
 
+/// policy of BlockScheduler for picking the next basic block to process
+enum ESchedPolicy {
+    SP_BFS = 0,         ///< in the order the basic blocks were scheduled
+    SP_DFS,             ///< the most recently scheduled basic block first
+    SP_LOOP             ///< weak topological order, loops stabilize first
+};
+
 class BlockScheduler: public IStatsProvider {
     public:
         typedef const CodeStorage::Block       *TBlock;
@@ -278,10 +343,15 @@ class BlockScheduler: public IStatsProvider {
         typedef std::vector<TBlock>             TBlockList;
 
     public:
-        BlockScheduler();
+        BlockScheduler(ESchedPolicy policy = SP_BFS);
         BlockScheduler(const BlockScheduler &);
         ~BlockScheduler();
 
+        ESchedPolicy policy() const;
+
+        /// count of basic blocks taken by getNext() so far
+        unsigned cntExecuted() const;
+
         const TBlockSet& todo() const;
 
         TBlockList done() const;
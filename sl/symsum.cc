@@ -0,0 +1,1257 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "symsum.hh"
+
+#include <cl/cl_msg.hh>
+#include <cl/clutil.hh>
+#include <cl/code_listener.h>
+#include <cl/storage.hh>
+
+#include "symcmp.hh"
+#include "symseg.hh"
+#include "symtrace.hh"
+#include "symutil.hh"
+#include "util.hh"
+
+#include <cerrno>
+#include <cstdio>           // for rename()
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <sys/stat.h>       // for mkdir()
+#include <unistd.h>         // for getpid()
+
+#include <boost/foreach.hpp>
+
+/// bump this whenever the format of the stored summaries changes
+static const char *sumMagic = "predator-summary-3";
+
+// /////////////////////////////////////////////////////////////////////////////
+// low-level I/O helpers
+
+void writeStr(std::ostream &out, const std::string &str) {
+    // length-prefixed, so that we do not need to escape anything
+    out << str.size() << ":" << str;
+}
+
+bool readStr(std::istream &in, std::string *pDst) {
+    size_t len;
+    char sep;
+    if (!(in >> len) || !in.get(sep) || ':' != sep)
+        return false;
+
+    pDst->resize(len);
+    if (len)
+        in.read(&(*pDst)[0], len);
+
+    return !!in;
+}
+
+bool readTok(std::istream &in, const char *tok) {
+    std::string str;
+    return (in >> str) && (str == tok);
+}
+
+/// 64bit FNV-1a, used to name the file, the full key is compared on load
+std::string hashOf(const std::string &str) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    BOOST_FOREACH(const char c, str) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+
+    std::ostringstream out;
+    out << std::hex << std::setfill('0')
+        << std::setw(16) << hash
+        << "-" << str.size();
+    return out.str();
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of SummaryStore::Private
+struct SummaryStore::Private {
+    typedef std::map<const struct cl_type *, std::string>      TTypeKeys;
+    typedef std::map<std::string, TObjType>                     TTypeByKey;
+    typedef std::map<int /* uid */, std::string>                TKeyByUid;
+    typedef std::map<std::string, int /* uid */>                TUidByKey;
+    typedef std::set<int /* fnc uid */>                         TFncSet;
+    typedef std::vector<const CodeStorage::Fnc *>               TFncList;
+
+    TStorRef                    stor;
+    const std::string           dir;
+    const std::string           tag;
+    bool                        dirReady;
+    bool                        indexReady;
+
+    TTypeKeys                   typeKeys;
+    TTypeByKey                  typeByKey;
+    TKeyByUid                   varKeys;
+    TUidByKey                   varByKey;
+    TUidByKey                   fncByName;
+    TKeyByUid                   digests;
+    TKeyByUid                   keyTexts;
+
+    Private(TStorRef stor_, const std::string &dir_, const std::string &tag_):
+        stor(stor_),
+        dir(dir_),
+        tag(tag_),
+        dirReady(false),
+        indexReady(false)
+    {
+    }
+
+    const std::string& typeKey(const struct cl_type *clt);
+    void initIndex();
+    bool varKey(std::string *pDst, int uid);
+
+    bool digestCst(std::ostream &, const struct cl_cst &);
+    bool digestOperand(std::ostream &, const struct cl_operand &);
+    bool digestInsn(std::ostream &, const CodeStorage::Insn &, TFncList &,
+                    TFncSet &);
+    bool digestFnc(std::ostream &, const CodeStorage::Fnc &, TFncList &,
+                   TFncSet &);
+    bool digestOf(std::string *pDigest, std::string *pKey,
+                  const CodeStorage::Fnc &);
+
+    std::string fileNameOf(const std::string &digest) const {
+        return dir + "/" + digest + ".sum";
+    }
+
+    bool ensureDir();
+};
+
+void appendShallowTypeKey(std::ostream &str, const struct cl_type *clt) {
+    str << clt->code
+        << "/" << clt->size
+        << "/" << clt->is_unsigned
+        << "/" << clt->array_size
+        << "/" << clt->item_cnt;
+
+    if (clt->name)
+        str << "/" << clt->name;
+}
+
+/// structural description of a type, which does not depend on its uid
+const std::string& SummaryStore::Private::typeKey(const struct cl_type *clt) {
+    TTypeKeys::const_iterator it = this->typeKeys.find(clt);
+    if (this->typeKeys.end() != it)
+        return it->second;
+
+    std::ostringstream str;
+    if (!clt)
+        str << "-";
+    else
+        appendShallowTypeKey(str, clt);
+
+    const enum cl_type_e code = (clt)
+        ? clt->code
+        : CL_TYPE_UNKNOWN;
+
+    switch (code) {
+        case CL_TYPE_PTR: {
+            // do not go through pointers to composite types (may be recursive)
+            const struct cl_type *cltTarget = targetTypeOfPtr(clt);
+            str << " *(";
+            if (isComposite(cltTarget) || CL_TYPE_FNC == cltTarget->code)
+                appendShallowTypeKey(str, cltTarget);
+            else
+                str << this->typeKey(cltTarget);
+            str << ")";
+            break;
+        }
+
+        case CL_TYPE_ARRAY:
+            str << " [" << this->typeKey(targetTypeOfArray(clt)) << "]";
+            break;
+
+        case CL_TYPE_STRUCT:
+        case CL_TYPE_UNION:
+            str << " {";
+            for (int i = 0; i < clt->item_cnt; ++i) {
+                const struct cl_type_item *item = clt->items + i;
+                if (item->name)
+                    str << " ." << item->name;
+
+                str << " @" << item->offset
+                    << " " << this->typeKey(item->type) << ";";
+            }
+            str << " }";
+            break;
+
+        default:
+            break;
+    }
+
+    return (this->typeKeys[clt] = str.str());
+}
+
+void SummaryStore::Private::initIndex() {
+    using namespace CodeStorage;
+    if (this->indexReady)
+        return;
+
+    this->indexReady = true;
+
+    // index types by their structure
+    BOOST_FOREACH(const struct cl_type *clt, this->stor.types) {
+        const std::string &key = this->typeKey(clt);
+        if (!hasKey(this->typeByKey, key))
+            this->typeByKey[key] = clt;
+    }
+
+    // index global variables by their names, ambiguous names are not usable
+    BOOST_FOREACH(const Var &var, this->stor.vars) {
+        if (isOnStack(var) || var.name.empty())
+            continue;
+
+        const std::string key = "g/" + var.name;
+        this->varKeys[var.uid] = key;
+
+        if (hasKey(this->varByKey, key))
+            this->varByKey[key] = /* ambiguous */ -1;
+        else
+            this->varByKey[key] = var.uid;
+    }
+
+    // index functions by their names, ambiguous names are not usable
+    BOOST_FOREACH(const Fnc *fnc, this->stor.fncs) {
+        if (!fnc)
+            continue;
+
+        const char *name = nameOf(*fnc);
+        if (!name)
+            continue;
+
+        if (hasKey(this->fncByName, name))
+            this->fncByName[name] = /* ambiguous */ -1;
+        else
+            this->fncByName[name] = uidOf(*fnc);
+
+        if (!isDefined(*fnc))
+            continue;
+
+        // index local variables by the name of the function, the name of the
+        // variable, and the count of preceding variables of the same name
+        std::map<std::string, int> cntByName;
+        BOOST_FOREACH(const int uid, fnc->vars) {
+            const Var &var = this->stor.vars[uid];
+            if (!isOnStack(var))
+                continue;
+
+            std::ostringstream str;
+            str << "l/" << name << "/" << var.name
+                << "/" << (cntByName[var.name]++);
+
+            const std::string key = str.str();
+            this->varKeys[uid] = key;
+            this->varByKey[key] = uid;
+        }
+    }
+}
+
+bool SummaryStore::Private::varKey(std::string *pDst, int uid) {
+    this->initIndex();
+
+    const TKeyByUid::const_iterator it = this->varKeys.find(uid);
+    if (this->varKeys.end() == it)
+        return false;
+
+    *pDst = it->second;
+    return true;
+}
+
+bool SummaryStore::Private::digestCst(
+        std::ostream                    &str,
+        const struct cl_cst             &cst)
+{
+    const enum cl_type_e code = cst.code;
+    str << " c" << code << ":";
+
+    switch (code) {
+        case CL_TYPE_FNC: {
+            const char *name = cst.data.cst_fnc.name;
+            if (!name)
+                // anonymous function
+                return false;
+
+            str << name;
+            return true;
+        }
+
+        case CL_TYPE_INT:
+            str << cst.data.cst_int.value;
+            return true;
+
+        case CL_TYPE_STRING:
+            writeStr(str, cst.data.cst_string.value);
+            return true;
+
+        case CL_TYPE_REAL:
+            str << std::setprecision(17) << cst.data.cst_real.value;
+            return true;
+
+        default:
+            // unsupported literal
+            return false;
+    }
+}
+
+bool SummaryStore::Private::digestOperand(
+        std::ostream                    &str,
+        const struct cl_operand         &op)
+{
+    const enum cl_operand_e code = op.code;
+    str << " [" << code;
+
+    switch (code) {
+        case CL_OPERAND_VOID:
+            str << "]";
+            return true;
+
+        case CL_OPERAND_CST:
+            if (!this->digestCst(str, op.data.cst))
+                return false;
+            break;
+
+        case CL_OPERAND_VAR: {
+            std::string key;
+            if (!this->varKey(&key, varIdFromOperand(&op)))
+                return false;
+
+            str << " ";
+            writeStr(str, key);
+            break;
+        }
+    }
+
+    str << " " << this->typeKey(op.type);
+
+    for (const struct cl_accessor *ac = op.accessor; ac; ac = ac->next) {
+        const enum cl_accessor_e code = ac->code;
+        str << " ." << code << ":" << this->typeKey(ac->type);
+
+        switch (code) {
+            case CL_ACCESSOR_ITEM:
+                str << ":" << ac->data.item.id;
+                break;
+
+            case CL_ACCESSOR_DEREF_ARRAY:
+                if (!this->digestOperand(str, *ac->data.array.index))
+                    return false;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    str << "]";
+    return true;
+}
+
+bool SummaryStore::Private::digestInsn(
+        std::ostream                    &str,
+        const CodeStorage::Insn         &insn,
+        TFncList                        &todo,
+        TFncSet                         &seen)
+{
+    using namespace CodeStorage;
+
+    const enum cl_insn_e code = insn.code;
+    str << code << "." << insn.subCode;
+
+    BOOST_FOREACH(const struct cl_operand &op, insn.operands)
+        if (!this->digestOperand(str, op))
+            return false;
+
+    BOOST_FOREACH(const Block *bb, insn.targets)
+        str << " -> " << bb->name();
+
+    BOOST_FOREACH(const unsigned idx, insn.loopClosingTargets)
+        str << " loop:" << idx;
+
+    std::string key;
+    BOOST_FOREACH(const KillVar &kv, insn.varsToKill) {
+        if (!this->varKey(&key, kv.uid))
+            return false;
+
+        str << " kill:" << kv.onlyIfNotPointed << ":";
+        writeStr(str, key);
+    }
+
+    const unsigned cntTargets = insn.killPerTarget.size();
+    for (unsigned i = 0; i < cntTargets; ++i) {
+        BOOST_FOREACH(const KillVar &kv, insn.killPerTarget[i]) {
+            if (!this->varKey(&key, kv.uid))
+                return false;
+
+            str << " kill" << i << ":" << kv.onlyIfNotPointed << ":";
+            writeStr(str, key);
+        }
+    }
+
+    str << "\n";
+
+    if (CL_INSN_CALL != code)
+        return true;
+
+    int uid;
+    if (!fncUidFromOperand(&uid, &insn.operands[/* fnc */ 1]))
+        // indirect call, the callee depends on the heap we are called with
+        return false;
+
+    // schedule the callee
+    if (insertOnce(seen, uid))
+        todo.push_back(this->stor.fncs[uid]);
+
+    return true;
+}
+
+bool SummaryStore::Private::digestFnc(
+        std::ostream                    &str,
+        const CodeStorage::Fnc          &fnc,
+        TFncList                        &todo,
+        TFncSet                         &seen)
+{
+    using namespace CodeStorage;
+
+    const char *name = nameOf(fnc);
+    if (!name)
+        return false;
+
+    str << "fnc " << name << "\n";
+    if (!isDefined(fnc)) {
+        // either a built-in, or an external function
+        str << "extern\n";
+        return true;
+    }
+
+    std::string key;
+    BOOST_FOREACH(const int uid, fnc.args) {
+        if (!this->varKey(&key, uid))
+            return false;
+
+        str << "arg ";
+        writeStr(str, key);
+        str << "\n";
+    }
+
+    BOOST_FOREACH(const int uid, fnc.vars) {
+        const Var &var = this->stor.vars[uid];
+        if (!this->varKey(&key, uid))
+            return false;
+
+        str << "var ";
+        writeStr(str, key);
+        str << " " << this->typeKey(var.type)
+            << " " << var.initialized
+            << " " << var.mayBePointed << "\n";
+    }
+
+    BOOST_FOREACH(const Block *bb, fnc.cfg) {
+        str << "bb " << bb->name() << "\n";
+        BOOST_FOREACH(const Insn *insn, *bb)
+            if (!this->digestInsn(str, *insn, todo, seen))
+                return false;
+    }
+
+    return true;
+}
+
+bool SummaryStore::Private::digestOf(
+        std::string                     *pDigest,
+        std::string                     *pKey,
+        const CodeStorage::Fnc          &fnc)
+{
+    const int uid = uidOf(fnc);
+    const TKeyByUid::const_iterator it = this->digests.find(uid);
+    if (this->digests.end() != it) {
+        *pDigest = it->second;
+        *pKey = this->keyTexts[uid];
+        return !pDigest->empty();
+    }
+
+    // the results depend on the version of the analyzer and its options
+    std::ostringstream str;
+    str << GIT_SHA1 << "\n" << this->tag << "\n";
+
+    // go through the function and all the functions it may call
+    TFncList todo;
+    TFncSet seen;
+    todo.push_back(&fnc);
+    seen.insert(uid);
+
+    bool ok = true;
+    for (unsigned i = 0; ok && i < todo.size(); ++i)
+        ok = this->digestFnc(str, *todo[i], todo, seen);
+
+    std::string &digest = this->digests[uid];
+    std::string &key = this->keyTexts[uid];
+    if (ok) {
+        // the digest only names the file, two keys may still collide
+        key = str.str();
+        digest = hashOf(key);
+    }
+
+    *pDigest = digest;
+    *pKey = key;
+    return ok;
+}
+
+bool SummaryStore::Private::ensureDir() {
+    if (this->dirReady)
+        return true;
+
+    if (mkdir(this->dir.c_str(), 0755) && EEXIST != errno) {
+        CL_WARN("failed to create directory for function summaries: "
+                << this->dir);
+        return false;
+    }
+
+    this->dirReady = true;
+    return true;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// serialization of SymHeap objects
+class HeapWriter {
+    private:
+        SummaryStore::Private           &ctx_;
+        SymHeap                         &sh_;
+        std::ostringstream              roots_;
+        std::ostringstream              vals_;
+        std::ostringstream              blocks_;
+        std::ostringstream              objs_;
+        std::ostringstream              preds_;
+        TValSet                         known_;
+
+    public:
+        HeapWriter(SummaryStore::Private &ctx, const SymHeap &sh):
+            ctx_(ctx),
+            sh_(const_cast<SymHeap &>(sh))
+        {
+        }
+
+        bool write(std::ostream &out);
+
+    private:
+        bool writeRoot(TValId root);
+        bool writeContents(TValId root);
+        bool writeValue(TValId val);
+        bool writeCustomValue(TValId val);
+        void writePreds();
+};
+
+bool HeapWriter::writeRoot(const TValId root) {
+    roots_ << "root " << root << " ";
+
+    if (VAL_ADDR_OF_RET == root) {
+        roots_ << "ret ";
+        writeStr(roots_, ctx_.typeKey(sh_.valLastKnownTypeOfTarget(root)));
+        roots_ << "\n";
+        return true;
+    }
+
+    const EValueTarget code = sh_.valTarget(root);
+    if (isProgramVar(code)) {
+        const CVar cv = sh_.cVarByRoot(root);
+        std::string key;
+        if (!ctx_.varKey(&key, cv.uid))
+            return false;
+
+        roots_ << "var ";
+        writeStr(roots_, key);
+        roots_ << " " << cv.inst << "\n";
+        return true;
+    }
+
+    if (!isOnHeap(code))
+        return false;
+
+    const TSizeRange size = sh_.valSizeOfTarget(root);
+    roots_ << "heap "
+        << size.lo << " "
+        << size.hi << " "
+        << size.alignment << " ";
+
+    writeStr(roots_, ctx_.typeKey(sh_.valLastKnownTypeOfTarget(root)));
+    roots_ << " " << sh_.valTargetProtoLevel(root);
+
+    if (isAbstract(code)) {
+        const BindingOff &off = sh_.segBinding(root);
+        roots_ << " " << sh_.valTargetKind(root)
+            << " " << off.head
+            << " " << off.next
+            << " " << off.prev
+            << " " << objMinLength(sh_, root);
+    }
+    else
+        roots_ << " " << OK_CONCRETE;
+
+    roots_ << "\n";
+    return true;
+}
+
+bool HeapWriter::writeContents(const TValId root) {
+    TUniBlockMap bMap;
+    sh_.gatherUniformBlocks(bMap, root);
+    BOOST_FOREACH(TUniBlockMap::const_reference item, bMap) {
+        const UniformBlock &bl = item.second;
+        if (!this->writeValue(bl.tplValue))
+            return false;
+
+        blocks_ << "block " << root
+            << " " << bl.off
+            << " " << bl.size
+            << " " << bl.tplValue << "\n";
+    }
+
+    ObjList objs;
+    sh_.gatherLiveObjects(objs, root);
+    BOOST_FOREACH(const ObjHandle &obj, objs) {
+        const TObjType clt = obj.objType();
+        if (isComposite(clt, /* includingArray */ false))
+            continue;
+
+        const TValId val = obj.value();
+        if (!this->writeValue(val))
+            return false;
+
+        objs_ << "obj " << root
+            << " " << sh_.valOffset(obj.placedAt()) << " ";
+        writeStr(objs_, ctx_.typeKey(clt));
+        objs_ << " " << val << "\n";
+    }
+
+    return true;
+}
+
+bool HeapWriter::writeCustomValue(const TValId val) {
+    const CustomValue &cust = sh_.valUnwrapCustom(val);
+    const ECustomValue code = cust.code();
+    vals_ << "val " << val << " custom " << code << " ";
+
+    switch (code) {
+        case CV_FNC: {
+            const CodeStorage::Fnc *fnc = sh_.stor().fncs[cust.uid()];
+            const char *name = (fnc)
+                ? nameOf(*fnc)
+                : 0;
+            if (!name)
+                return false;
+
+            writeStr(vals_, name);
+            break;
+        }
+
+        case CV_INT_RANGE: {
+            const IR::Range &rng = cust.rng();
+            vals_ << rng.lo << " " << rng.hi << " " << rng.alignment;
+            break;
+        }
+
+        case CV_REAL:
+            vals_ << std::setprecision(17) << cust.fpn();
+            break;
+
+        case CV_STRING:
+            writeStr(vals_, cust.str());
+            break;
+
+        case CV_INVALID:
+            return false;
+    }
+
+    vals_ << "\n";
+    return true;
+}
+
+bool HeapWriter::writeValue(const TValId val) {
+    if (val <= 0 || hasKey(known_, val))
+        // special values and the values we have already written
+        return true;
+
+    const EValueTarget code = realValTarget(sh_, val);
+    const TValId root = sh_.valRoot(val);
+    const bool isAddr = isAnyDataArea(code) || VAL_NULL == root;
+    if (isAddr && VAL_NULL != root && !hasKey(known_, root))
+        // we have not written the target root, should not happen
+        return false;
+
+    known_.insert(val);
+
+    if (VT_CUSTOM == code)
+        return this->writeCustomValue(val);
+
+    if (!isAddr) {
+        // an unknown value
+        vals_ << "val " << val << " anon " << code
+            << " " << sh_.valOrigin(val) << "\n";
+        return true;
+    }
+
+    if (VT_RANGE == sh_.valTarget(val)) {
+        const IR::Range rng = sh_.valOffsetRange(val);
+        vals_ << "val " << val << " range " << root
+            << " " << rng.lo << " " << rng.hi << " " << rng.alignment << "\n";
+        return true;
+    }
+
+    vals_ << "val " << val << " addr " << root
+        << " " << sh_.valOffset(val) << "\n";
+    return true;
+}
+
+void HeapWriter::writePreds() {
+    BOOST_FOREACH(const TValId val, known_) {
+        // only the Neq predicates actually stored, proveNeq() would also
+        // give us the ones implied by the shape of the heap
+        TValList neqs;
+        sh_.gatherNeqPreds(neqs, val);
+        BOOST_FOREACH(const TValId other, neqs) {
+            if (0 < other && (other <= val || !hasKey(known_, other)))
+                // either already written, or not relevant
+                continue;
+
+            preds_ << "neq " << val << " " << other << "\n";
+        }
+    }
+}
+
+bool HeapWriter::write(std::ostream &out) {
+    TValList roots;
+    sh_.gatherRootObjects(roots);
+    if (sh_.valLastKnownTypeOfTarget(VAL_ADDR_OF_RET))
+        roots.push_back(VAL_ADDR_OF_RET);
+
+    // write all the roots first, so that we can refer to them from values
+    BOOST_FOREACH(const TValId root, roots) {
+        if (!insertOnce(known_, root))
+            continue;
+
+        if (!this->writeRoot(root))
+            return false;
+    }
+
+    BOOST_FOREACH(const TValId root, roots)
+        if (!this->writeContents(root))
+            return false;
+
+    this->writePreds();
+
+    out << roots_.str()
+        << vals_.str()
+        << blocks_.str()
+        << objs_.str()
+        << preds_.str()
+        << "end\n";
+
+    return !!out;
+}
+
+class HeapReader {
+    private:
+        typedef std::map<TValId /* seg */, TMinLen /* len */>   TSegLengths;
+
+        SummaryStore::Private           &ctx_;
+        SymHeap                         &sh_;
+        std::istream                    &in_;
+        TValMap                         valMap_;
+        TSegLengths                     segLengths_;
+
+    public:
+        HeapReader(SummaryStore::Private &ctx, SymHeap &sh, std::istream &in):
+            ctx_(ctx),
+            sh_(sh),
+            in_(in)
+        {
+            valMap_[VAL_ADDR_OF_RET] = VAL_ADDR_OF_RET;
+        }
+
+        bool read();
+
+    private:
+        bool readVal(TValId *pDst);
+        bool readType(TObjType *pDst);
+        bool readRoot();
+        bool readValue();
+        bool readCustomValue(TValId *pDst);
+        bool readBlock();
+        bool readObj();
+        bool readNeq();
+};
+
+bool HeapReader::readVal(TValId *pDst) {
+    int id;
+    if (!(in_ >> id))
+        return false;
+
+    if (id <= 0) {
+        // special values always match
+        *pDst = static_cast<TValId>(id);
+        return true;
+    }
+
+    const TValMap::const_iterator it = valMap_.find(static_cast<TValId>(id));
+    if (valMap_.end() == it)
+        return false;
+
+    *pDst = it->second;
+    return true;
+}
+
+bool HeapReader::readType(TObjType *pDst) {
+    std::string key;
+    if (!readStr(in_, &key))
+        return false;
+
+    if (key == "-") {
+        *pDst = 0;
+        return true;
+    }
+
+    const SummaryStore::Private::TTypeByKey &tMap = ctx_.typeByKey;
+    const SummaryStore::Private::TTypeByKey::const_iterator it =
+        tMap.find(key);
+    if (tMap.end() == it)
+        // type not available in the code being analyzed
+        return false;
+
+    *pDst = it->second;
+    return true;
+}
+
+bool HeapReader::readRoot() {
+    int id;
+    std::string kind;
+    if (!(in_ >> id >> kind))
+        return false;
+
+    const TValId src = static_cast<TValId>(id);
+
+    if (kind == "ret") {
+        TObjType clt;
+        if (VAL_ADDR_OF_RET != src || !this->readType(&clt))
+            return false;
+
+        if (clt)
+            sh_.valSetLastKnownTypeOfTarget(VAL_ADDR_OF_RET, clt);
+
+        return true;
+    }
+
+    if (kind == "var") {
+        std::string key;
+        int inst;
+        if (!readStr(in_, &key) || !(in_ >> inst))
+            return false;
+
+        const SummaryStore::Private::TUidByKey &vMap = ctx_.varByKey;
+        const SummaryStore::Private::TUidByKey::const_iterator it =
+            vMap.find(key);
+        if (vMap.end() == it || -1 == it->second)
+            // variable not available in the code being analyzed
+            return false;
+
+        const CVar cv(it->second, inst);
+        valMap_[src] = sh_.addrOfVar(cv, /* createIfNeeded */ true);
+        return true;
+    }
+
+    if (kind != "heap")
+        return false;
+
+    TSizeRange size;
+    TObjType clt;
+    int protoLevel, code;
+    if (!(in_ >> size.lo >> size.hi >> size.alignment)
+            || !this->readType(&clt)
+            || !(in_ >> protoLevel >> code))
+        return false;
+
+    const TValId root = sh_.heapAlloc(size);
+    valMap_[src] = root;
+
+    if (clt)
+        sh_.valSetLastKnownTypeOfTarget(root, clt);
+
+    sh_.valTargetSetProtoLevel(root, protoLevel);
+
+    const EObjKind objKind = static_cast<EObjKind>(code);
+    if (OK_CONCRETE == objKind)
+        return true;
+
+    BindingOff off;
+    int len;
+    if (!(in_ >> off.head >> off.next >> off.prev >> len))
+        return false;
+
+    sh_.valTargetSetAbstract(root, objKind, off);
+    segLengths_[root] = len;
+    return true;
+}
+
+bool HeapReader::readCustomValue(TValId *pDst) {
+    int code;
+    if (!(in_ >> code))
+        return false;
+
+    switch (static_cast<ECustomValue>(code)) {
+        case CV_FNC: {
+            std::string name;
+            if (!readStr(in_, &name))
+                return false;
+
+            const SummaryStore::Private::TUidByKey &fMap = ctx_.fncByName;
+            const SummaryStore::Private::TUidByKey::const_iterator it =
+                fMap.find(name);
+            if (fMap.end() == it || -1 == it->second)
+                return false;
+
+            *pDst = sh_.valWrapCustom(CustomValue(it->second));
+            return true;
+        }
+
+        case CV_INT_RANGE: {
+            IR::Range rng;
+            if (!(in_ >> rng.lo >> rng.hi >> rng.alignment))
+                return false;
+
+            *pDst = sh_.valWrapCustom(CustomValue(rng));
+            return true;
+        }
+
+        case CV_REAL: {
+            double fpn;
+            if (!(in_ >> fpn))
+                return false;
+
+            *pDst = sh_.valWrapCustom(CustomValue(fpn));
+            return true;
+        }
+
+        case CV_STRING: {
+            std::string str;
+            if (!readStr(in_, &str))
+                return false;
+
+            *pDst = sh_.valWrapCustom(CustomValue(str.c_str()));
+            return true;
+        }
+
+        case CV_INVALID:
+            break;
+    }
+
+    return false;
+}
+
+bool HeapReader::readValue() {
+    int id;
+    std::string kind;
+    if (!(in_ >> id >> kind))
+        return false;
+
+    TValId &dst = valMap_[static_cast<TValId>(id)];
+
+    if (kind == "custom")
+        return this->readCustomValue(&dst);
+
+    if (kind == "anon") {
+        int code, origin;
+        if (!(in_ >> code >> origin))
+            return false;
+
+        dst = sh_.valCreate(static_cast<EValueTarget>(code),
+                            static_cast<EValueOrigin>(origin));
+        return true;
+    }
+
+    TValId root;
+    if (!this->readVal(&root))
+        return false;
+
+    if (kind == "range") {
+        IR::Range rng;
+        if (!(in_ >> rng.lo >> rng.hi >> rng.alignment))
+            return false;
+
+        dst = sh_.valByRange(root, rng);
+        return true;
+    }
+
+    TOffset off;
+    if (kind != "addr" || !(in_ >> off))
+        return false;
+
+    dst = sh_.valByOffset(root, off);
+    return true;
+}
+
+bool HeapReader::readBlock() {
+    TValId root, tpl;
+    TOffset off;
+    TSizeOf size;
+    if (!this->readVal(&root) || !(in_ >> off >> size) || !this->readVal(&tpl))
+        return false;
+
+    const TValId addr = sh_.valByOffset(root, off);
+    sh_.writeUniformBlock(addr, tpl, size);
+    return true;
+}
+
+bool HeapReader::readObj() {
+    TValId root, val;
+    TOffset off;
+    TObjType clt;
+    if (!this->readVal(&root) || !(in_ >> off)
+            || !this->readType(&clt) || !clt
+            || !this->readVal(&val))
+        return false;
+
+    const TValId addr = sh_.valByOffset(root, off);
+    const ObjHandle obj(sh_, addr, clt);
+    if (!obj.isValid())
+        return false;
+
+    obj.setValue(val);
+    return true;
+}
+
+bool HeapReader::readNeq() {
+    TValId v1, v2;
+    if (!this->readVal(&v1) || !this->readVal(&v2))
+        return false;
+
+    // the Neq predicates were written as stored in SymHeapCore, so we bypass
+    // SymHeap::neqOp(), which would turn them into minimal lengths of segments
+    // (those are restored separately at the end of the heap)
+    sh_.SymHeapCore::neqOp(SymHeap::NEQ_ADD, v1, v2);
+    return true;
+}
+
+bool HeapReader::read() {
+    std::string what;
+    while (in_ >> what) {
+        bool ok;
+        if (what == "end") {
+            BOOST_FOREACH(TSegLengths::const_reference item, segLengths_)
+                sh_.segSetMinLength(/* seg */ item.first, /* len */ item.second);
+
+            return true;
+        }
+        else if (what == "root")
+            ok = this->readRoot();
+        else if (what == "val")
+            ok = this->readValue();
+        else if (what == "block")
+            ok = this->readBlock();
+        else if (what == "obj")
+            ok = this->readObj();
+        else if (what == "neq")
+            ok = this->readNeq();
+        else
+            ok = false;
+
+        if (!ok)
+            return false;
+    }
+
+    // premature end of file
+    return false;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of SummaryStore
+SummaryStore::SummaryStore(
+        TStorRef                        stor,
+        const std::string               &dir,
+        const std::string               &tag):
+    d(new Private(stor, dir, tag))
+{
+}
+
+SummaryStore::~SummaryStore() {
+    delete d;
+}
+
+bool SummaryStore::load(TCallSummaryList &dst, const CodeStorage::Fnc &fnc) {
+    std::string digest, key;
+    if (!d->digestOf(&digest, &key, fnc))
+        return false;
+
+    const std::string fileName = d->fileNameOf(digest);
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    if (!in)
+        // nothing stored for this function yet
+        return false;
+
+    const struct cl_loc *loc = locationOf(fnc);
+    const std::string name(nameOf(fnc));
+
+    // check the header
+    std::string str;
+    unsigned cnt;
+    if (!readTok(in, sumMagic)
+            || !readStr(in, &str) || str != digest
+            || !readStr(in, &str) || str != name
+            || !readStr(in, &str)
+            || !(in >> cnt))
+    {
+        CL_DEBUG_MSG(loc, "SummaryStore: ignoring malformed " << fileName);
+        return false;
+    }
+
+    if (str != key) {
+        // a collision of digests, the summary belongs to some other code
+        CL_DEBUG_MSG(loc, "SummaryStore: key mismatch in " << fileName);
+        return false;
+    }
+
+    d->initIndex();
+
+    TCallSummaryList loaded;
+    for (unsigned i = 0; i < cnt; ++i) {
+        unsigned cntResults;
+        if (!readTok(in, "summary") || !(in >> cntResults))
+            break;
+
+        SymHeap entry(d->stor, new Trace::TransientNode("SummaryStore::load()"));
+
+        HeapReader entryReader(*d, entry, in);
+        if (!entryReader.read())
+            break;
+
+        CallSummary sum(entry);
+        unsigned j;
+        for (j = 0; j < cntResults; ++j) {
+            // as far as the trace is concerned, the result originates from fnc
+            SymHeap sh(d->stor, new Trace::RootNode(&fnc));
+            HeapReader reader(*d, sh, in);
+            if (!reader.read())
+                break;
+
+            sum.results.insert(sh);
+        }
+
+        if (j < cntResults)
+            break;
+
+        loaded.push_back(sum);
+    }
+
+    if (loaded.size() != cnt) {
+        // better to recompute the function than to use something incomplete,
+        // e.g. a type used by the summary may be missing in this TU
+        CL_DEBUG_MSG(loc, "SummaryStore: failed to load " << fileName);
+        return false;
+    }
+
+    CL_DEBUG_MSG(loc, "SummaryStore: loaded " << cnt << " summaries of "
+            << name << "() from " << fileName);
+
+    dst.insert(dst.end(), loaded.begin(), loaded.end());
+    return !loaded.empty();
+}
+
+bool SummaryStore::save(
+        const CodeStorage::Fnc          &fnc,
+        const TCallSummaryList          &src)
+{
+    std::string digest, key;
+    if (!d->digestOf(&digest, &key, fnc) || !d->ensureDir())
+        return false;
+
+    const struct cl_loc *loc = locationOf(fnc);
+    const std::string name(nameOf(fnc));
+
+    // keep the summaries stored by other runs (possibly with other entry
+    // heaps) unless we have computed the same entry ourselves
+    TCallSummaryList all(src);
+    TCallSummaryList stored;
+    this->load(stored, fnc);
+    BOOST_FOREACH(const CallSummary &sum, stored) {
+        bool found = false;
+        BOOST_FOREACH(const CallSummary &ref, src) {
+            if (areEqual(sum.entry, ref.entry)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            all.push_back(sum);
+    }
+
+    // serialize all the heaps before we touch the file system
+    std::ostringstream out;
+    out << sumMagic << " ";
+    writeStr(out, digest);
+    out << " ";
+    writeStr(out, name);
+    out << "\n";
+    writeStr(out, key);
+    out << " " << all.size() << "\n";
+
+    BOOST_FOREACH(const CallSummary &sum, all) {
+        out << "summary " << sum.results.size() << "\n";
+
+        HeapWriter entryWriter(*d, sum.entry);
+        if (!entryWriter.write(out))
+            return false;
+
+        BOOST_FOREACH(const SymHeap *sh, sum.results) {
+            HeapWriter writer(*d, *sh);
+            if (!writer.write(out)) {
+                CL_DEBUG_MSG(loc, "SummaryStore: failed to serialize a heap of "
+                        << name << "()");
+                return false;
+            }
+        }
+    }
+
+    // write a temporary file and rename it, as other runs may read it
+    const std::string fileName = d->fileNameOf(digest);
+    std::ostringstream tmpName;
+    tmpName << fileName << ".tmp." << getpid();
+
+    {
+        std::ofstream file(tmpName.str().c_str(), std::ios::binary);
+        file << out.str();
+        if (!file) {
+            CL_WARN_MSG(loc, "failed to write function summary: " << fileName);
+            return false;
+        }
+    }
+
+    if (rename(tmpName.str().c_str(), fileName.c_str())) {
+        CL_WARN_MSG(loc, "failed to write function summary: " << fileName);
+        remove(tmpName.str().c_str());
+        return false;
+    }
+
+    CL_DEBUG_MSG(loc, "SummaryStore: saved " << all.size() << " summaries of "
+            << name << "() to " << fileName);
+    return true;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_SYM_SUM_H
+#define H_GUARD_SYM_SUM_H
+
+/**
+ * @file symsum.hh
+ * SummaryStore - function summaries persisted across runs of the analyzer
+ */
+
+#include "symheap.hh"
+#include "symstate.hh"
+
+#include <string>
+#include <vector>
+
+namespace CodeStorage {
+    struct Fnc;
+}
+
+/// a single call cache entry, the (already cut) entry heap and its results
+struct CallSummary {
+    SymHeap                     entry;
+    SymHeapList                 results;
+
+    explicit CallSummary(const SymHeap &entry_):
+        entry(entry_)
+    {
+    }
+};
+
+/// a list of call cache entries of a single function
+typedef std::vector<CallSummary>                        TCallSummaryList;
+
+/**
+ * a directory of function summaries shared by subsequent runs of the analyzer
+ *
+ * The summaries of a function are keyed by a digest of the code of the
+ * function and all the functions it may call.  The digest does not depend on
+ * the IDs assigned by Code Listener, so the summaries of functions defined in
+ * a shared header file can be reused by all translation units that include
+ * the header file.  Types, variables, and functions referred by the stored
+ * heaps are resolved by their names and structure while loading.  The text
+ * the digest is computed from is stored along with the summaries and compared
+ * while loading, so that a collision of digests is never taken for a match.
+ */
+class SummaryStore {
+    public:
+        /**
+         * @param stor the code being analyzed
+         * @param dir directory to load the summaries from and save them to
+         * @param tag anything else the results depend on (run-time options)
+         */
+        SummaryStore(TStorRef stor, const std::string &dir,
+                     const std::string &tag);
+
+        ~SummaryStore();
+
+        /**
+         * append the summaries stored for the given function to dst
+         * @return true if any summaries have been loaded
+         */
+        bool load(TCallSummaryList &dst, const CodeStorage::Fnc &fnc);
+
+        /**
+         * store src as the summaries of the given function, along with the
+         * summaries stored by other runs for the entry heaps not found in src
+         * @return false if the function (or any of the heaps) cannot be stored,
+         * e.g. because the function makes an indirect call
+         */
+        bool save(const CodeStorage::Fnc &fnc, const TCallSummaryList &src);
+
+    private:
+        /// object copying is @b not allowed
+        SummaryStore(const SummaryStore &);
+
+        /// object copying is @b not allowed
+        SummaryStore& operator=(const SummaryStore &);
+
+    private:
+        struct Private;
+        Private *d;
+
+        friend class /* SummaryStore helper */ HeapReader;
+        friend class /* SummaryStore helper */ HeapWriter;
+};
+
+#endif /* H_GUARD_SYM_SUM_H */
@@ -24,27 +24,251 @@
 #include <cl/storage.hh>
 
 #include "plotenum.hh"
+#include "sync.hh"
 #include "worklist.hh"
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <map>
 #include <set>
+#include <new>
 #include <sstream>
 
+#include <stdint.h>
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/foreach.hpp>
 
 namespace Trace {
 
+/// guards the links among trace nodes, which are shared by heaps of all threads
+static RecursiveMutex graphMutex;
+
+typedef MutexGuard<RecursiveMutex>                  TGraphGuard;
+
 // /////////////////////////////////////////////////////////////////////////////
-// implementation of Trace::NodeBase
+// implementation of Trace::NodeArena
 
-NodeBase::~NodeBase() {
-    BOOST_FOREACH(Node *parent, parents_)
-        parent->notifyDeath(this);
+/**
+ * slab allocator for trace nodes, each slab serves a single size of nodes and
+ * is returned to the system as soon as all nodes allocated from it are gone
+ */
+class NodeArena {
+    public:
+        NodeArena():
+            cntLive_(0U),
+            cntShared_(0U),
+            cntTruncated_(0U),
+            cntSlabs_(0U),
+            cntSlabsFreed_(0U),
+            bytesUsed_(0U),
+            bytesPeak_(0U)
+        {
+            std::fill(partial_, partial_ + SIZE_CLASSES, nullSlab_);
+        }
+
+        ~NodeArena() {
+            if (cntLive_)
+                // somebody still holds a trace node, better to leak the slabs
+                return;
+
+            // only the empty slabs kept for reuse are left at this point
+            for (unsigned i = 0U; i < SIZE_CLASSES; ++i)
+                while (partial_[i])
+                    this->freeSlab(partial_[i], i);
+        }
+
+        void* alloc(size_t size);
+        void release(void *ptr, size_t size);
+
+        void noteShared()       { ++cntShared_;     }
+        void noteTruncated()    { ++cntTruncated_;  }
+        void printStats() const;
+
+    private:
+        static const size_t ALIGN           = sizeof(void *);
+        static const size_t MAX_SIZE        = 0x80;
+        static const size_t SLAB_SIZE       = 0x10000;
+        static const size_t SIZE_CLASSES    = MAX_SIZE / ALIGN + 1;
+
+        struct FreeItem {
+            FreeItem           *next;
+        };
+
+        /// header at the beginning of each slab, slabs are SLAB_SIZE aligned
+        struct Slab {
+            Slab               *prev;       ///< in the list of partial slabs
+            Slab               *next;       ///< in the list of partial slabs
+            FreeItem           *freeList;   ///< released nodes of this slab
+            char               *cursor;     ///< start of the never used space
+            size_t              cntLive;    ///< nodes allocated from the slab
+        };
+
+        static const size_t HEADER_SIZE
+            = (sizeof(Slab) + ALIGN - 1) & ~(ALIGN - 1);
+
+        static Slab *const nullSlab_;
+
+        static Slab* slabOf(void *ptr) {
+            const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+            return reinterpret_cast<Slab *>(addr & ~(SLAB_SIZE - 1));
+        }
+
+        static bool isFull(const Slab *slab, size_t size) {
+            return !slab->freeList && reinterpret_cast<const char *>(slab)
+                + SLAB_SIZE < slab->cursor + size;
+        }
+
+        void linkSlab(Slab *slab, size_t cls);
+        void unlinkSlab(Slab *slab, size_t cls);
+        void freeSlab(Slab *slab, size_t cls);
+
+        Mutex                   lock_;
+        Slab                   *partial_[SIZE_CLASSES];
+        size_t                  cntLive_;
+        size_t                  cntShared_;
+        size_t                  cntTruncated_;
+        size_t                  cntSlabs_;
+        size_t                  cntSlabsFreed_;
+        size_t                  bytesUsed_;
+        size_t                  bytesPeak_;
+};
+
+NodeArena::Slab *const NodeArena::nullSlab_ = 0;
+
+void NodeArena::linkSlab(Slab *slab, size_t cls) {
+    Slab *&head = partial_[cls];
+    slab->prev = 0;
+    slab->next = head;
+    if (head)
+        head->prev = slab;
+
+    head = slab;
 }
 
+void NodeArena::unlinkSlab(Slab *slab, size_t cls) {
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        partial_[cls] = slab->next;
+
+    if (slab->next)
+        slab->next->prev = slab->prev;
+}
+
+void NodeArena::freeSlab(Slab *slab, size_t cls) {
+    CL_BREAK_IF(slab->cntLive);
+    this->unlinkSlab(slab, cls);
+    free(slab);
+
+    CL_BREAK_IF(!cntSlabs_);
+    --cntSlabs_;
+    ++cntSlabsFreed_;
+}
+
+void* NodeArena::alloc(size_t size) {
+    MutexGuard<Mutex> guard(lock_);
+    ++cntLive_;
+
+    // round up to the alignment
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    bytesUsed_ += size;
+    if (bytesPeak_ < bytesUsed_)
+        bytesPeak_ = bytesUsed_;
+
+    if (MAX_SIZE < size)
+        // too big to be allocated from slabs
+        return new char[size];
+
+    const size_t cls = size / ALIGN;
+    Slab *slab = partial_[cls];
+    if (!slab) {
+        // allocate a new slab, aligned such that slabOf() works
+        void *mem;
+        if (posix_memalign(&mem, SLAB_SIZE, SLAB_SIZE))
+            throw std::bad_alloc();
+
+        slab = static_cast<Slab *>(mem);
+        slab->freeList = 0;
+        slab->cursor = static_cast<char *>(mem) + HEADER_SIZE;
+        slab->cntLive = 0U;
+        this->linkSlab(slab, cls);
+        ++cntSlabs_;
+    }
+
+    void *ptr;
+    if (slab->freeList) {
+        // reuse a previously released node of this slab
+        FreeItem *item = slab->freeList;
+        slab->freeList = item->next;
+        ptr = item;
+    }
+    else {
+        ptr = slab->cursor;
+        slab->cursor += size;
+    }
+
+    ++slab->cntLive;
+    if (isFull(slab, size))
+        // nothing more to allocate from this slab
+        this->unlinkSlab(slab, cls);
+
+    return ptr;
+}
+
+void NodeArena::release(void *ptr, size_t size) {
+    MutexGuard<Mutex> guard(lock_);
+    CL_BREAK_IF(!cntLive_);
+    --cntLive_;
+
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    bytesUsed_ -= size;
+
+    if (MAX_SIZE < size) {
+        delete[] static_cast<char *>(ptr);
+        return;
+    }
+
+    const size_t cls = size / ALIGN;
+    Slab *slab = slabOf(ptr);
+    CL_BREAK_IF(!slab->cntLive);
+    if (isFull(slab, size))
+        // the slab is going to have a free node again
+        this->linkSlab(slab, cls);
+
+    // put the node to the free list of its slab
+    FreeItem *item = static_cast<FreeItem *>(ptr);
+    item->next = slab->freeList;
+    slab->freeList = item;
+
+    if (--slab->cntLive)
+        return;
+
+    if (partial_[cls] != slab || slab->next)
+        // the slab is empty and it is not the last one of its size, free it
+        this->freeSlab(slab, cls);
+}
+
+void NodeArena::printStats() const {
+    CL_DEBUG("trace graph: " << cntLive_ << " nodes alive, "
+            << (bytesUsed_ >> 10) << " KiB used, "
+            << (bytesPeak_ >> 10) << " KiB peak, "
+            << (cntSlabs_ * (SLAB_SIZE >> 10)) << " KiB in slabs, "
+            << cntSlabsFreed_ << " slabs freed, "
+            << cntShared_ << " nodes shared, "
+            << cntTruncated_ << " paths truncated");
+}
+
+static NodeArena nodeArena;
+
+void printStats() {
+    nodeArena.printStats();
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of Trace::NodeBase
+
 Node* NodeBase::parent() const {
     CL_BREAK_IF(1 != parents_.size());
     return parents_.front();
@@ -54,33 +278,202 @@ Node* NodeBase::parent() const {
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of Trace::Node
 
-void Node::notifyBirth(NodeBase *child) {
+Node::~Node() {
+    BOOST_FOREACH(Node *parent, parents_)
+        parent->notifyDeath(this);
+}
+
+void* Node::operator new(size_t size) {
+    return nodeArena.alloc(size);
+}
+
+void Node::operator delete(void *ptr, size_t size) {
+    nodeArena.release(ptr, size);
+}
+
+void Node::notifyBirth(Node *child) {
+    TGraphGuard guard(graphMutex);
     children_.push_back(child);
 }
 
-void Node::notifyDeath(NodeBase *child) {
+void Node::notifyDeath(Node *child) {
+    // the lock is recursive as the death may propagate to the parents
+    TGraphGuard guard(graphMutex);
+
     // remove the dead child from the list
-    children_.erase(
-            std::remove(children_.begin(), children_.end(), child),
-            children_.end());
+    const bool found = children_.erase(child);
+    CL_BREAK_IF(!found);
+    (void) found;
+
+    this->releaseIfUnused();
+}
+
+void Node::grabHandle() {
+    TGraphGuard guard(graphMutex);
+    ++cntHandles_;
+}
+
+void Node::dropHandle() {
+    TGraphGuard guard(graphMutex);
+    CL_BREAK_IF(!cntHandles_);
+    --cntHandles_;
+
+    this->releaseIfUnused();
+}
 
-    if (children_.empty())
+void Node::releaseIfUnused() {
+    if (children_.empty() && !cntHandles_)
         // FIXME: this may cause stack overflow on complex trace graphs
         delete this;
 }
 
+void Node::pruneIfNeeded() {
+#if SE_TRACE_MAX_DEPTH
+    if (depth_ % (SE_TRACE_MAX_DEPTH) || depth_ < (SE_TRACE_MAX_DEPTH))
+        // prune the trace only once per SE_TRACE_MAX_DEPTH nodes on the path
+        return;
+
+    TGraphGuard guard(graphMutex);
+
+    // go through all paths up to the ancestors SE_TRACE_MAX_DEPTH nodes above
+    // us (or more if a path joins another one), they form the cut frontier
+    const unsigned frontierDepth = depth_ - (SE_TRACE_MAX_DEPTH);
+    std::vector<Node *> frontier;
+    Node *node = this;
+    WorkList<Node *> wl(node);
+    while (wl.next(node)) {
+        if (node->depth_ <= frontierDepth) {
+            frontier.push_back(node);
+            continue;
+        }
+
+        BOOST_FOREACH(Node *parent, node->parents_)
+            wl.schedule(parent);
+    }
+
+    // replace all parents of the frontier nodes by a single TruncatedNode
+    Node *trunc = 0;
+    BOOST_FOREACH(Node *anc, frontier) {
+        bool needCut = false;
+        BOOST_FOREACH(Node *parent, anc->parents_)
+            if (!parent->parents_.empty())
+                // there is a history to be released above the parent
+                needCut = true;
+
+        if (!needCut)
+            continue;
+
+        if (!trunc)
+            trunc = new TruncatedNode;
+
+        std::vector<Node *> oldParents(anc->parents_.begin(),
+                                       anc->parents_.end());
+        while (!anc->parents_.empty())
+            anc->parents_.erase(anc->parents_.front());
+
+        anc->parents_.push_back(trunc);
+        trunc->notifyBirth(anc);
+
+        // this may release the whole history of the path
+        BOOST_FOREACH(Node *parent, oldParents)
+            parent->notifyDeath(anc);
+    }
+
+    if (trunc)
+        nodeArena.noteTruncated();
+#endif
+}
+
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of Trace::NodeHandle
 
+NodeHandle::~NodeHandle() {
+    this->node()->dropHandle();
+}
+
 void NodeHandle::reset(Node *node) {
+    TGraphGuard guard(graphMutex);
+
+    // register the new node first in case it is the same as the old one
+    node->grabHandle();
+
     // release the old node
     Node *&ref = parents_.front();
-    ref->notifyDeath(this);
-
-    // register the new node
+    ref->dropHandle();
     ref = node;
-    ref->notifyBirth(this);
+}
+
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of Trace::InsnNode::share() and Trace::CondNode::share()
+
+/// look for a child of ref that matches the given predicate
+template <class TNode, class TPred>
+TNode* findSharedChild(Node *ref, TPred pred) {
+#if 1 < SE_PARALLEL_HEAPS
+    // the found node could die before the caller takes a handle on it
+    (void) ref;
+    (void) pred;
+    return 0;
+#else
+    // the NodeHandle objects of heaps are not listed among the children
+    BOOST_FOREACH(Node *child, ref->children()) {
+        TNode *node = dynamic_cast<TNode *>(child);
+        if (node && pred(node)) {
+            nodeArena.noteShared();
+            return node;
+        }
+    }
+
+    return 0;
+#endif
+}
+
+struct InsnNodeMatcher {
+    TInsn insn;
+    bool isBuiltin;
+
+    bool operator()(const InsnNode *node) const;
+};
+
+struct CondNodeMatcher {
+    TInsn inCmp;
+    TInsn inCnd;
+    bool determ;
+    bool branch;
+
+    bool operator()(const CondNode *node) const;
+};
+
+Node* InsnNode::share(Node *ref, TInsn insn, const bool isBuiltin) {
+    const InsnNodeMatcher pred = { insn, isBuiltin };
+    if (Node *node = findSharedChild<InsnNode>(ref, pred))
+        return node;
+
+    return new InsnNode(ref, insn, isBuiltin);
+}
+
+bool InsnNodeMatcher::operator()(const InsnNode *node) const {
+    return node->insn_ == insn
+        && node->isBuiltin_ == isBuiltin;
+}
+
+Node* CondNode::share(Node *ref, TInsn inCmp, TInsn inCnd, bool determ,
+                      bool branch)
+{
+    const CondNodeMatcher pred = { inCmp, inCnd, determ, branch };
+    if (Node *node = findSharedChild<CondNode>(ref, pred))
+        return node;
+
+    return new CondNode(ref, inCmp, inCnd, determ, branch);
+}
+
+bool CondNodeMatcher::operator()(const CondNode *node) const {
+    return node->inCmp_ == inCmp
+        && node->inCnd_ == inCnd
+        && node->determ_ == determ
+        && node->branch_ == branch;
 }
 
 
@@ -137,6 +530,11 @@ void TransientNode::plotNode(TracePlotter &tplot) const {
         << SL_QUOTE(origin_) << "];\n";
 }
 
+void TruncatedNode::plotNode(TracePlotter &tplot) const {
+    tplot.out << "\t" << SL_QUOTE(this)
+        << " [shape=circle, color=black, fontcolor=black, label=\"...\"];\n";
+}
+
 void RootNode::plotNode(TracePlotter &tplot) const {
     tplot.out << "\t" << SL_QUOTE(this)
         << " [shape=circle, color=black, fontcolor=black, label=\"start\"];\n";
@@ -376,7 +774,9 @@ bool chkTraceGraphConsistency(Node *const from) {
         plotTrace(from, "symtrace-CloneNode-reachable");
     }
 
-    if (!isNodeKindReachble<RootNode>(from)) {
+    if (!isNodeKindReachble<RootNode>(from)
+            && !isNodeKindReachble<TruncatedNode>(from))
+    {
         CL_ERROR("RootNode not reachable from the given trace graph node");
         plotTrace(from, "symtrace-RootNode-not-reachable");
         return false;
@@ -471,6 +871,8 @@ GraphProxy::~GraphProxy() {
 }
 
 bool /* any change */ GraphProxy::insert(Node *node, const std::string &name) {
+    TGraphGuard guard(graphMutex);
+
     Private::TMap::const_iterator it = d->gmap.find(name);
 
     EndPointConsolidator *const epc = (d->gmap.end() == it)
@@ -30,7 +30,7 @@
 #include "symbt.hh"                 // needed for EMsgLevel
 #include "symheap.hh"               // needed for EObjKind
 
-#include <vector>
+#include <algorithm>
 #include <string>
 
 struct cl_loc;
@@ -51,7 +51,87 @@ typedef const struct cl_loc                        *TLoc;
 typedef const CodeStorage::Fnc                     *TFnc;
 typedef const CodeStorage::Insn                    *TInsn;
 
-typedef std::vector<Node *>                         TNodeList;
+/// a flat list of pointers, a single pointer is stored without any allocation
+template <class T>
+class PtrList {
+    public:
+        typedef T *const                               *const_iterator;
+        typedef const_iterator                          iterator;
+
+        PtrList():
+            size_(0U),
+            cap_(1U)
+        {
+            data_.inl = 0;
+        }
+
+        ~PtrList() {
+            if (1U < cap_)
+                delete[] data_.ext;
+        }
+
+        unsigned size()                 const { return size_; }
+        bool empty()                    const { return !size_; }
+        const_iterator begin()          const { return this->ptr(); }
+        const_iterator end()            const { return this->ptr() + size_; }
+        T* front()                      const { return *this->ptr(); }
+
+        /// the first item of a non-empty list, which can be overwritten
+        T*& front() {
+            return *const_cast<T **>(this->ptr());
+        }
+
+        void push_back(T *item) {
+            if (size_ == cap_) {
+                // grow the array twice
+                T **ext = new T *[cap_ << 1];
+                std::copy(this->begin(), this->end(), ext);
+                if (1U < cap_)
+                    delete[] data_.ext;
+
+                data_.ext = ext;
+                cap_ <<= 1;
+            }
+
+            const_cast<T **>(this->ptr())[size_++] = item;
+        }
+
+        /// remove a single occurrence of the given item, return false if none
+        bool erase(T *item) {
+            T **data = const_cast<T **>(this->ptr());
+            for (unsigned i = 0U; i < size_; ++i) {
+                if (data[i] != item)
+                    continue;
+
+                std::copy(data + i + 1, data + size_, data + i);
+                --size_;
+                return true;
+            }
+
+            return false;
+        }
+
+    private:
+        // copying NOT allowed
+        PtrList(const PtrList &);
+        PtrList& operator=(const PtrList &);
+
+        T *const* ptr() const {
+            return (1U < cap_)
+                ? data_.ext
+                : &data_.inl;
+        }
+
+    private:
+        union {
+            T                  *inl;
+            T                 **ext;
+        } data_;
+        unsigned                size_;
+        unsigned                cap_;
+};
+
+typedef PtrList<Node>                               TNodeList;
 
 /// an abstract base for Node and NodeHandle (externally not much useful)
 class NodeBase {
@@ -63,14 +143,13 @@ class NodeBase {
         NodeBase() { }
 
         /// construct Node with exactly one parent, can be extended later
-        NodeBase(Node *node):
-            parents_(1, node)
-        {
+        NodeBase(Node *node) {
+            parents_.push_back(node);
         }
 
     public:
         /// force virtual destructor
-        virtual ~NodeBase();
+        virtual ~NodeBase() { }
 
         /// this can be called only on nodes with exactly one parent
         Node* parent() const;
@@ -83,32 +162,54 @@ class NodeBase {
 class Node: public NodeBase {
     private:
         /// birth notification from a child node
-        void notifyBirth(NodeBase *child);
+        void notifyBirth(Node *child);
 
         /// death notification from a child node
-        void notifyDeath(NodeBase *child);
+        void notifyDeath(Node *child);
+
+        /// a NodeHandle started to refer to this node
+        void grabHandle();
+
+        /// a NodeHandle stopped referring to this node
+        void dropHandle();
+
+        /// delete this node if nothing refers to it any more
+        void releaseIfUnused();
+
+        /// cut off the ancestors too far from this node, see SE_TRACE_MAX_DEPTH
+        void pruneIfNeeded();
 
         friend class NodeBase;
         friend class NodeHandle;
 
     protected:
         /// this is an abstract class, its instantiation is @b not allowed
-        Node() { }
+        Node():
+            depth_(0U),
+            cntHandles_(0U)
+        {
+        }
 
         /// constructor for nodes with exactly one parent
         Node(Node *ref):
-            NodeBase(ref)
+            NodeBase(ref),
+            depth_(ref->depth_ + 1U),
+            cntHandles_(0U)
         {
             ref->notifyBirth(this);
+            this->pruneIfNeeded();
         }
 
         /// constructor for nodes with exactly two parents
         Node(Node *ref1, Node *ref2):
-            NodeBase(ref1)
+            NodeBase(ref1),
+            depth_(std::max(ref1->depth_, ref2->depth_) + 1U),
+            cntHandles_(0U)
         {
             parents_.push_back(ref2);
             ref1->notifyBirth(this);
             ref2->notifyBirth(this);
+            this->pruneIfNeeded();
         }
 
         /// serialize this node to the given plot (externally not much useful)
@@ -117,11 +218,17 @@ class Node: public NodeBase {
         friend void plotTraceCore(TracePlotter &);
 
     public:
-        /// used to store a list of child nodes
-        typedef std::vector<NodeBase *> TBaseList;
+        /// notify the parents about the death of this node
+        virtual ~Node();
 
-        /// reference to list of child nodes (containing 0..n pointers)
-        const TBaseList& children() const { return children_; }
+        /// reference to list of child nodes, NodeHandle objects are not listed
+        const TNodeList& children() const { return children_; }
+
+        /// nodes are allocated from a slab arena shared by all trace graphs
+        static void* operator new(size_t size);
+
+        /// nodes are allocated from a slab arena shared by all trace graphs
+        static void operator delete(void *ptr, size_t size);
 
     private:
         // copying NOT allowed
@@ -129,7 +236,13 @@ class Node: public NodeBase {
         Node& operator=(const Node &);
 
     private:
-        TBaseList children_;
+        TNodeList children_;
+
+        /// length of the longest path from a node without parents
+        unsigned depth_;
+
+        /// count of NodeHandle objects referring to this node
+        unsigned cntHandles_;
 };
 
 /// useful to prevent a trace sub-graph from being destroyed too early
@@ -139,9 +252,12 @@ class NodeHandle: public NodeBase {
         NodeHandle(Node *ref):
             NodeBase(ref)
         {
-            ref->notifyBirth(this);
+            ref->grabHandle();
         }
 
+        /// release the node stored within this handle
+        virtual ~NodeHandle();
+
         /// return the node stored within this handle
         Node* node() const {
             return this->parent();
@@ -154,7 +270,7 @@ class NodeHandle: public NodeBase {
         NodeHandle(const NodeHandle &tpl):
             NodeBase(tpl.node())
         {
-            this->parent()->notifyBirth(this);
+            this->parent()->grabHandle();
         }
 
         /// overridden assignment operator keeping the semantics of a handle
@@ -180,6 +296,12 @@ class TransientNode: public Node {
         const char *origin_;
 };
 
+/// replaces the part of a trace cut off because of SE_TRACE_MAX_DEPTH
+class TruncatedNode: public Node {
+    protected:
+        void virtual plotNode(TracePlotter &) const;
+};
+
 /// root node of the trace graph (usually a call of the root function)
 class RootNode: public Node {
     private:
@@ -202,6 +324,8 @@ class InsnNode: public Node {
         const TInsn insn_;
         const bool  isBuiltin_;
 
+        friend struct InsnNodeMatcher;
+
     public:
         /**
          * @param ref a reference to a trace leading to this instruction
@@ -215,6 +339,12 @@ class InsnNode: public Node {
         {
         }
 
+        /**
+         * the same as the constructor, but it reuses an existing child of ref
+         * created with the same arguments if there is any
+         */
+        static Node* share(Node *ref, TInsn insn, const bool isBuiltin);
+
     protected:
         void virtual plotNode(TracePlotter &) const;
 };
@@ -227,6 +357,8 @@ class CondNode: public Node {
         const bool determ_;
         const bool branch_;
 
+        friend struct CondNodeMatcher;
+
     public:
         /**
          * @param ref a reference to a trace leading to this instruction
@@ -244,6 +376,13 @@ class CondNode: public Node {
         {
         }
 
+        /**
+         * the same as the constructor, but it reuses an existing child of ref
+         * created with the same arguments if there is any
+         */
+        static Node* share(Node *ref, TInsn inCmp, TInsn inCnd, bool determ,
+                           bool branch);
+
     protected:
         void virtual plotNode(TracePlotter &) const;
 };
@@ -557,6 +696,9 @@ class Globals {
 /// mark the just completed @b clone operation as @b intended and unimportant
 void waiveCloneOperation(SymHeap &sh);
 
+/// print the amount of memory occupied by trace graphs (in verbose mode)
+void printStats();
+
 
 } // namespace Trace
 
@@ -269,9 +269,7 @@ bool canWriteDataPtrAt(const SymHeapCore &sh, TValId val) {
     if (!isPossibleToDeref(sh.valTarget(val)))
         return false;
 
-    static TSizeOf ptrSize;
-    if (!ptrSize)
-        ptrSize = sh.stor().types.dataPtrSizeof();
+    static const TSizeOf ptrSize = sh.stor().types.dataPtrSizeof();
 
     const TSizeRange size = sh.valSizeOfTarget(val);
     return (ptrSize <= size.lo);
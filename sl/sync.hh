@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_SYNC_H
+#define H_GUARD_SYNC_H
+
+/**
+ * @file sync.hh
+ * locks and counters shared by the threads of SymExecEngine, they compile to
+ * plain data if SE_PARALLEL_HEAPS is not greater than 1
+ */
+
+#include "config.h"
+
+#if 1 < SE_PARALLEL_HEAPS
+#   include <atomic>
+#   include <mutex>
+
+/// a counter that may be updated by more threads at a time
+#   define SHARED_CNT(type) std::atomic<type>
+
+/// a static variable of a POD type instantiated once per each thread
+#   define THREAD_LOCAL __thread
+
+typedef std::mutex                      Mutex;
+typedef std::recursive_mutex            RecursiveMutex;
+
+#else // SE_PARALLEL_HEAPS
+
+/// a counter that may be updated by more threads at a time
+#   define SHARED_CNT(type) type
+
+/// a static variable of a POD type instantiated once per each thread
+#   define THREAD_LOCAL
+
+/// dummy implementation, no data inside
+struct Mutex {
+    void lock()     { }
+    void unlock()   { }
+};
+
+typedef Mutex                           RecursiveMutex;
+
+#endif // SE_PARALLEL_HEAPS
+
+/// acquire the given lock for the lifetime of the object
+template <class TMutex>
+class MutexGuard {
+    public:
+        MutexGuard(TMutex &mutex):
+            mutex_(mutex)
+        {
+            mutex_.lock();
+        }
+
+        ~MutexGuard() {
+            mutex_.unlock();
+        }
+
+    private:
+        // copying NOT allowed
+        MutexGuard(const MutexGuard &);
+        MutexGuard& operator=(const MutexGuard &);
+
+    private:
+        TMutex &mutex_;
+};
+
+#endif /* H_GUARD_SYNC_H */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file flatmap_test.cc
+ * check FlatSet, FlatMap and IntervalArena against std::set/std::map and
+ * against a brute-force interval index on random sequences of operations
+ */
+
+#include "unit_test.hh"
+
+#include "config.h"
+#include "flatmap.hh"
+#include "intarena.hh"
+
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <vector>
+
+template <class TFlat, class TStd>
+bool sameContents(const TFlat &flat, const TStd &ref)
+{
+    // both containers have to iterate in the same (sorted) order
+    typedef std::vector<typename TFlat::value_type> TList;
+    return TList(flat.begin(), flat.end()) == TList(ref.begin(), ref.end());
+}
+
+void testFlatSet()
+{
+    FlatSet<int> flat;
+    std::set<int> ref;
+
+    for (int i = 0; i < 10000; ++i) {
+        const int key = rand() % 64;
+        switch (rand() % 3) {
+            case 0:
+            case 1:
+                UT_CHECK(flat.insert(key).second == ref.insert(key).second);
+                break;
+
+            case 2:
+                UT_CHECK(flat.erase(key) == ref.erase(key));
+                break;
+        }
+
+        const int probe = rand() % 64;
+        UT_CHECK((flat.end() == flat.find(probe))
+                == (ref.end() == ref.find(probe)));
+    }
+
+    UT_CHECK(sameContents(flat, ref));
+    flat.clear();
+    UT_CHECK(flat.empty());
+}
+
+void testFlatMap()
+{
+    FlatMap<int, int> flat;
+    std::map<int, int> ref;
+
+    for (int i = 0; i < 10000; ++i) {
+        const int key = rand() % 64;
+        switch (rand() % 4) {
+            case 0:
+                flat[key] = i;
+                ref[key] = i;
+                break;
+
+            case 1:
+                UT_CHECK(flat.insert(std::make_pair(key, i)).second
+                        == ref.insert(std::make_pair(key, i)).second);
+                break;
+
+            case 2:
+                UT_CHECK(flat.erase(key) == ref.erase(key));
+                break;
+
+            case 3: {
+                FlatMap<int, int>::iterator it = flat.find(key);
+                std::map<int, int>::iterator itRef = ref.find(key);
+                UT_CHECK((flat.end() == it) == (ref.end() == itRef));
+                if (flat.end() == it || ref.end() == itRef)
+                    break;
+
+                UT_CHECK(it->second == itRef->second);
+                flat.erase(it);
+                ref.erase(itRef);
+                break;
+            }
+        }
+    }
+
+    UT_CHECK(sameContents(flat, ref));
+}
+
+typedef IntervalArena<int, int>                     TArena;
+
+/// brute-force counterpart of IntervalArena, one bit per (offset, object)
+struct RefArena {
+    static const int OFF_MAX = 128;
+    static const int OBJ_MAX = 8;
+
+    bool cover[OFF_MAX][OBJ_MAX];
+
+    RefArena() {
+        for (int off = 0; off < OFF_MAX; ++off)
+            for (int obj = 0; obj < OBJ_MAX; ++obj)
+                cover[off][obj] = false;
+    }
+
+    void set(int beg, int end, int obj, bool val) {
+        for (int off = beg; off < end; ++off)
+            cover[off][obj] = val;
+    }
+
+    void intersects(TArena::TSet &dst, int beg, int end) const {
+        for (int off = beg; off < end; ++off)
+            for (int obj = 0; obj < OBJ_MAX; ++obj)
+                if (cover[off][obj])
+                    dst.insert(obj);
+    }
+};
+
+void testIntervalArena()
+{
+    TArena arena;
+    RefArena ref;
+
+    for (int i = 0; i < 10000; ++i) {
+        const int beg = rand() % (RefArena::OFF_MAX - 1);
+        const int end = beg + 1 + rand() % (RefArena::OFF_MAX - beg - 1);
+        const int obj = rand() % RefArena::OBJ_MAX;
+        const TArena::key_type key(beg, end);
+
+        switch (rand() % 3) {
+            case 0:
+                if (end - beg < 16) {
+                    // keep the intervals short so that they do not cover all
+                    arena += TArena::value_type(key, obj);
+                    ref.set(beg, end, obj, true);
+                }
+                break;
+
+            case 1:
+                arena -= TArena::value_type(key, obj);
+                ref.set(beg, end, obj, false);
+                break;
+
+            case 2: {
+                TArena::TSet got, expected;
+                arena.intersects(got, key);
+                ref.intersects(expected, beg, end);
+                UT_CHECK(got == expected);
+                break;
+            }
+        }
+    }
+
+    // an exact match is found only for the interval exactly as inserted
+    arena.clear();
+    arena += TArena::value_type(TArena::key_type(8, 16), 1);
+    arena += TArena::value_type(TArena::key_type(8, 24), 2);
+    arena += TArena::value_type(TArena::key_type(8, 16), 3);
+
+    TArena::TSet got;
+    arena.exactMatch(got, TArena::key_type(8, 16));
+    UT_CHECK(2U == got.size() && got.count(1) && got.count(3));
+
+    // removal of a window in the middle leaves the both outer parts
+    arena -= TArena::value_type(TArena::key_type(12, 20), 2);
+    got.clear();
+    arena.exactMatch(got, TArena::key_type(8, 12));
+    UT_CHECK(1U == got.size() && got.count(2));
+    got.clear();
+    arena.exactMatch(got, TArena::key_type(20, 24));
+    UT_CHECK(1U == got.size() && got.count(2));
+    got.clear();
+    arena.intersects(got, TArena::key_type(12, 20));
+    UT_CHECK(2U == got.size() && !got.count(2));
+}
+
+int main()
+{
+    srand(0);
+    testFlatSet();
+    testFlatMap();
+    testIntervalArena();
+    return UT_RESULT;
+}
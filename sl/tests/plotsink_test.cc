@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file plotsink_test.cc
+ * plot a few heaps once to separate dot files and once to an archive through
+ * PlotSink, extract the archive by slplotx -a and compare the resulting files
+ */
+
+#include "unit_test.hh"
+#include "unit_heap.hh"
+
+#include "config.h"
+#include "plotsink.hh"
+#include "symheap.hh"
+#include "symplot.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <sys/wait.h>
+
+#include <boost/foreach.hpp>
+
+typedef std::set<std::string>                       TNameSet;
+
+/// plot the heaps to the current directory, or to the archive if given
+void plotHeaps(const Program &prog, const char *archive)
+{
+    if (archive && !PlotSink::open(archive))
+        exit(1);
+
+    // the same heap is plotted more than once to get the chunks deduplicated
+    plotHeap(listHeap(prog, /* withSeg */ true),  "heap");
+    plotHeap(listHeap(prog, /* withSeg */ false), "heap");
+    plotHeap(emptyHeap(prog),                     "heap");
+    plotHeap(listHeap(prog, /* withSeg */ true),  "heap");
+    plotHeap(emptyHeap(prog),                     "empty");
+
+    if (archive)
+        PlotSink::close();
+}
+
+/// run plotHeaps() in a child process, which has its own PlotEnumerator
+bool plotHeapsIn(const Program &prog, const std::string &dir, const char *ar)
+{
+    const pid_t pid = fork();
+    if (!pid) {
+        if (chdir(dir.c_str()))
+            _exit(1);
+
+        plotHeaps(prog, ar);
+        _exit(0);
+    }
+
+    int status;
+    return 0 < pid
+        && pid == waitpid(pid, &status, 0)
+        && WIFEXITED(status)
+        && !WEXITSTATUS(status);
+}
+
+void readDir(TNameSet &dst, const std::string &dir)
+{
+    DIR *dp = opendir(dir.c_str());
+    if (!dp)
+        return;
+
+    const struct dirent *ent;
+    while ((ent = readdir(dp))) {
+        const std::string name(ent->d_name);
+        const std::string::size_type len = name.size();
+        if (4U < len && name.substr(len - 4U) == ".dot")
+            dst.insert(name);
+    }
+
+    closedir(dp);
+}
+
+std::string readFile(const std::string &fileName)
+{
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    std::ostringstream str;
+    str << in.rdbuf();
+    return str.str();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s SLPLOTX\n", argv[0]);
+        return 1;
+    }
+
+    char dirTpl[] = "/tmp/plotsink_test.XXXXXX";
+    if (!mkdtemp(dirTpl)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    const std::string dir(dirTpl);
+    const std::string dirFiles(dir + "/files");
+    const std::string dirArchive(dir + "/archive");
+    UT_CHECK(!mkdir(dirFiles.c_str(), 0700));
+    UT_CHECK(!mkdir(dirArchive.c_str(), 0700));
+
+    const Program prog;
+    UT_CHECK(plotHeapsIn(prog, dirFiles, /* archive */ 0));
+    UT_CHECK(plotHeapsIn(prog, dirArchive, "heaps.slplot"));
+
+    // nothing but the archive is written while PlotSink is active
+    TNameSet names;
+    readDir(names, dirArchive);
+    UT_CHECK(names.empty());
+
+    const std::string cmd = "cd '" + dirArchive + "' && '" + argv[1]
+        + "' -a heaps.slplot";
+    UT_CHECK(!system(cmd.c_str()));
+
+    TNameSet ref;
+    readDir(ref, dirFiles);
+    readDir(names, dirArchive);
+    UT_CHECK(5U == ref.size());
+    UT_CHECK(names == ref);
+
+    BOOST_FOREACH(const std::string &name, ref) {
+        const std::string plain(readFile(dirFiles + "/" + name));
+        UT_CHECK(!plain.empty());
+        UT_CHECK(plain == readFile(dirArchive + "/" + name));
+    }
+
+    removeDir(dir);
+    return UT_RESULT;
+}
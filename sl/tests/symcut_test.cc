@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file symcut_test.cc
+ * simulate many function calls through splitHeapByCVars()/joinHeapsByCVars()
+ * and check that an entry shared with the caller looks the same as the one cut
+ * by a deep copy, and that the dead entities the calls leave in the caller's
+ * heap (with SE_SYMCUT_ZERO_COPY) change nothing for areEqual(), joinSymHeaps()
+ * and heapFingerprint(), compared with a compact deep copy of the same heap
+ */
+
+#include "unit_test.hh"
+#include "unit_heap.hh"
+
+#include "config.h"
+#include "symcmp.hh"
+#include "symcut.hh"
+#include "symgc.hh"
+#include "symheap.hh"
+#include "symjoin.hh"
+#include "symutil.hh"
+
+#include <cstdlib>
+
+/// the list the given program variable points to
+class ListOf {
+    public:
+        ListOf(SymHeap &sh, const Program &prog, int uid):
+            sh_(sh),
+            prog_(prog),
+            at_(sh.addrOfVar(CVar(uid, 0), /* createIfNeeded */ true))
+        {
+        }
+
+        /// make the list empty, program variables are not initialized
+        void init() {
+            ObjHandle(sh_, at_, &prog_.ptrType).setValue(VAL_NULL);
+        }
+
+        /// the first node of the list, VAL_NULL if the list is empty
+        TValId first() const {
+            return ObjHandle(sh_, at_, &prog_.ptrType).value();
+        }
+
+        /// the data of the first node of a non-empty list
+        TValId firstData() const {
+            const TValId addr = sh_.valByOffset(this->first(), 8);
+            return ObjHandle(sh_, addr, &prog_.intType).value();
+        }
+
+        /// prepend a node holding a fresh unknown value, non-zero if requested
+        void push(bool nonZero) {
+            const TValId node = sh_.heapAlloc(IR::rngFromNum(16));
+            sh_.valSetLastKnownTypeOfTarget(node, &prog_.nodeType);
+            ObjHandle(sh_, node, &prog_.ptrType).setValue(this->first());
+
+            const TValId data = sh_.valCreate(VT_UNKNOWN, VO_UNKNOWN);
+            const TValId dataAt = sh_.valByOffset(node, 8);
+            ObjHandle(sh_, dataAt, &prog_.intType).setValue(data);
+            if (nonZero)
+                sh_.neqOp(SymHeap::NEQ_ADD, data, VAL_NULL);
+
+            ObjHandle(sh_, at_, &prog_.ptrType).setValue(node);
+        }
+
+        /// unlink the first node of a non-empty list and collect it
+        void pop() {
+            const TValId node = this->first();
+            const TValId next = ObjHandle(sh_, node, &prog_.ptrType).value();
+            ObjHandle(sh_, at_, &prog_.ptrType).setValue(next);
+            collectJunk(sh_, node);
+        }
+
+    private:
+        SymHeap            &sh_;
+        const Program      &prog_;
+        const TValId        at_;
+};
+
+/// count of calls with the entry shared with the caller, and of the other ones
+unsigned cntShared, cntCopied;
+
+/// f(): takes the list of head, the list of aux is left in the frame
+void simulateCall(SymHeap &sh, const Program &prog)
+{
+    TCVarList cut;
+    cut.push_back(CVar(Program::UID_HEAD, 0));
+
+    // the entry as cut by a deep copy, for reference
+    SymHeap ref(sh);
+    splitHeapByCVars(&ref, cut);
+
+    const unsigned lastIdCaller = sh.lastId();
+    SymHeap frame(prog.stor, new Trace::RootNode(0));
+    splitHeapByCVars(&sh, cut, &frame);
+    if (lastIdCaller <= sh.lastId())
+        ++cntShared;
+    else
+        ++cntCopied;
+
+    // no matter how the entry was built, it needs to look the same
+    UT_CHECK(areEqual(sh, ref));
+    UT_CHECK(sh.cntNeqPreds() == ref.cntNeqPreds());
+
+    ListOf list(sh, prog, Program::UID_HEAD);
+    if (VAL_NULL == list.first() || rand() % 3)
+        list.push(/* nonZero */ rand() % 2);
+    else
+        list.pop();
+
+    joinHeapsByCVars(&sh, &frame, /* src2IsSharedFrame */ true);
+}
+
+/// grow or shrink the part of the heap f() does not see, relate it to the rest
+void simulateCaller(SymHeap &sh, const Program &prog, bool grow)
+{
+    ListOf list(sh, prog, Program::UID_AUX);
+    ListOf other(sh, prog, Program::UID_HEAD);
+
+    for (int i = rand() % 4; i; --i) {
+        if (grow)
+            list.push(/* nonZero */ rand() % 2);
+        else if (VAL_NULL != list.first())
+            list.pop();
+    }
+
+    if (rand() % 4 || VAL_NULL == list.first() || VAL_NULL == other.first())
+        return;
+
+    // a Neq predicate crossing the cut, dropped by the next call
+    sh.neqOp(SymHeap::NEQ_ADD, list.firstData(), other.firstData());
+}
+
+/// a deep copy of the given heap without any dead entities
+SymHeap compactCopy(const SymHeap &sh)
+{
+    TCVarList all;
+    gatherProgramVars(all, sh);
+
+    SymHeap dup(sh);
+    splitHeapByCVars(&dup, all);
+    return dup;
+}
+
+void checkAgainstCompactCopy(const SymHeap &sh, unsigned *pMaxRatio)
+{
+    const SymHeap clean = compactCopy(sh);
+    UT_CHECK(areEqual(sh, clean));
+    UT_CHECK(sh.cntNeqPreds() == clean.cntNeqPreds());
+
+    HeapFingerprint fp, fpClean;
+    heapFingerprint(&fp, sh);
+    heapFingerprint(&fpClean, clean);
+    UT_CHECK(fp.shape == fpClean.shape);
+
+    EJoinStatus status;
+    SymHeap dst(sh.stor(), new Trace::RootNode(0));
+    UT_CHECK(joinSymHeaps(&status, &dst, sh, clean) && JS_USE_ANY == status);
+
+    const unsigned ratio = sh.lastId() / (1U + clean.lastId());
+    if (*pMaxRatio < ratio)
+        *pMaxRatio = ratio;
+}
+
+int main()
+{
+    const Program prog;
+    unsigned maxRatio = 0U;
+
+    for (int seed = 1; seed <= 3; ++seed) {
+        srand(seed);
+        SymHeap sh(prog.stor, new Trace::RootNode(0));
+        ListOf(sh, prog, Program::UID_HEAD).init();
+        ListOf(sh, prog, Program::UID_AUX).init();
+
+        for (int i = 0; i < 300; ++i) {
+            // the frame outgrows the entry first, then it shrinks to nothing
+            simulateCaller(sh, prog, /* grow */ i < 100);
+            simulateCall(sh, prog);
+            checkAgainstCompactCopy(sh, &maxRatio);
+        }
+    }
+
+    // the dead entities take at most about twice as many IDs as the live ones
+    UT_CHECK(maxRatio <= 2U);
+
+#if SE_SYMCUT_ZERO_COPY
+    // both ways of building the entry have been used
+    UT_CHECK(cntShared && cntCopied);
+#endif
+    return UT_RESULT;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file symgc_test.cc
+ * run random sequences of heap operations and check the reachability index
+ * behind SymHeapCore::valTargetIsReachable() against isJunkCore() for all
+ * heap objects after each step
+ */
+
+#include "unit_test.hh"
+#include "unit_heap.hh"
+
+#include "config.h"
+#include "symgc.hh"
+#include "symheap.hh"
+
+#include <cstdlib>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+/// size of the heap objects, each of them holds up to four pointers
+static const int OBJ_SIZE = 32;
+
+typedef std::vector<SymHeap *>                      THeapList;
+
+/// the index and the exhaustive search have to agree on all heap objects
+bool checkAllRoots(SymHeap &sh)
+{
+    TValList roots;
+    sh.gatherRootObjects(roots, isOnHeap);
+    BOOST_FOREACH(const TValId root, roots)
+        if (sh.valTargetIsReachable(root) == isJunkCore(sh, root))
+            return false;
+
+    return true;
+}
+
+/// write the given value to the given address, let the GC see killed values
+void writePtr(SymHeap &sh, const Program &prog, TValId at, TValId val,
+              bool gc)
+{
+    TValSet killed;
+    ObjHandle(sh, at, &prog.ptrType).setValue(val, &killed);
+    if (!gc)
+        return;
+
+    BOOST_FOREACH(const TValId val, killed)
+        if (0 < val && isOnHeap(sh.valTarget(val)))
+            collectJunk(sh, sh.valRoot(val));
+}
+
+/// replace the current heap by its copy, keep a few of the older ones alive
+void forkHeap(SymHeap *&sh, THeapList &keep)
+{
+    keep.push_back(sh);
+    sh = new SymHeap(*sh);
+    if (5U < keep.size()) {
+        delete keep.front();
+        keep.erase(keep.begin());
+    }
+
+    if (rand() % 2)
+        // continue with one of the older heaps, which share data with others
+        std::swap(sh, keep[rand() % keep.size()]);
+}
+
+/// random pointer writes, frees and heap forks among a few heap objects
+void testRandomGraph(const Program &prog, int steps)
+{
+    SymHeap *sh = new SymHeap(prog.stor, new Trace::RootNode(0));
+    THeapList keep;
+
+    for (int i = 0; i < steps; ++i) {
+        const TValId head = sh->addrOfVar(CVar(Program::UID_HEAD, 0), true);
+
+        TValList roots;
+        sh->gatherRootObjects(roots, isOnHeap);
+        const int op = rand() % 10;
+        if (op < 2 || roots.size() < 3) {
+            sh->heapAlloc(IR::rngFromNum(OBJ_SIZE));
+        }
+        else if (op < 8) {
+            // write a pointer either to the program variable or to the heap
+            TValId at = head;
+            if (rand() % 4) {
+                at = roots[rand() % roots.size()];
+                at = sh->valByOffset(at, sizeof(void *) * (rand() % 4));
+            }
+
+            TValId val = VAL_NULL;
+            if (rand() % 5) {
+                val = roots[rand() % roots.size()];
+                val = sh->valByOffset(val, sizeof(void *) * (rand() % 2));
+            }
+
+            writePtr(*sh, prog, at, val, /* gc */ !(rand() % 3));
+        }
+        else if (op == 8) {
+            sh->valDestroyTarget(roots[rand() % roots.size()]);
+        }
+        else {
+            forkHeap(sh, keep);
+        }
+
+        UT_CHECK(checkAllRoots(*sh));
+    }
+
+    delete sh;
+    BOOST_FOREACH(SymHeap *old, keep)
+        delete old;
+}
+
+/// a list appended via head/tail pointers, which is randomly cut and forked
+void testList(const Program &prog, int steps)
+{
+    SymHeap *sh = new SymHeap(prog.stor, new Trace::RootNode(0));
+    THeapList keep;
+
+    // the tail pointer lives in a heap object pointed by the program variable
+    const TValId head = sh->addrOfVar(CVar(Program::UID_HEAD, 0), true);
+    const TValId anchor = sh->heapAlloc(IR::rngFromNum(OBJ_SIZE));
+    writePtr(*sh, prog, head, anchor, /* gc */ false);
+    const TValId tailAt = sh->valByOffset(anchor, sizeof(void *));
+
+    TValList list;
+    for (int i = 0; i < steps; ++i) {
+        const int op = rand() % 100;
+        if (op < 90 || list.empty()) {
+            // append a node, update the head/tail pointers
+            const TValId node = sh->heapAlloc(IR::rngFromNum(OBJ_SIZE));
+            writePtr(*sh, prog, node, VAL_NULL, /* gc */ false);
+            const TValId prev = (list.empty()) ? anchor : list.back();
+            writePtr(*sh, prog, prev, node, /* gc */ true);
+            writePtr(*sh, prog, tailAt, node, /* gc */ true);
+            list.push_back(node);
+        }
+        else if (op < 97) {
+            // cut the list, the rest of it is collected as garbage
+            const unsigned idx = rand() % list.size();
+            writePtr(*sh, prog, list[idx], VAL_NULL, /* gc */ true);
+            list.resize(idx + 1U);
+            writePtr(*sh, prog, tailAt, list.back(), /* gc */ true);
+        }
+        else {
+            // the value IDs stay valid in the copy, so does the list
+            keep.push_back(new SymHeap(*sh));
+            if (5U < keep.size()) {
+                delete keep.front();
+                keep.erase(keep.begin());
+            }
+        }
+
+        UT_CHECK(checkAllRoots(*sh));
+    }
+
+    // nothing but the list and its anchor is left on the heap
+    TValList roots;
+    sh->gatherRootObjects(roots, isOnHeap);
+    UT_CHECK(list.size() + 1U == roots.size());
+
+    delete sh;
+    BOOST_FOREACH(SymHeap *old, keep)
+        delete old;
+}
+
+int main()
+{
+    const Program prog;
+    for (int seed = 1; seed <= 3; ++seed) {
+        srand(seed);
+        testRandomGraph(prog, 3000);
+        testList(prog, 1000);
+    }
+
+    return UT_RESULT;
+}
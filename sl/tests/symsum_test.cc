@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file symsum_test.cc
+ * save function summaries by SummaryStore, load them back and check that we
+ * get the same heaps, and that the summaries of several runs are merged
+ */
+
+#include "unit_test.hh"
+#include "unit_heap.hh"
+
+#include "config.h"
+#include "symcmp.hh"
+#include "symheap.hh"
+#include "symsum.hh"
+
+#include <cstdlib>
+#include <string>
+
+CallSummary summaryOf(const SymHeap &entry, const SymHeap &result)
+{
+    CallSummary sum(entry);
+    sum.results.insert(result);
+    return sum;
+}
+
+bool sameSummaries(const CallSummary &sum, const CallSummary &ref)
+{
+    if (!areEqual(sum.entry, ref.entry))
+        return false;
+
+    if (sum.entry.cntNeqPreds() != ref.entry.cntNeqPreds())
+        // the Neq predicates implied by the shape must not be stored
+        return false;
+
+    if (sum.results.size() != ref.results.size())
+        return false;
+
+    for (unsigned i = 0; i < sum.results.size(); ++i)
+        if (!areEqual(sum.results[i], ref.results[i]))
+            return false;
+
+    return true;
+}
+
+void testRoundTrip(const Program &prog, const std::string &dir)
+{
+    const CallSummary sum =
+        summaryOf(listHeap(prog, /* withSeg */ true), emptyHeap(prog));
+
+    TCallSummaryList src;
+    src.push_back(sum);
+    {
+        SummaryStore store(prog.stor, dir, "test");
+        UT_CHECK(store.save(prog.fnc, src));
+    }
+
+    // load the summary by another instance, as the next run would do
+    TCallSummaryList dst;
+    SummaryStore store(prog.stor, dir, "test");
+    UT_CHECK(store.load(dst, prog.fnc));
+    UT_CHECK(1U == dst.size() && sameSummaries(dst.front(), sum));
+
+    // the summaries of other run-time options are not shared
+    SummaryStore other(prog.stor, dir, "other");
+    dst.clear();
+    UT_CHECK(!other.load(dst, prog.fnc) && dst.empty());
+}
+
+void testMerge(const Program &prog, const std::string &dir)
+{
+    const CallSummary sum1 =
+        summaryOf(listHeap(prog, /* withSeg */ true), emptyHeap(prog));
+    const CallSummary sum2 =
+        summaryOf(listHeap(prog, /* withSeg */ false), emptyHeap(prog));
+
+    TCallSummaryList src1, src2;
+    src1.push_back(sum1);
+    src2.push_back(sum2);
+
+    // two runs, each of them calling f() with a different entry heap
+    SummaryStore(prog.stor, dir, "merge").save(prog.fnc, src1);
+    SummaryStore(prog.stor, dir, "merge").save(prog.fnc, src2);
+
+    TCallSummaryList dst;
+    SummaryStore(prog.stor, dir, "merge").load(dst, prog.fnc);
+    UT_CHECK(2U == dst.size());
+
+    // the same entry heap again, nothing is duplicated
+    SummaryStore(prog.stor, dir, "merge").save(prog.fnc, src1);
+    dst.clear();
+    SummaryStore(prog.stor, dir, "merge").load(dst, prog.fnc);
+    UT_CHECK(2U == dst.size());
+}
+
+int main()
+{
+    char dirTpl[] = "/tmp/symsum_test.XXXXXX";
+    if (!mkdtemp(dirTpl)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    const std::string dir(dirTpl);
+    const Program prog;
+    testRoundTrip(prog, dir);
+    testMerge(prog, dir);
+
+    removeDir(dir);
+    return UT_RESULT;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_UNIT_HEAP_H
+#define H_GUARD_UNIT_HEAP_H
+
+/**
+ * @file unit_heap.hh
+ * a tiny program and a few heaps over it shared by the unit tests of libsl.so
+ */
+
+#include "config.h"
+#include "symheap.hh"
+#include "symtrace.hh"
+
+#include <cl/storage.hh>
+
+/**
+ * a tiny program: struct node { struct node *next; int data; } *head, *aux;
+ * and an external function f()
+ */
+struct Program {
+    CodeStorage::Storage        stor;
+    CodeStorage::Fnc            fnc;
+    struct cl_type              intType;
+    struct cl_type              ptrType;
+    struct cl_type              nodeType;
+    struct cl_type_item         ptrItem;
+    struct cl_type_item         nodeItems[2];
+
+    static const int            UID_HEAD = 1;
+    static const int            UID_FNC  = 2;
+    static const int            UID_AUX  = 3;
+
+    Program();
+};
+
+inline Program::Program()
+{
+    static struct cl_type zeroType;
+    intType = ptrType = nodeType = zeroType;
+
+    intType.uid             = 1;
+    intType.code            = CL_TYPE_INT;
+    intType.size            = 4;
+
+    ptrItem.type            = &nodeType;
+    ptrItem.name            = 0;
+    ptrItem.offset          = 0;
+    ptrType.uid             = 2;
+    ptrType.code            = CL_TYPE_PTR;
+    ptrType.size            = 8;
+    ptrType.item_cnt        = 1;
+    ptrType.items           = &ptrItem;
+
+    nodeItems[0].type       = &ptrType;
+    nodeItems[0].name       = "next";
+    nodeItems[0].offset     = 0;
+    nodeItems[1].type       = &intType;
+    nodeItems[1].name       = "data";
+    nodeItems[1].offset     = 8;
+    nodeType.uid            = 3;
+    nodeType.code           = CL_TYPE_STRUCT;
+    nodeType.name           = "node";
+    nodeType.size           = 16;
+    nodeType.item_cnt       = 2;
+    nodeType.items          = nodeItems;
+
+    stor.types.insert(&intType);
+    stor.types.insert(&ptrType);
+    stor.types.insert(&nodeType);
+
+    CodeStorage::Var &head = stor.vars[UID_HEAD];
+    head.code               = CodeStorage::VAR_GL;
+    head.uid                = UID_HEAD;
+    head.name               = "head";
+    head.type               = &ptrType;
+
+    CodeStorage::Var &aux = stor.vars[UID_AUX];
+    aux.code                = CodeStorage::VAR_GL;
+    aux.uid                 = UID_AUX;
+    aux.name                = "aux";
+    aux.type                = &ptrType;
+
+    struct cl_cst &cst = fnc.def.data.cst;
+    fnc.def.code            = CL_OPERAND_CST;
+    cst.code                = CL_TYPE_FNC;
+    cst.data.cst_fnc.uid    = UID_FNC;
+    cst.data.cst_fnc.name   = "f";
+    cst.data.cst_fnc.is_extern = true;
+    fnc.stor                = &stor;
+    stor.fncs[UID_FNC]      = &fnc;
+}
+
+/// head -> node -> SLS 1+ -> NULL, the data of node is non-zero (Neq)
+inline SymHeap listHeap(const Program &prog, bool withSeg)
+{
+    SymHeap sh(prog.stor, new Trace::RootNode(0));
+    const TValId addrHead = sh.addrOfVar(CVar(Program::UID_HEAD, 0), true);
+
+    const TValId node = sh.heapAlloc(IR::rngFromNum(prog.nodeType.size));
+    sh.valSetLastKnownTypeOfTarget(node, &prog.nodeType);
+    ObjHandle(sh, addrHead, &prog.ptrType).setValue(node);
+
+    const TValId data = sh.valCreate(VT_UNKNOWN, VO_UNKNOWN);
+    ObjHandle(sh, sh.valByOffset(node, 8), &prog.intType).setValue(data);
+    sh.neqOp(SymHeap::NEQ_ADD, data, VAL_NULL);
+
+    if (!withSeg) {
+        ObjHandle(sh, node, &prog.ptrType).setValue(VAL_NULL);
+        return sh;
+    }
+
+    const TValId seg = sh.heapAlloc(IR::rngFromNum(prog.nodeType.size));
+    sh.valSetLastKnownTypeOfTarget(seg, &prog.nodeType);
+    ObjHandle(sh, node, &prog.ptrType).setValue(seg);
+    ObjHandle(sh, seg, &prog.ptrType).setValue(VAL_NULL);
+
+    sh.valTargetSetAbstract(seg, OK_SLS, BindingOff());
+    sh.segSetMinLength(seg, 1);
+    return sh;
+}
+
+/// head -> NULL
+inline SymHeap emptyHeap(const Program &prog)
+{
+    SymHeap sh(prog.stor, new Trace::RootNode(0));
+    const TValId addrHead = sh.addrOfVar(CVar(Program::UID_HEAD, 0), true);
+    ObjHandle(sh, addrHead, &prog.ptrType).setValue(VAL_NULL);
+    return sh;
+}
+
+#endif /* H_GUARD_UNIT_HEAP_H */
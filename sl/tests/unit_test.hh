@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_UNIT_TEST_H
+#define H_GUARD_UNIT_TEST_H
+
+/**
+ * @file unit_test.hh
+ * minimalist support for the unit tests of libsl.so
+ */
+
+#include <cstdio>
+#include <string>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// count of failed checks, the test is expected to return it from main()
+static int cntFailed;
+
+/// report (but do not abort on) each failed check
+#define UT_CHECK(cond) do {                                                 \
+    if (cond)                                                               \
+        break;                                                              \
+                                                                            \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);\
+    ++cntFailed;                                                            \
+} while (0)
+
+/// the value to return from main()
+#define UT_RESULT ((cntFailed) ? 1 : 0)
+
+/// remove the given directory including its contents, used to clean up
+inline void removeDir(const std::string &dir)
+{
+    DIR *dp = opendir(dir.c_str());
+    if (!dp)
+        return;
+
+    const struct dirent *ent;
+    while ((ent = readdir(dp))) {
+        const std::string name(ent->d_name);
+        if (name == "." || name == "..")
+            continue;
+
+        const std::string path(dir + "/" + name);
+        struct stat st;
+        if (!lstat(path.c_str(), &st) && S_ISDIR(st.st_mode))
+            removeDir(path);
+        else
+            unlink(path.c_str());
+    }
+
+    closedir(dp);
+    rmdir(dir.c_str());
+}
+
+#endif /* H_GUARD_UNIT_TEST_H */